@@ -20,6 +20,7 @@ Alarm::Alarm(const JsonObject& json) :
     field(GroupStateFieldHelpers::getFieldByName(json[F("field")])),
     startValue(json[F("start_value")]),
     endValue(json[F("end_value")]),
+    easing(parseEasing(json[F("easing")])),
     initDoc(json[F("init")].as<JsonObject>())
 {
     Serial.println("Decoded alarm from json");
@@ -37,28 +38,11 @@ bool Alarm::trigger(MiLightClient*& milightClient) {
     if(!initDoc.isNull())
         milightClient->update(initDoc.as<JsonObject>());
 
-    // create a variant
-    StaticJsonDocument<100> fakedoc;
-    StaticJsonDocument<200> doc;
-    JsonObject obj = doc.to<JsonObject>();
-    obj[F("field")] = GroupStateFieldHelpers::getFieldName(field);
-    obj[F("duration")] = duration;
-    doc[F("period")] = (uint16_t) (duration*1000/30);
-    doc[F("start_value")] = startValue;
-    doc[F("end_value")] = endValue;
-
-    #ifdef ALARM_DEBUG
-        char output[200];
-        Serial.println("Instruction: ");
-        serializeJson(doc, output);
-        Serial.println(output);
-    #endif
-    bool ret = milightClient->handleTransition(doc.as<JsonObject>(), fakedoc);
+    bool ret = milightClient->transitionBetween(field, startValue, endValue, duration, (uint16_t) (duration*1000/30), easing);
     #ifdef ALARM_DEBUG
         if(!ret) {
-            serializeJson(fakedoc, output);
-            Serial.println("Error: ");
-            Serial.println(output);
+            Serial.print("Error: could not start transition for alarm field ");
+            Serial.println(GroupStateFieldHelpers::getFieldName(field));
         }
     #endif
     return ret;
@@ -88,6 +72,11 @@ uint32_t Alarm::getID() {
     return id;
 }
 
+TransitionEasing Alarm::parseEasing(JsonVariant value) {
+    TransitionEasing easing = Easing::fromName(value.as<const char*>());
+    return easing == EASING_UNKNOWN ? EASING_LINEAR : easing;
+}
+
 std::shared_ptr<Alarm> Alarm::snooze(uint32_t newID, unsigned long currentTime, MiLightClient*& milightClient, JsonObject& response) {
     if(snoozes < 3) {
         const MiLightRemoteConfig* config = MiLightRemoteConfig::fromType(bulbId.deviceType);
@@ -95,13 +84,11 @@ std::shared_ptr<Alarm> Alarm::snooze(uint32_t newID, unsigned long currentTime,
             response[F("error")] = F("Could not snooze alarm.");
             return nullptr;
         }
-        milightClient->prepare(config, bulbId.deviceId, bulbId.groupId);
-        StaticJsonDocument<30> doc;
-        JsonObject obj = doc.to<JsonObject>();
-        obj[GroupStateFieldHelpers::getFieldName(field)] = startValue;
-        milightClient->update(obj);
+        MiLightCommand command(bulbId);
+        command.set(field, startValue);
+        milightClient->apply(command);
         return std::make_shared<Alarm>(newID, name, alias, currentTime+SNOOZE_TIME, 0, duration, 0, bulbId, //don't pass over the autoturnoff!
-            field, startValue, endValue, initDoc, snoozes+1);
+            field, startValue, endValue, easing, initDoc, snoozes+1);
     } else {
         response[F("error")] = F("You already snoozed three times!");
         return nullptr;
@@ -111,7 +98,7 @@ std::shared_ptr<Alarm> Alarm::snooze(uint32_t newID, unsigned long currentTime,
 std::shared_ptr<Alarm> Alarm::repeat() {
     if(repeatTime>0)
         return std::make_shared<Alarm>(id, name, alias, utc_time2000+repeatTime, repeatTime, duration, autoTurnOff,  bulbId,
-            field, startValue, endValue, initDoc);
+            field, startValue, endValue, easing, initDoc);
     return nullptr;
 }
 
@@ -130,6 +117,7 @@ void Alarm::serialize(JsonObject& json, bool pretty) {
     json[F("auto_turn_off")] = autoTurnOff;
     json[F("start_value")] = startValue;
     json[F("end_value")] = endValue;
+    json[F("easing")] = Easing::getName(easing);
     json[F("field")] = GroupStateFieldHelpers::getFieldName(field);
     json[F("init")] = initDoc.as<JsonObject>();
     JsonObject bulbParams = json.createNestedObject("bulb");
@@ -4,6 +4,7 @@
 #include <memory>
 #include <MiLightClient.h>
 #include <TimeFormatter.h>
+#include <Easing.h>
 #pragma once
 
 #define SNOOZE_TIME 300 //5 minutes
@@ -12,7 +13,7 @@ class Alarm {
     public:
         Alarm(uint32_t id, String name, String bulbAlias, unsigned long utc_time, unsigned long repeatTime,
                 uint16_t duration, uint16_t autoTurnOff, const BulbId& bulbId,
-                GroupStateField field, uint16_t startValue, uint16_t endValue, JsonObject init, uint8_t snoozes = 0):
+                GroupStateField field, uint16_t startValue, uint16_t endValue, TransitionEasing easing, JsonObject init, uint8_t snoozes = 0):
             id(id),
             name(name),
             alias(bulbAlias),
@@ -24,6 +25,7 @@ class Alarm {
             field(field),
             startValue(startValue),
             endValue(endValue),
+            easing(easing),
             initDoc(init.memoryUsage()+JSON_OBJECT_SIZE(2)),
             snoozes(snoozes)
             {
@@ -31,7 +33,7 @@ class Alarm {
             };
          Alarm(uint32_t id, String name, String bulbAlias, unsigned long utc_time, unsigned long repeatTime,
                 uint16_t duration, uint16_t autoTurnOff, const BulbId& bulbId,
-                GroupStateField field, uint16_t startValue, uint16_t endValue, JsonDocument init, uint8_t snoozes = 0):
+                GroupStateField field, uint16_t startValue, uint16_t endValue, TransitionEasing easing, JsonDocument init, uint8_t snoozes = 0):
             id(id),
             name(name),
             alias(bulbAlias),
@@ -43,6 +45,7 @@ class Alarm {
             field(field),
             startValue(startValue),
             endValue(endValue),
+            easing(easing),
             initDoc(init),
             snoozes(snoozes) {}
         Alarm(const JsonObject& serial);
@@ -56,6 +59,8 @@ class Alarm {
         bool trigger(MiLightClient*& client);
         void serialize(JsonObject &json, bool pretty);
         std::shared_ptr<Alarm> snooze(uint32_t newID, unsigned long currentTime, MiLightClient*& client, JsonObject& response);
+        // Easing stored with an alarm.  Alarms saved before easing existed are linear.
+        static TransitionEasing parseEasing(JsonVariant value);
     private:
         uint32_t id;
         String name;
@@ -68,6 +73,7 @@ class Alarm {
 
         GroupStateField field;
         uint16_t startValue, endValue;
+        TransitionEasing easing;
         DynamicJsonDocument initDoc;
         uint8_t snoozes;
     friend class AlarmController;
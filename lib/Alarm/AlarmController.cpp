@@ -74,17 +74,19 @@ void AlarmController::loop() {
             //Clear active transitions (possible running alarms) before starting the alarm
             transitions.clear();
             
-            activeAlarm = alarmList.shift();
-            if(activeAlarm->trigger(milightClient)) {
-                transitionID = transitions.getTransitions()->data->id;
+            Alarmptr alarm = alarmList.shift();
+            Transition* transition = alarm->trigger(milightClient) ? transitions.getTransitionAt(0) : nullptr;
+            if(transition != nullptr) {
+                activeAlarm = alarm;
+                transitionID = transition->id;
             } else {
                 Serial.println("Activating alarm failed!");
                 activeAlarm = nullptr;
                 transitionID = 0;
             }
             
-            if(activeAlarm->hasRepeat())
-                alarmList.add(activeAlarm->repeat());
+            if(alarm->hasRepeat())
+                alarmList.add(alarm->repeat());
         }
     }
 }
@@ -193,6 +195,14 @@ bool AlarmController::createAlarm(BulbId& buldId, JsonObject args, JsonDocument&
     }
     JsonVariant startValue = args[FS2(TransitionParams::START_VALUE)];
     JsonVariant endValue = args[FS2(TransitionParams::END_VALUE)];
+    TransitionEasing easing = EASING_LINEAR;
+    if(args.containsKey(FS2(TransitionParams::EASING))) {
+        easing = Easing::fromName(args[FS2(TransitionParams::EASING)].as<const char*>());
+        if(easing == EASING_UNKNOWN) {
+            response[F("error")] = F("Unknown transition easing");
+            return false;
+        }
+    }
     
     switch(field) {
         case GroupStateField::HUE:
@@ -203,7 +213,7 @@ bool AlarmController::createAlarm(BulbId& buldId, JsonObject args, JsonDocument&
         case GroupStateField::COLOR_TEMP:
             {
             Alarmptr alarm = std::make_shared<Alarm>(atomicID++, name, alias, utc_time-c_Epoch32OfOriginYear, repeatTime, duration, autoTurnOff, buldId,
-                field, startValue.as<uint16_t>(), endValue.as<uint16_t>(), init);
+                field, startValue.as<uint16_t>(), endValue.as<uint16_t>(), easing, init);
             alarmList.add(alarm);
             break;
             }
@@ -84,8 +84,9 @@ Alarmptr AlarmPersistence::get(uint32_t id) {
         GroupStateField field = GroupStateFieldHelpers::getFieldByName(doc["field"]);
         uint16_t startValue = doc["start_value"];
         uint16_t endValue = doc["end_value"];
+        TransitionEasing easing = Alarm::parseEasing(doc["easing"]);
         JsonObject initDoc = doc["init"];
-        return std::make_shared<Alarm>(id, name, alias, utc_time2000, repeatTime, duration, autoTurnOff, bulbId, field, startValue, endValue, initDoc);
+        return std::make_shared<Alarm>(id, name, alias, utc_time2000, repeatTime, duration, autoTurnOff, bulbId, field, startValue, endValue, easing, initDoc);
     } else
         //this alarm is not stored
         return NULL;
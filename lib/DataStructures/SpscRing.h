@@ -0,0 +1,85 @@
+/*
+ * Fixed-size ring buffer for exactly one producer and one consumer, e.g. an
+ * interrupt handler and the main loop.  Neither side ever blocks or
+ * allocates: push() fails (and counts an overflow) when the ring is full, and
+ * pop() fails when it's empty.
+ *
+ * Each side only ever writes its own index, so no locks are needed.  The
+ * release/acquire pairs make sure an entry is completely written before the
+ * consumer can see it, and completely read before the producer reuses it.
+ */
+
+#ifndef _SPSC_RING_H
+#define _SPSC_RING_H
+
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, size_t Capacity>
+class SpscRing {
+public:
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+  SpscRing()
+    : head(0),
+      tail(0),
+      overflows(0)
+  { }
+
+  // Producer side.  Returns false if the ring was full.  Always inlined, so
+  // that pushing from an interrupt handler in IRAM doesn't call into flash.
+  __attribute__((always_inline)) bool push(const T& item) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+
+    if (t - head.load(std::memory_order_acquire) == Capacity) {
+      overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    items[t & (Capacity - 1)] = item;
+    tail.store(t + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Consumer side.  Returns false if the ring was empty.
+  bool pop(T& item) {
+    const size_t h = head.load(std::memory_order_relaxed);
+
+    if (h == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    item = items[h & (Capacity - 1)];
+    head.store(h + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool isEmpty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  size_t size() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+
+  // Number of items the producer had to drop because the ring was full
+  size_t getOverflowCount() const {
+    return overflows.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Free-running counts of items popped and pushed.  Only the consumer writes
+  // head, and only the producer writes tail (and overflows).
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+  std::atomic<size_t> overflows;
+
+  T items[Capacity];
+
+  SpscRing(const SpscRing&);
+  SpscRing& operator=(const SpscRing&);
+};
+
+#endif
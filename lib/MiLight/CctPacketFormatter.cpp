@@ -220,6 +220,19 @@ BulbId CctPacketFormatter::parsePacket(const uint8_t* packet, JsonObject result)
   return bulbId;
 }
 
+PacketCommandClass CctPacketFormatter::classifyPacket(const uint8_t* packet, BulbId& bulbId) {
+  uint8_t onOffGroupId = cctCommandIdToGroup(packet[CCT_COMMAND_INDEX] & 0x7F);
+
+  bulbId = BulbId(
+    (packet[1] << 8) | packet[2],
+    onOffGroupId < 255 ? onOffGroupId : packet[3],
+    REMOTE_TYPE_CCT
+  );
+
+  // Every CCT command is a button press, relative to the bulb's current state
+  return PacketCommandClass::NONE;
+}
+
 void CctPacketFormatter::format(uint8_t const* packet, char* buffer) {
   PacketFormatter::formatV1Packet(packet, buffer);
 }
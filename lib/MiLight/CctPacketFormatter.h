@@ -47,6 +47,7 @@ public:
   virtual void initializePacket(uint8_t* packet);
   virtual void finalizePacket(uint8_t* packet);
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
+  virtual PacketCommandClass classifyPacket(const uint8_t* packet, BulbId& bulbId);
 
   static uint8_t getCctStatusButton(uint8_t groupId, MiLightStatus status);
   static uint8_t cctCommandIdToGroup(uint8_t command);
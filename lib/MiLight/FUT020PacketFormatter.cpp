@@ -85,4 +85,12 @@ BulbId FUT020PacketFormatter::parsePacket(const uint8_t* packet, JsonObject resu
   }
 
   return bulbId;
-}
\ No newline at end of file
+}
+
+PacketCommandClass FUT020PacketFormatter::classifyPacket(const uint8_t* packet, BulbId& bulbId) {
+  FUT020Command command = static_cast<FUT020Command>(packet[FUT02xPacketFormatter::FUT02X_COMMAND_INDEX] & 0x0F);
+
+  bulbId = BulbId((packet[1] << 8) | packet[2], 0, REMOTE_TYPE_FUT020);
+
+  return command == FUT020Command::COLOR ? PacketCommandClass::HUE : PacketCommandClass::NONE;
+}
@@ -27,4 +27,5 @@ public:
   virtual void decreaseBrightness();
 
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result) override;
+  virtual PacketCommandClass classifyPacket(const uint8_t* packet, BulbId& bulbId) override;
 };
\ No newline at end of file
@@ -154,3 +154,20 @@ BulbId FUT089PacketFormatter::parsePacket(const uint8_t *packet, JsonObject resu
 
   return bulbId;
 }
+
+PacketCommandClass FUT089PacketFormatter::classifyCommand(uint8_t command, uint8_t arg) const {
+  switch (command) {
+    case FUT089_COLOR:
+      return PacketCommandClass::HUE;
+    case FUT089_BRIGHTNESS:
+      return PacketCommandClass::BRIGHTNESS;
+    // Also kelvin.  Which one depends on the bulb mode when the packet lands,
+    // so these only ever replace each other.
+    case FUT089_SATURATION:
+      return PacketCommandClass::SATURATION;
+    case FUT089_MODE:
+      return PacketCommandClass::MODE;
+    default:
+      return PacketCommandClass::NONE;
+  }
+}
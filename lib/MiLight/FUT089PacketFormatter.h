@@ -40,6 +40,9 @@ public:
   virtual void updateMode(uint8_t mode);
 
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
+
+protected:
+  virtual PacketCommandClass classifyCommand(uint8_t command, uint8_t arg) const;
 };
 
 #endif
@@ -56,3 +56,14 @@ BulbId FUT091PacketFormatter::parsePacket(const uint8_t *packet, JsonObject resu
 
   return bulbId;
 }
+
+PacketCommandClass FUT091PacketFormatter::classifyCommand(uint8_t command, uint8_t arg) const {
+  switch (static_cast<FUT091Command>(command)) {
+    case FUT091Command::BRIGHTNESS:
+      return PacketCommandClass::BRIGHTNESS;
+    case FUT091Command::KELVIN:
+      return PacketCommandClass::TEMPERATURE;
+    default:
+      return PacketCommandClass::NONE;
+  }
+}
@@ -20,6 +20,9 @@ public:
   virtual void enableNightMode();
 
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
+
+protected:
+  virtual PacketCommandClass classifyCommand(uint8_t command, uint8_t arg) const;
 };
 
 #endif
@@ -0,0 +1,82 @@
+#include <ListenScheduler.h>
+#include <MiLightRemoteConfig.h>
+#include <algorithm>
+
+ListenScheduler::ListenScheduler(const std::vector<MiLightRemoteType>& remoteTypes)
+  : lastDecay(millis())
+{
+  memset(learnedWeights, 0, sizeof(learnedWeights));
+  memset(credits, 0, sizeof(credits));
+
+  bool anyEnabled = false;
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    enabled[i] = remoteTypes.empty();
+  }
+
+  for (MiLightRemoteType type : remoteTypes) {
+    const MiLightRemoteConfig* remote = MiLightRemoteConfig::fromType(type);
+
+    if (remote != NULL) {
+      enabled[&remote->radioConfig - MiLightRadioConfig::ALL_CONFIGS] = true;
+      anyEnabled = true;
+    }
+  }
+
+  // Don't go deaf if none of the remote types were valid
+  if (! remoteTypes.empty() && ! anyEnabled) {
+    for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+      enabled[i] = true;
+    }
+  }
+}
+
+size_t ListenScheduler::next() {
+  decay();
+
+  int16_t totalWeight = 0;
+  size_t selected = MiLightRadioConfig::NUM_CONFIGS;
+
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    if (enabled[i]) {
+      const uint8_t weight = getWeight(i);
+      credits[i] += weight;
+      totalWeight += weight;
+
+      if (selected == MiLightRadioConfig::NUM_CONFIGS || credits[i] > credits[selected]) {
+        selected = i;
+      }
+    }
+  }
+
+  credits[selected] -= totalWeight;
+  return selected;
+}
+
+void ListenScheduler::recordDecoded(size_t configIx) {
+  const uint8_t weight = learnedWeights[configIx] + LISTEN_SCHEDULER_HIT_WEIGHT;
+  learnedWeights[configIx] = std::min(weight, static_cast<uint8_t>(LISTEN_SCHEDULER_MAX_WEIGHT));
+}
+
+bool ListenScheduler::isEnabled(size_t configIx) const {
+  return enabled[configIx];
+}
+
+uint8_t ListenScheduler::getWeight(size_t configIx) const {
+  if (! enabled[configIx]) {
+    return 0;
+  }
+
+  return LISTEN_SCHEDULER_MIN_WEIGHT + learnedWeights[configIx];
+}
+
+void ListenScheduler::decay() {
+  const unsigned long now = millis();
+
+  if (now - lastDecay >= LISTEN_SCHEDULER_DECAY_INTERVAL) {
+    for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+      learnedWeights[i] /= 2;
+    }
+
+    lastDecay = now;
+  }
+}
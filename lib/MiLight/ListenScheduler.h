@@ -0,0 +1,69 @@
+#include <Arduino.h>
+#include <MiLightRadioConfig.h>
+#include <MiLightRemoteType.h>
+#include <vector>
+
+#ifndef _LISTEN_SCHEDULER_H
+#define _LISTEN_SCHEDULER_H
+
+// Share of listen slots every enabled radio config gets, however quiet it is
+#ifndef LISTEN_SCHEDULER_MIN_WEIGHT
+#define LISTEN_SCHEDULER_MIN_WEIGHT 1
+#endif
+
+// Weight a config gains each time a packet received with it is decoded
+#ifndef LISTEN_SCHEDULER_HIT_WEIGHT
+#define LISTEN_SCHEDULER_HIT_WEIGHT 1
+#endif
+
+// Most weight a config can gain from decoded packets.  Kept small: every bit
+// of extra time given to a busy config is taken from the quiet ones.
+#ifndef LISTEN_SCHEDULER_MAX_WEIGHT
+#define LISTEN_SCHEDULER_MAX_WEIGHT 2
+#endif
+
+// Learned weights are halved this often, so remotes that stop being used
+// stop taking listen time away from the others
+#ifndef LISTEN_SCHEDULER_DECAY_INTERVAL
+#define LISTEN_SCHEDULER_DECAY_INTERVAL 60000
+#endif
+
+/*
+ * Picks which radio config to listen with next.
+ *
+ * The radio can only listen for one config at a time, so each config only
+ * hears a fraction of the traffic on the air.  Rather than cycling through the
+ * configs evenly, this spends more time on configs that remotes have actually
+ * been heard on.  Every config keeps a minimum share so that a remote that's
+ * rarely used is still picked up.
+ *
+ * Configs are interleaved (smooth weighted round robin), so even the busiest
+ * config never holds the radio for several slots in a row.
+ */
+class ListenScheduler {
+public:
+  // Only listens with the configs used by the given remote types.  Listens
+  // with every config if the list is empty.
+  ListenScheduler(const std::vector<MiLightRemoteType>& remoteTypes);
+
+  // Index into MiLightRadioConfig::ALL_CONFIGS of the config to listen with next
+  size_t next();
+
+  // Call when a packet received with the given config came from a known remote
+  void recordDecoded(size_t configIx);
+
+  bool isEnabled(size_t configIx) const;
+
+  // Current weight of the given config.  0 if it's disabled.
+  uint8_t getWeight(size_t configIx) const;
+
+private:
+  bool enabled[MiLightRadioConfig::NUM_CONFIGS];
+  uint8_t learnedWeights[MiLightRadioConfig::NUM_CONFIGS];
+  int16_t credits[MiLightRadioConfig::NUM_CONFIGS];
+  unsigned long lastDecay;
+
+  void decay();
+};
+
+#endif
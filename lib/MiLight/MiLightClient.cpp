@@ -6,63 +6,172 @@
 #include <TokenIterator.h>
 #include <ParsedColor.h>
 #include <MiLightCommands.h>
+#include <Size.h>
 #include <functional>
 
 using namespace std::placeholders;
 
 static const uint8_t STATUS_UNDEFINED = 255;
 
-const char* MiLightClient::FIELD_ORDERINGS[] = {
+// Order update() applies keys in, whatever order the request has them in
+enum UpdateStep : uint8_t {
   // These are handled manually
-  // GroupStateFieldNames::STATE,
-  // GroupStateFieldNames::STATUS,
-  GroupStateFieldNames::HUE,
-  GroupStateFieldNames::SATURATION,
-  GroupStateFieldNames::KELVIN,
-  GroupStateFieldNames::TEMPERATURE,
-  GroupStateFieldNames::COLOR_TEMP,
-  GroupStateFieldNames::MODE,
-  GroupStateFieldNames::EFFECT,
-  GroupStateFieldNames::COLOR,
+  STEP_STATUS,
+  STEP_STATE,
+  STEP_TRANSITION,
+
+  STEP_HUE,
+  STEP_SATURATION,
+  STEP_KELVIN,
+  STEP_TEMPERATURE,
+  STEP_COLOR_TEMP,
+  STEP_MODE,
+  STEP_EFFECT,
+  STEP_COLOR,
   // Level/Brightness must be processed last because they're specific to a particular bulb mode.
   // So make sure bulb mode is set before applying level/brightness.
-  GroupStateFieldNames::LEVEL,
-  GroupStateFieldNames::BRIGHTNESS,
-  GroupStateFieldNames::COMMAND,
-  GroupStateFieldNames::COMMANDS
+  STEP_LEVEL,
+  STEP_BRIGHTNESS,
+  STEP_COMMAND,
+  STEP_COMMANDS,
+
+  // Raw packet command/args
+  STEP_BUTTON_ID,
+  STEP_ARGUMENT,
+
+  NUM_UPDATE_STEPS
 };
 
-const std::map<const char*, std::function<void(MiLightClient*, JsonVariant)>, MiLightClient::cmp_str> MiLightClient::FIELD_SETTERS = {
+// Keys that lower into a MiLightCommand field
+static const uint8_t FIRST_FIELD_STEP = STEP_HUE;
+static const uint8_t LAST_FIELD_STEP = STEP_BRIGHTNESS;
+
+struct UpdateField {
+  const char* name;
+  UpdateStep step;
+  // NULL for keys update() handles itself
+  void (*lower)(MiLightCommand& command, JsonVariant value);
+};
+
+static void lowerEffect(MiLightCommand& command, const String& effect) {
+  if (effect == MiLightCommandNames::NIGHT_MODE) {
+    command.setEffect(MiLightCommand::EFFECT_NIGHT_MODE);
+  } else if (effect == "white" || effect == "white_mode") {
+    command.setEffect(MiLightCommand::EFFECT_WHITE);
+  } else { // assume we're trying to set mode
+    command.setEffect(MiLightCommand::EFFECT_MODE, effect.toInt());
+  }
+}
+
+// Sorted by name, so keys can be found with a binary search.  Checked by
+// test_update_keys_are_sorted.
+static const UpdateField UPDATE_FIELDS[] = {
+  {"argument", STEP_ARGUMENT, NULL},
   {
-    GroupStateFieldNames::STATUS,
-    [](MiLightClient* client, JsonVariant val) {
-      client->updateStatus(parseMilightStatus(val));
-    }
+    GroupStateFieldNames::BRIGHTNESS, STEP_BRIGHTNESS,
+    [](MiLightCommand& command, JsonVariant val) { command.setBrightness(val.as<uint8_t>()); }
   },
-  {GroupStateFieldNames::LEVEL, &MiLightClient::updateBrightness},
+  {"button_id", STEP_BUTTON_ID, NULL},
   {
-    GroupStateFieldNames::BRIGHTNESS,
-    [](MiLightClient* client, uint16_t arg) {
-      client->updateBrightness(Units::rescale<uint16_t, uint16_t>(arg, 100, 255));
+    GroupStateFieldNames::COLOR, STEP_COLOR,
+    [](MiLightCommand& command, JsonVariant val) {
+      ParsedColor color = ParsedColor::fromJson(val);
+
+      if (!color.success) {
+        Serial.println(F("Error parsing color field, unrecognized format"));
+        return;
+      }
+
+      command.setColor(color);
     }
   },
-  {GroupStateFieldNames::HUE, &MiLightClient::updateHue},
-  {GroupStateFieldNames::SATURATION, &MiLightClient::updateSaturation},
-  {GroupStateFieldNames::KELVIN, &MiLightClient::updateTemperature},
-  {GroupStateFieldNames::TEMPERATURE, &MiLightClient::updateTemperature},
   {
-    GroupStateFieldNames::COLOR_TEMP,
-    [](MiLightClient* client, uint16_t arg) {
-      client->updateTemperature(Units::miredsToWhiteVal(arg, 100));
-    }
+    GroupStateFieldNames::COLOR_TEMP, STEP_COLOR_TEMP,
+    [](MiLightCommand& command, JsonVariant val) { command.setColorTemp(val.as<uint16_t>()); }
+  },
+  {GroupStateFieldNames::COMMAND, STEP_COMMAND, NULL},
+  {GroupStateFieldNames::COMMANDS, STEP_COMMANDS, NULL},
+  {
+    GroupStateFieldNames::EFFECT, STEP_EFFECT,
+    [](MiLightCommand& command, JsonVariant val) { lowerEffect(command, val.as<String>()); }
+  },
+  {
+    GroupStateFieldNames::HUE, STEP_HUE,
+    [](MiLightCommand& command, JsonVariant val) { command.setHue(val.as<uint16_t>()); }
+  },
+  {
+    GroupStateFieldNames::KELVIN, STEP_KELVIN,
+    [](MiLightCommand& command, JsonVariant val) { command.setKelvin(val.as<uint8_t>()); }
+  },
+  {
+    GroupStateFieldNames::LEVEL, STEP_LEVEL,
+    [](MiLightCommand& command, JsonVariant val) { command.setLevel(val.as<uint8_t>()); }
+  },
+  {
+    GroupStateFieldNames::MODE, STEP_MODE,
+    [](MiLightCommand& command, JsonVariant val) { command.setMode(val.as<uint8_t>()); }
+  },
+  {
+    GroupStateFieldNames::SATURATION, STEP_SATURATION,
+    [](MiLightCommand& command, JsonVariant val) { command.setSaturation(val.as<uint8_t>()); }
+  },
+  {GroupStateFieldNames::STATE, STEP_STATE, NULL},
+  {GroupStateFieldNames::STATUS, STEP_STATUS, NULL},
+  // An alias for kelvin
+  {
+    GroupStateFieldNames::TEMPERATURE, STEP_TEMPERATURE,
+    [](MiLightCommand& command, JsonVariant val) { command.setKelvin(val.as<uint8_t>()); }
   },
-  {GroupStateFieldNames::MODE, &MiLightClient::updateMode},
-  {GroupStateFieldNames::COLOR, &MiLightClient::updateColor},
-  {GroupStateFieldNames::EFFECT, &MiLightClient::handleEffect},
-  {GroupStateFieldNames::COMMAND, &MiLightClient::handleCommand},
-  {GroupStateFieldNames::COMMANDS, &MiLightClient::handleCommands}
+  {RequestKeys::TRANSITION, STEP_TRANSITION, NULL}
+};
+
+// Keys of one update() request, found in one pass through it.  Keeps
+// iterators rather than JsonVariants, because assigning to a JsonVariant
+// writes to the value it refers to instead of rebinding it.
+struct UpdateKeys {
+  const UpdateField* fields[NUM_UPDATE_STEPS];
+  JsonObject::iterator positions[NUM_UPDATE_STEPS];
+
+  UpdateKeys() : fields() { }
+
+  bool has(uint8_t step) const {
+    return fields[step] != NULL;
+  }
+
+  // Null if the request doesn't have the key
+  JsonVariant value(uint8_t step) const {
+    return has(step) ? (*positions[step]).value() : JsonVariant();
+  }
 };
 
+static const UpdateField* findUpdateField(const char* key) {
+  size_t low = 0;
+  size_t high = size(UPDATE_FIELDS);
+
+  while (low < high) {
+    const size_t mid = (low + high) / 2;
+    const int cmp = strcmp(key, UPDATE_FIELDS[mid].name);
+
+    if (cmp == 0) {
+      return &UPDATE_FIELDS[mid];
+    } else if (cmp < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+
+  return NULL;
+}
+
+size_t MiLightClient::getNumUpdateKeys() {
+  return size(UPDATE_FIELDS);
+}
+
+const char* MiLightClient::getUpdateKey(size_t index) {
+  return UPDATE_FIELDS[index].name;
+}
+
 MiLightClient::MiLightClient(
   RadioSwitchboard& radioSwitchboard,
   PacketSender& packetSender,
@@ -288,6 +397,10 @@ void MiLightClient::updateColor(JsonVariant json) {
     return;
   }
 
+  updateColor(color);
+}
+
+void MiLightClient::updateColor(const ParsedColor& color) {
   // We consider an RGB color "white" if all color intensities are roughly the
   // same value.  An unscientific value of 10 (~4%) is chosen.
   if ( abs(color.r - color.g) < RGB_WHITE_THRESHOLD
@@ -300,32 +413,93 @@ void MiLightClient::updateColor(JsonVariant json) {
   }
 }
 
+void MiLightClient::apply(const MiLightCommand& command) {
+  prepare(command.bulbId.deviceType, command.bulbId.deviceId, command.bulbId.groupId);
+
+  if (this->updateBeginHandler) {
+    this->updateBeginHandler();
+  }
+
+  applyFields(command);
+  applyStatusOff(command);
+
+  if (this->updateEndHandler) {
+    this->updateEndHandler();
+  }
+}
+
 void MiLightClient::update(JsonObject request) {
   if (this->updateBeginHandler) {
     this->updateBeginHandler();
   }
 
-  const JsonVariant status = this->extractStatus(request);
-  const uint8_t parsedStatus = this->parseStatus(status);
-  const JsonVariant jsonTransition = request[RequestKeys::TRANSITION];
-  float transition = 0;
+  UpdateKeys keys;
+
+  for (JsonObject::iterator it = request.begin(); it != request.end(); ++it) {
+    const UpdateField* field = findUpdateField((*it).key().c_str());
+
+    if (field != NULL) {
+      keys.fields[field->step] = field;
+      keys.positions[field->step] = it;
+    }
+  }
+
+  MiLightCommand command(currentRemote->packetFormatter->currentBulbId());
+  const JsonVariant status = keys.value(STEP_STATUS).isUndefined() ? keys.value(STEP_STATE) : keys.value(STEP_STATUS);
+  const JsonVariant jsonTransition = keys.value(STEP_TRANSITION);
+
+  if (!status.isUndefined()) {
+    command.setStatus(parseMilightStatus(status));
+  }
 
   if (!jsonTransition.isNull()) {
     if (jsonTransition.is<float>()) {
-      transition = jsonTransition.as<float>();
+      command.setTransition(jsonTransition.as<float>());
     } else if (jsonTransition.is<size_t>()) {
-      transition = jsonTransition.as<size_t>();
+      command.setTransition(jsonTransition.as<size_t>());
     } else {
       Serial.println(F("MiLightClient - WARN: unsupported transition type.  Must be float or int."));
     }
   }
 
-  JsonVariant brightness = request[GroupStateFieldNames::BRIGHTNESS];
-  JsonVariant level = request[GroupStateFieldNames::LEVEL];
-  const bool isBrightnessDefined = !brightness.isUndefined() || !level.isUndefined();
+  // Steps are in application order, so of two keys for the same field the
+  // later one wins (temperature over kelvin)
+  for (uint8_t step = FIRST_FIELD_STEP; step <= LAST_FIELD_STEP; step++) {
+    if (keys.has(step)) {
+      keys.fields[step]->lower(command, keys.value(step));
+    }
+  }
+
+  applyFields(command);
+
+  // Commands can't be transitioned
+  if (command.transition == 0) {
+    if (keys.has(STEP_COMMAND)) {
+      this->handleCommand(keys.value(STEP_COMMAND));
+    }
+    if (keys.has(STEP_COMMANDS)) {
+      this->handleCommands(keys.value(STEP_COMMANDS).as<JsonArray>());
+    }
+  }
+
+  // Raw packet command/args
+  if (keys.has(STEP_BUTTON_ID) && keys.has(STEP_ARGUMENT)) {
+    this->command(keys.value(STEP_BUTTON_ID), keys.value(STEP_ARGUMENT));
+  }
+
+  applyStatusOff(command);
+
+  if (this->updateEndHandler) {
+    this->updateEndHandler();
+  }
+}
+
+void MiLightClient::applyFields(const MiLightCommand& command) {
+  const float transition = command.transition;
+  const bool isBrightnessDefined = command.has(MiLightCommand::BRIGHTNESS) || command.has(MiLightCommand::LEVEL);
 
   // Always turn on first
-  if (parsedStatus == ON) {
+  if (command.has(MiLightCommand::STATUS) && command.status == ON) {
     if (transition == 0) {
       this->updateStatus(ON);
     }
@@ -342,58 +516,121 @@ void MiLightClient::update(JsonObject request) {
       // transitions only ramp up/down to the max/min.  Otherwise, just turn the bulb on
       // and let field transitions handle the rest.
       if (!isBrightnessDefined) {
-        handleTransition(GroupStateField::STATUS, status, transition, 0);
+        handleTransition(GroupStateField::STATUS, ON, transition, 0);
       } else {
         this->updateStatus(ON);
 
-        if (! brightness.isUndefined()) {
-          handleTransition(GroupStateField::BRIGHTNESS, brightness, transition, 0);
-        } else if (! level.isUndefined()) {
-          handleTransition(GroupStateField::LEVEL, level, transition, 0);
+        if (command.has(MiLightCommand::BRIGHTNESS)) {
+          handleTransition(GroupStateField::BRIGHTNESS, command.brightness, transition, 0);
+        } else {
+          handleTransition(GroupStateField::LEVEL, command.level, transition, 0);
         }
       }
     }
   }
 
-  for (const char* fieldName : FIELD_ORDERINGS) {
-    if (request.containsKey(fieldName)) {
-      auto handler = FIELD_SETTERS.find(fieldName);
-      JsonVariant value = request[fieldName];
+  for (uint16_t bit = MiLightCommand::HUE; bit <= MiLightCommand::BRIGHTNESS; bit <<= 1) {
+    const MiLightCommand::Field field = static_cast<MiLightCommand::Field>(bit);
 
-      if (handler != FIELD_SETTERS.end()) {
-        // No transition -- set field directly
-        if (transition == 0) {
-          handler->second(this, value);
-        } else {
-          GroupStateField field = GroupStateFieldHelpers::getFieldByName(fieldName);
-
-          if (   !GroupStateFieldHelpers::isBrightnessField(field)  // If field isn't brightness
-               || parsedStatus == STATUS_UNDEFINED                  // or if there was not a status field
-               || currentState->isOn()                              // or if bulb was already on
-          ) {
-            handleTransition(field, value, transition);
-          }
-        }
-      }
+    if (! command.has(field)) {
+      continue;
     }
-  }
 
-  // Raw packet command/args
-  if (request.containsKey("button_id") && request.containsKey("argument")) {
-    this->command(request["button_id"], request["argument"]);
+    // No transition -- set field directly
+    if (transition == 0) {
+      applyField(command, field);
+    } else if (   (field != MiLightCommand::BRIGHTNESS && field != MiLightCommand::LEVEL)
+               || !command.has(MiLightCommand::STATUS)  // or if there was not a status field
+               || currentState->isOn()                  // or if bulb was already on
+    ) {
+      transitionField(command, field);
+    }
   }
+}
 
+void MiLightClient::applyStatusOff(const MiLightCommand& command) {
   // Always turn off last
-  if (parsedStatus == OFF) {
-    if (transition == 0) {
+  if (command.has(MiLightCommand::STATUS) && command.status == OFF) {
+    if (command.transition == 0) {
       this->updateStatus(OFF);
     } else {
-      handleTransition(GroupStateField::STATUS, status, transition);
+      handleTransition(GroupStateField::STATUS, OFF, command.transition);
     }
   }
+}
 
-  if (this->updateEndHandler) {
-    this->updateEndHandler();
+void MiLightClient::applyField(const MiLightCommand& command, MiLightCommand::Field field) {
+  switch (field) {
+    case MiLightCommand::HUE:
+      this->updateHue(command.hue);
+      break;
+    case MiLightCommand::SATURATION:
+      this->updateSaturation(command.saturation);
+      break;
+    case MiLightCommand::KELVIN:
+      this->updateTemperature(command.kelvin);
+      break;
+    case MiLightCommand::COLOR_TEMP:
+      this->updateTemperature(Units::miredsToWhiteVal(command.colorTemp, 100));
+      break;
+    case MiLightCommand::MODE:
+      this->updateMode(command.mode);
+      break;
+    case MiLightCommand::EFFECT:
+      if (command.effect == MiLightCommand::EFFECT_NIGHT_MODE) {
+        this->enableNightMode();
+      } else if (command.effect == MiLightCommand::EFFECT_WHITE) {
+        this->updateColorWhite();
+      } else {
+        this->updateMode(command.effectMode);
+      }
+      break;
+    case MiLightCommand::COLOR:
+      this->updateColor(command.color);
+      break;
+    case MiLightCommand::LEVEL:
+      this->updateBrightness(command.level);
+      break;
+    case MiLightCommand::BRIGHTNESS:
+      this->updateBrightness(Units::rescale<uint16_t, uint16_t>(command.brightness, 100, 255));
+      break;
+    default:
+      break;
+  }
+}
+
+void MiLightClient::transitionField(const MiLightCommand& command, MiLightCommand::Field field) {
+  const float duration = command.transition;
+
+  switch (field) {
+    case MiLightCommand::HUE:
+      handleTransition(GroupStateField::HUE, command.hue, duration);
+      break;
+    case MiLightCommand::SATURATION:
+      handleTransition(GroupStateField::SATURATION, command.saturation, duration);
+      break;
+    case MiLightCommand::KELVIN:
+      handleTransition(GroupStateField::KELVIN, command.kelvin, duration);
+      break;
+    case MiLightCommand::COLOR_TEMP:
+      handleTransition(GroupStateField::COLOR_TEMP, command.colorTemp, duration);
+      break;
+    case MiLightCommand::MODE:
+      handleTransition(GroupStateField::MODE, command.mode, duration);
+      break;
+    case MiLightCommand::COLOR:
+      handleTransition(command.color, duration);
+      break;
+    case MiLightCommand::LEVEL:
+      handleTransition(GroupStateField::LEVEL, command.level, duration);
+      break;
+    case MiLightCommand::BRIGHTNESS:
+      handleTransition(GroupStateField::BRIGHTNESS, command.brightness, duration);
+      break;
+    // Effects can't be transitioned, so they're applied straight away
+    default:
+      applyField(command, field);
+      break;
   }
 }
 
@@ -454,8 +691,17 @@ void MiLightClient::handleCommand(JsonVariant command) {
 }
 
 void MiLightClient::handleTransition(GroupStateField field, JsonVariant value, float duration, int16_t startValue) {
+  if (field == GroupStateField::COLOR) {
+    handleTransition(ParsedColor::fromJson(value), duration);
+  } else if (field == GroupStateField::STATUS || field == GroupStateField::STATE) {
+    handleTransition(field, parseMilightStatus(value), duration, startValue);
+  } else {
+    handleTransition(field, value.as<uint16_t>(), duration, startValue);
+  }
+}
+
+void MiLightClient::handleTransition(GroupStateField field, uint16_t value, float duration, int16_t startValue) {
   BulbId bulbId = currentRemote->packetFormatter->currentBulbId();
-  std::shared_ptr<Transition::Builder> transitionBuilder = nullptr;
 
   if (currentState == nullptr) {
     Serial.println(F("Error planning transition: could not find current bulb state."));
@@ -467,18 +713,9 @@ void MiLightClient::handleTransition(GroupStateField field, JsonVariant value, f
     return;
   }
 
-  if (field == GroupStateField::COLOR) {
-    ParsedColor currentColor = currentState->getColor();
-    ParsedColor endColor = ParsedColor::fromJson(value);
-
-    transitionBuilder = transitions.buildColorTransition(
-      bulbId,
-      currentColor,
-      endColor
-    );
-  } else if (field == GroupStateField::STATUS || field == GroupStateField::STATE) {
+  if (field == GroupStateField::STATUS || field == GroupStateField::STATE) {
     uint8_t startLevel;
-    MiLightStatus status = parseMilightStatus(value);
+    MiLightStatus status = static_cast<MiLightStatus>(value);
 
     if (startValue == FETCH_VALUE_FROM_STATE || currentState->isOn()) {
       startLevel = currentState->getBrightness();
@@ -486,10 +723,9 @@ void MiLightClient::handleTransition(GroupStateField field, JsonVariant value, f
       startLevel = startValue;
     }
 
-    transitionBuilder = transitions.buildStatusTransition(bulbId, status, startLevel);
+    startTransition(transitions.buildStatusTransition(bulbId, status, startLevel), duration);
   } else {
     uint16_t currentValue;
-    uint16_t endValue = value;
 
     if (startValue == FETCH_VALUE_FROM_STATE/* || currentState->isOn()*/) {
       currentValue = currentState->getParsedFieldValue(field);
@@ -497,23 +733,82 @@ void MiLightClient::handleTransition(GroupStateField field, JsonVariant value, f
       currentValue = startValue;
     }
 
-    transitionBuilder = transitions.buildFieldTransition(
-      bulbId,
-      field,
-      currentValue,
-      endValue
-    );
+    startTransition(transitions.buildFieldTransition(bulbId, field, currentValue, value), duration);
   }
+}
 
-  if (transitionBuilder == nullptr) {
-    Serial.printf_P(PSTR("Unsupported transition field: %s\n"), GroupStateFieldHelpers::getFieldName(field));
+void MiLightClient::handleTransition(const ParsedColor& endColor, float duration) {
+  BulbId bulbId = currentRemote->packetFormatter->currentBulbId();
+
+  if (currentState == nullptr) {
+    Serial.println(F("Error planning transition: could not find current bulb state."));
+    return;
+  }
+
+  if (!currentState->isSetField(GroupStateField::COLOR)) {
+    Serial.println(F("Error planning transition: current state for field could not be determined"));
     return;
   }
 
-  transitionBuilder->setDuration(duration);
-  transitions.addTransition(transitionBuilder->build());
+  startTransition(transitions.buildColorTransition(bulbId, currentState->getColor(), endColor), duration);
+}
+
+bool MiLightClient::canTransitionBetween(GroupStateField field) {
+  switch (field) {
+    case GroupStateField::HUE:
+    case GroupStateField::SATURATION:
+    case GroupStateField::BRIGHTNESS:
+    case GroupStateField::LEVEL:
+    case GroupStateField::KELVIN:
+    case GroupStateField::COLOR_TEMP:
+    case GroupStateField::STATUS:
+    case GroupStateField::STATE:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool MiLightClient::transitionBetween(GroupStateField field, uint16_t startValue, uint16_t endValue, float duration, uint16_t period, TransitionEasing easing) {
+  const BulbId& bulbId = currentRemote->packetFormatter->currentBulbId();
+
+  switch (field) {
+    // These fields can be transitioned directly.
+    case GroupStateField::HUE:
+    case GroupStateField::SATURATION:
+    case GroupStateField::BRIGHTNESS:
+    case GroupStateField::LEVEL:
+    case GroupStateField::KELVIN:
+    case GroupStateField::COLOR_TEMP:
+      return startTransition(transitions.buildFieldTransition(bulbId, field, startValue, endValue), duration, period, easing);
+
+    // Status is handled a little differently
+    case GroupStateField::STATUS:
+    case GroupStateField::STATE: {
+      MiLightStatus toStatus = static_cast<MiLightStatus>(endValue);
+      uint8_t startLevel;
+
+      if (currentState->isSetBrightness()) {
+        startLevel = currentState->getBrightness();
+      } else if (toStatus == ON) {
+        startLevel = 0;
+      } else {
+        startLevel = 100;
+      }
+
+      return startTransition(transitions.buildStatusTransition(bulbId, toStatus, startLevel), duration, period, easing);
+    }
+
+    default:
+      return false;
+  }
 }
 
+// Room for the longest transition error message and any known field name.
+// Longer (unknown) names are cut short.
+static const size_t TRANSITION_ERROR_LENGTH = 64;
+
 bool MiLightClient::handleTransition(JsonObject args, JsonDocument& responseObj) {
   if (! args.containsKey(FS2(TransitionParams::FIELD))
     || ! args.containsKey(FS2(TransitionParams::END_VALUE))) {
@@ -526,36 +821,31 @@ bool MiLightClient::handleTransition(JsonObject args, JsonDocument& responseObj)
   JsonVariant startValue = args[FS2(TransitionParams::START_VALUE)];
   JsonVariant endValue = args[FS2(TransitionParams::END_VALUE)];
   GroupStateField field = GroupStateFieldHelpers::getFieldByName(fieldName);
-  std::shared_ptr<Transition::Builder> transitionBuilder = nullptr;
+  float duration = 0;
+  uint16_t period = 0;
+  TransitionEasing easing = EASING_LINEAR;
 
   if (field == GroupStateField::UNKNOWN) {
-    char errorMsg[30];
-    sprintf_P(errorMsg, PSTR("Unknown transition field: %s\n"), fieldName);
+    char errorMsg[TRANSITION_ERROR_LENGTH];
+    snprintf_P(errorMsg, sizeof(errorMsg), PSTR("Unknown transition field: %s\n"), fieldName);
     responseObj[F("error")] = errorMsg;
     return false;
   }
 
-  // These fields can be transitioned directly.
-  switch (field) {
-    case GroupStateField::HUE:
-    case GroupStateField::SATURATION:
-    case GroupStateField::BRIGHTNESS:
-    case GroupStateField::LEVEL:
-    case GroupStateField::KELVIN:
-    case GroupStateField::COLOR_TEMP:
-
-      transitionBuilder = transitions.buildFieldTransition(
-        bulbId,
-        field,
-        startValue.isUndefined()
-          ? currentState->getParsedFieldValue(field)
-          : startValue.as<uint16_t>(),
-        endValue
-      );
-      break;
+  if (args.containsKey(FS2(TransitionParams::DURATION))) {
+    duration = args[FS2(TransitionParams::DURATION)];
+  }
+  if (args.containsKey(FS2(TransitionParams::PERIOD))) {
+    period = args[FS2(TransitionParams::PERIOD)];
+  }
+  if (args.containsKey(FS2(TransitionParams::EASING))) {
+    const char* easingName = args[FS2(TransitionParams::EASING)];
+    easing = Easing::fromName(easingName);
 
-    default:
-      break;
+    if (easing == EASING_UNKNOWN) {
+      responseObj[F("error")] = F("Unknown transition easing");
+      return false;
+    }
   }
 
   // Color can be decomposed into hue/saturation and these can be transitioned separately
@@ -574,54 +864,56 @@ bool MiLightClient::handleTransition(JsonObject args, JsonDocument& responseObj)
       return false;
     }
 
-    transitionBuilder = transitions.buildColorTransition(
-      bulbId,
-      _startValue,
-      endColor
-    );
+    if (! startTransition(transitions.buildColorTransition(bulbId, _startValue, endColor), duration, period, easing)) {
+      responseObj[F("error")] = F("Too many active transitions");
+      return false;
+    }
+    return true;
   }
 
-  // Status is handled a little differently
-  if (field == GroupStateField::STATUS || field == GroupStateField::STATE) {
-    MiLightStatus toStatus = parseMilightStatus(endValue);
-    uint8_t startLevel;
-    if (currentState->isSetBrightness()) {
-      startLevel = currentState->getBrightness();
-    } else if (toStatus == ON) {
-      startLevel = 0;
-    } else {
-      startLevel = 100;
-    }
+  bool isStatus = field == GroupStateField::STATUS || field == GroupStateField::STATE;
+  uint16_t start = 0;
 
-    transitionBuilder = transitions.buildStatusTransition(bulbId, toStatus, startLevel);
+  if (! isStatus) {
+    start = startValue.isUndefined()
+      ? currentState->getParsedFieldValue(field)
+      : startValue.as<uint16_t>();
   }
 
-  if (transitionBuilder == nullptr) {
-    char errorMsg[30];
-    sprintf_P(errorMsg, PSTR("Recognized, but unsupported transition field: %s\n"), fieldName);
+  uint16_t end = isStatus ? parseMilightStatus(endValue) : endValue.as<uint16_t>();
+
+  if (! canTransitionBetween(field)) {
+    char errorMsg[TRANSITION_ERROR_LENGTH];
+    snprintf_P(errorMsg, sizeof(errorMsg), PSTR("Recognized, but unsupported transition field: %s\n"), fieldName);
     responseObj[F("error")] = errorMsg;
     return false;
   }
 
-  if (args.containsKey(FS2(TransitionParams::DURATION))) {
-    transitionBuilder->setDuration(args[FS2(TransitionParams::DURATION)]);
-  }
-  if (args.containsKey(FS2(TransitionParams::PERIOD))) {
-    transitionBuilder->setPeriod(args[FS2(TransitionParams::PERIOD)]);
+  if (! transitionBetween(field, start, end, duration, period, easing)) {
+    responseObj[F("error")] = F("Too many active transitions");
+    return false;
   }
 
-  transitions.addTransition(transitionBuilder->build());
   return true;
 }
 
-void MiLightClient::handleEffect(const String& effect) {
-  if (effect == MiLightCommandNames::NIGHT_MODE) {
-    this->enableNightMode();
-  } else if (effect == "white" || effect == "white_mode") {
-    this->updateColorWhite();
-  } else { // assume we're trying to set mode
-    this->updateMode(effect.toInt());
+bool MiLightClient::startTransition(Transition::Builder builder, float duration, uint16_t period, TransitionEasing easing) {
+  builder.setEasing(easing);
+
+  if (duration > 0) {
+    builder.setDuration(duration);
+  }
+  if (period > 0) {
+    builder.setPeriod(period);
   }
+
+  return transitions.addTransition(builder) != nullptr;
+}
+
+void MiLightClient::handleEffect(const String& effect) {
+  MiLightCommand command;
+  lowerEffect(command, effect);
+  applyField(command, MiLightCommand::EFFECT);
 }
 
 JsonVariant MiLightClient::extractStatus(JsonObject object) {
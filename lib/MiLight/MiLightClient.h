@@ -7,8 +7,8 @@
 #include <GroupStateStore.h>
 #include <PacketSender.h>
 #include <TransitionController.h>
+#include <MiLightCommand.h>
 #include <cstring>
-#include <map>
 #include <set>
 
 #ifndef _MILIGHTCLIENT_H
@@ -29,6 +29,7 @@ namespace TransitionParams {
   static const char END_VALUE[] PROGMEM = "end_value";
   static const char DURATION[] PROGMEM = "duration";
   static const char PERIOD[] PROGMEM = "period";
+  static const char EASING[] PROGMEM = "easing";
 }
 
 // Used to determine RGB colros that are approximately white
@@ -81,6 +82,7 @@ public:
   void updateColorRaw(const uint8_t color);
   void enableNightMode();
   void updateColor(JsonVariant json);
+  void updateColor(const ParsedColor& color);
 
   // CCT methods
   void updateTemperature(const uint8_t colorTemperature);
@@ -91,11 +93,25 @@ public:
 
   void updateSaturation(const uint8_t saturation);
 
+  // Prepares for the command's bulb and applies it.  The typed counterpart of
+  // update(), for callers that don't start from JSON.
+  void apply(const MiLightCommand& command);
+
   void update(JsonObject object);
+  // Keys update() understands, in the order it looks them up in (by strcmp)
+  static size_t getNumUpdateKeys();
+  static const char* getUpdateKey(size_t index);
   void handleCommand(JsonVariant command);
   void handleCommands(JsonArray commands);
   bool handleTransition(JsonObject args, JsonDocument& responseObj);
   void handleTransition(GroupStateField field, JsonVariant value, float duration, int16_t startValue = FETCH_VALUE_FROM_STATE);
+  void handleTransition(GroupStateField field, uint16_t value, float duration, int16_t startValue = FETCH_VALUE_FROM_STATE);
+  void handleTransition(const ParsedColor& endColor, float duration);
+  // Transitions a field between explicit values.  A duration or period of 0
+  // leaves the default.  Returns false if the field can't be transitioned
+  // (see canTransitionBetween()), or if too many transitions are running.
+  bool transitionBetween(GroupStateField field, uint16_t startValue, uint16_t endValue, float duration, uint16_t period, TransitionEasing easing = EASING_LINEAR);
+  static bool canTransitionBetween(GroupStateField field);
   void handleEffect(const String& effect);
 
   void onUpdateBegin(EventHandler handler);
@@ -116,14 +132,6 @@ public:
   JsonVariant extractStatus(JsonObject object);
 
 protected:
-  struct cmp_str {
-    bool operator()(char const *a, char const *b) const {
-        return std::strcmp(a, b) < 0;
-    }
-  };
-  static const std::map<const char*, std::function<void(MiLightClient*, JsonVariant)>, cmp_str> FIELD_SETTERS;
-  static const char* FIELD_ORDERINGS[];
-
   RadioSwitchboard& radioSwitchboard;
   std::vector<std::shared_ptr<MiLightRadio>> radios;
   std::shared_ptr<MiLightRadio> currentRadio;
@@ -142,6 +150,14 @@ protected:
   size_t repeatsOverride;
 
   void flushPacket();
+
+  void applyFields(const MiLightCommand& command);
+  void applyStatusOff(const MiLightCommand& command);
+  void applyField(const MiLightCommand& command, MiLightCommand::Field field);
+  void transitionField(const MiLightCommand& command, MiLightCommand::Field field);
+  // A duration or period of 0 leaves the builder's default.  Returns false if
+  // too many transitions are running to start another.
+  bool startTransition(Transition::Builder builder, float duration, uint16_t period = 0, TransitionEasing easing = EASING_LINEAR);
 };
 
 #endif
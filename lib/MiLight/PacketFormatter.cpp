@@ -1,6 +1,8 @@
 #include <PacketFormatter.h>
 
-static uint8_t* PACKET_BUFFER = new uint8_t[PACKET_FORMATTER_BUFFER_SIZE];
+// Statically allocated so that the address is fixed before any of the global
+// formatters (see MiLightRemoteConfig.cpp) are constructed.
+static uint8_t PACKET_BUFFER[PACKET_FORMATTER_BUFFER_SIZE];
 
 PacketStream::PacketStream()
     : packetStream(PACKET_BUFFER),
@@ -185,4 +187,9 @@ size_t PacketFormatter::getPacketLength() const {
 
 BulbId PacketFormatter::currentBulbId() const {
   return BulbId(deviceId, groupId, deviceType);
+}
+
+PacketCommandClass PacketFormatter::classifyPacket(const uint8_t* packet, BulbId& bulbId) {
+  bulbId = DEFAULT_BULB_ID;
+  return PacketCommandClass::NONE;
 }
\ No newline at end of file
@@ -15,6 +15,17 @@
 //   (10 * 7) + (10 * 7) = 140
 #define PACKET_FORMATTER_BUFFER_SIZE 140
 
+// Commands which set a field to an absolute value.  A newer packet of the same
+// class for the same bulb makes an older one redundant.
+enum class PacketCommandClass {
+  NONE,
+  BRIGHTNESS,
+  HUE,
+  SATURATION,
+  TEMPERATURE,
+  MODE
+};
+
 struct PacketStream {
   PacketStream();
 
@@ -86,6 +97,10 @@ public:
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
   virtual BulbId currentBulbId() const;
 
+  // Cheaper alternative to parsePacket when only the kind of command matters.
+  // Sets bulbId to the bulb the packet is for.
+  virtual PacketCommandClass classifyPacket(const uint8_t* packet, BulbId& bulbId);
+
   static void formatV1Packet(uint8_t const* packet, char* buffer);
 
   size_t getPacketLength() const;
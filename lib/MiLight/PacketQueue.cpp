@@ -2,41 +2,136 @@
 
 PacketQueue::PacketQueue()
   : droppedPackets(0)
-{ }
+  , coalescedPackets(0)
+  , head(0)
+  , count(0)
+  , numFreeSlots(NUM_SLOTS)
+{
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    freeSlots[i] = NUM_SLOTS - 1 - i;
+  }
+}
 
 void PacketQueue::push(const uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride) {
-  std::shared_ptr<QueuedPacket> qp = checkoutPacket();
-  memcpy(qp->packet, packet, remoteConfig->packetFormatter->getPacketLength());
-  qp->remoteConfig = remoteConfig;
-  qp->repeatsOverride = repeatsOverride;
+  fill(checkoutPacket(), packet, remoteConfig, repeatsOverride);
+}
+
+bool PacketQueue::coalesce(const uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride) {
+  PacketFormatter* formatter = remoteConfig->packetFormatter;
+  BulbId bulbId;
+  PacketCommandClass commandClass = formatter->classifyPacket(packet, bulbId);
+
+  if (commandClass == PacketCommandClass::NONE) {
+    return false;
+  }
+
+  // Walk back from the newest queued packet
+  for (size_t i = count; i > 0; --i) {
+    QueuedPacket& queued = slots[slotAt(i - 1)];
+
+    if (queued.remoteConfig != remoteConfig) {
+      continue;
+    }
+
+    BulbId queuedBulbId;
+    PacketCommandClass queuedClass = formatter->classifyPacket(queued.packet, queuedBulbId);
+
+    if (queuedBulbId.deviceId != bulbId.deviceId) {
+      continue;
+    }
+
+    // Anything else for this device (including other groups, which may
+    // overlap through group 0) has to stay ordered before this packet
+    if (queuedClass != commandClass || queuedBulbId.groupId != bulbId.groupId) {
+      return false;
+    }
+
+    fill(queued, packet, remoteConfig, repeatsOverride);
+    ++coalescedPackets;
+
+    return true;
+  }
+
+  return false;
+}
+
+void PacketQueue::fill(QueuedPacket& qp, const uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride) {
+  memcpy(qp.packet, packet, remoteConfig->packetFormatter->getPacketLength());
+  qp.remoteConfig = remoteConfig;
+  qp.repeatsOverride = repeatsOverride;
 }
 
 bool PacketQueue::isEmpty() const {
-  return queue.size() == 0;
+  return count == 0;
 }
 
 size_t PacketQueue::getDroppedPacketCount() const {
   return droppedPackets;
 }
 
-std::shared_ptr<QueuedPacket> PacketQueue::pop() {
-  return queue.shift();
+size_t PacketQueue::getCoalescedPacketCount() const {
+  return coalescedPackets;
 }
 
-std::shared_ptr<QueuedPacket> PacketQueue::checkoutPacket() {
-  if (queue.size() == MILIGHT_MAX_QUEUED_PACKETS) {
-    ++droppedPackets;
-    return queue.getLast();
-  } else {
-    std::shared_ptr<QueuedPacket> packet = std::make_shared<QueuedPacket>();
-    queue.add(packet);
-    return packet;
+size_t PacketQueue::pop() {
+  if (count == 0) {
+    return NO_PACKET;
   }
+
+  size_t slot = order[head];
+  head = (head + 1) % MILIGHT_MAX_QUEUED_PACKETS;
+  --count;
+
+  return slot;
 }
 
-void PacketQueue::checkinPacket(std::shared_ptr<QueuedPacket> packet) {
+size_t PacketQueue::popAt(size_t position) {
+  if (position >= count) {
+    return NO_PACKET;
+  }
+
+  if (position > 0) {
+    uint8_t slot = order[(head + position) % MILIGHT_MAX_QUEUED_PACKETS];
+
+    for (size_t i = position; i > 0; --i) {
+      order[(head + i) % MILIGHT_MAX_QUEUED_PACKETS] = order[(head + i - 1) % MILIGHT_MAX_QUEUED_PACKETS];
+    }
+
+    order[head] = slot;
+  }
+
+  return pop();
+}
+
+void PacketQueue::release(size_t slot) {
+  freeSlots[numFreeSlots++] = slot;
+}
+
+size_t PacketQueue::peek() const {
+  return count == 0 ? NO_PACKET : order[head];
+}
+
+QueuedPacket& PacketQueue::get(size_t slot) {
+  return slots[slot];
+}
+
+size_t PacketQueue::slotAt(size_t position) const {
+  return order[(head + position) % MILIGHT_MAX_QUEUED_PACKETS];
+}
+
+// When full, the most recently queued packet is overwritten
+QueuedPacket& PacketQueue::checkoutPacket() {
+  if (count == MILIGHT_MAX_QUEUED_PACKETS || numFreeSlots == 0) {
+    ++droppedPackets;
+    return slots[slotAt(count - 1)];
+  }
+
+  uint8_t slot = freeSlots[--numFreeSlots];
+  order[(head + count++) % MILIGHT_MAX_QUEUED_PACKETS] = slot;
+
+  return slots[slot];
 }
 
 size_t PacketQueue::size() const {
-  return queue.size();
-}
\ No newline at end of file
+  return count;
+}
@@ -1,8 +1,5 @@
 #pragma once
 
-#include <memory>
-
-#include <CircularBuffer.h>
 #include <MiLightRadioConfig.h>
 #include <MiLightRemoteConfig.h>
 
@@ -10,27 +7,77 @@
 #define MILIGHT_MAX_QUEUED_PACKETS 20
 #endif
 
+// Maximum number of packets whose repeats are interleaved when
+// interleave_packet_repeats is enabled
+#ifndef MILIGHT_MAX_INTERLEAVED_PACKETS
+#define MILIGHT_MAX_INTERLEAVED_PACKETS 4
+#endif
+
 struct QueuedPacket {
   uint8_t packet[MILIGHT_MAX_PACKET_LENGTH];
   const MiLightRemoteConfig* remoteConfig;
   size_t repeatsOverride;
 };
 
+/*
+ * FIFO of packets waiting to be sent, stored in a fixed set of slots so that
+ * queueing a packet never allocates.  The queue itself is a ring of slot
+ * indices, so taking a packet out of the middle only moves indices around.
+ *
+ * pop() hands out the index of a slot rather than a copy.  That slot is left
+ * alone until it's given back with release(), so the sender can keep using it
+ * while more packets are queued.  Up to MILIGHT_MAX_INTERLEAVED_PACKETS slots
+ * can be out at once.
+ */
 class PacketQueue {
 public:
+  // Returned by pop() when the queue is empty
+  static const size_t NO_PACKET = static_cast<size_t>(-1);
+
   PacketQueue();
 
   void push(const uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride);
-  std::shared_ptr<QueuedPacket> pop();
+
+  // If a queued packet for the same bulb carries the same class of command,
+  // overwrite it with this one and return true.  Only the newest queued packet
+  // for the device is considered, so packets are never reordered relative to
+  // other commands for it.
+  bool coalesce(const uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride);
+  size_t pop();
+  // Remove the packet this many places from the front of the queue.  Packets
+  // ahead of it keep their order.
+  size_t popAt(size_t position);
+  // Hands back a slot returned by pop() or popAt() once it's been sent
+  void release(size_t slot);
+  // Slot of the packet pop() would return next, without removing it
+  size_t peek() const;
+  QueuedPacket& get(size_t slot);
+  // Slot holding the packet this many places from the front of the queue
+  size_t slotAt(size_t position) const;
   bool isEmpty() const;
   size_t size() const;
   size_t getDroppedPacketCount() const;
+  size_t getCoalescedPacketCount() const;
 
 private:
+  // Extra slots for popped packets that haven't been released yet
+  static const size_t NUM_SLOTS = MILIGHT_MAX_QUEUED_PACKETS + MILIGHT_MAX_INTERLEAVED_PACKETS;
+  static_assert(NUM_SLOTS <= 256, "Slot indices are stored in a uint8_t");
+
   size_t droppedPackets;
+  size_t coalescedPackets;
+
+  QueuedPacket slots[NUM_SLOTS];
 
-  std::shared_ptr<QueuedPacket> checkoutPacket();
-  void checkinPacket(std::shared_ptr<QueuedPacket> packet);
+  // Slot indices of queued packets, oldest first, starting at head
+  uint8_t order[MILIGHT_MAX_QUEUED_PACKETS];
+  size_t head;
+  size_t count;
 
-  LinkedList<std::shared_ptr<QueuedPacket>> queue;
-};
\ No newline at end of file
+  // Slots that are neither queued nor popped
+  uint8_t freeSlots[NUM_SLOTS];
+  size_t numFreeSlots;
+
+  QueuedPacket& checkoutPacket();
+  void fill(QueuedPacket& qp, const uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride);
+};
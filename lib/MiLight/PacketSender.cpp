@@ -7,8 +7,10 @@ PacketSender::PacketSender(
   PacketSentHandler packetSentHandler
 ) : radioSwitchboard(radioSwitchboard)
   , settings(settings)
-  , currentPacket(nullptr)
-  , packetRepeatsRemaining(0)
+  , numActivePackets(0)
+  , nextActivePacket(0)
+  , headBypassed(false)
+  , headBypassedAt(0)
   , packetSentHandler(packetSentHandler)
   , lastSend(0)
   , currentResendCount(settings.packetRepeats)
@@ -27,52 +29,158 @@ void PacketSender::enqueue(uint8_t* packet, const MiLightRemoteConfig* remoteCon
     ? this->currentResendCount
     : repeatsOverride;
 
+  // Replace a stale packet rather than queue up behind it
+  if (settings.enablePacketCoalescing && queue.coalesce(packet, remoteConfig, repeats)) {
+    return;
+  }
+
   queue.push(packet, remoteConfig, repeats);
 }
 
 void PacketSender::loop() {
-  // Switch to the next packet if we're done with the current one
-  if (packetRepeatsRemaining == 0 && !queue.isEmpty()) {
-    nextPacket();
+  // Let the radio finish the last batch of repeats before starting another
+  radioSwitchboard.loop();
+  if (radioSwitchboard.isTransmitting()) {
+    return;
+  }
+
+  // Pick up more packets if there's room for them
+  if (!queue.isEmpty()) {
+    nextPackets();
   }
 
   // If there's a packet we're handling, deal with it
-  if (currentPacket != nullptr && packetRepeatsRemaining > 0) {
+  if (numActivePackets > 0) {
     handleCurrentPacket();
   }
 }
 
 bool PacketSender::isSending() {
-  return packetRepeatsRemaining > 0 || !queue.isEmpty();
+  return numActivePackets > 0 || !queue.isEmpty() || radioSwitchboard.isTransmitting();
 }
 
-void PacketSender::nextPacket() {
+void PacketSender::nextPackets() {
+  const size_t maxActive = settings.interleavePacketRepeats ? MILIGHT_MAX_INTERLEAVED_PACKETS : 1;
+
+  while (numActivePackets < maxActive && !queue.isEmpty()) {
+    size_t position = choosePacket();
+
+    if (!canInterleave(queue.get(queue.slotAt(position)))) {
+      break;
+    }
+
 #ifdef DEBUG_PRINTF
-  Serial.printf("Switching to next packet, %d packets in queue\n", queue.size());
+    Serial.printf("Switching to next packet, %d packets in queue\n", queue.size());
 #endif
-  currentPacket = queue.pop();
+    ActivePacket& active = activePackets[numActivePackets++];
+    active.slot = queue.popAt(position);
+    const QueuedPacket& packet = queue.get(active.slot);
+
+    if (position == 0) {
+      headBypassed = false;
+    } else if (!headBypassed) {
+      headBypassed = true;
+      headBypassedAt = millis();
+    }
+
+    if (packet.repeatsOverride > 0) {
+      active.repeatsRemaining = packet.repeatsOverride;
+    } else {
+      active.repeatsRemaining = settings.packetRepeats;
+    }
+
+    // Adjust resend count according to throttling rules
+    updateResendCount();
+  }
+}
 
-  if (currentPacket->repeatsOverride > 0) {
-    packetRepeatsRemaining = currentPacket->repeatsOverride;
-  } else {
-    packetRepeatsRemaining = settings.packetRepeats;
+// Each remote type has a single radio config, so the first queued packet for a
+// config can't be for the same bulb as anything ahead of it.  Moving it to the
+// front never reorders commands for a bulb.
+size_t PacketSender::choosePacket() {
+  const MiLightRadioConfig* radioConfig = numActivePackets > 0
+    ? &queue.get(activePackets[0].slot).remoteConfig->radioConfig
+    : radioSwitchboard.currentConfig();
+
+  if (settings.packetReorderWindow == 0 || radioConfig == NULL) {
+    return 0;
+  }
+
+  if (headBypassed && millis() - headBypassedAt >= settings.packetReorderWindow) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < queue.size(); i++) {
+    if (&queue.get(queue.slotAt(i)).remoteConfig->radioConfig == radioConfig) {
+      return i;
+    }
   }
 
-  // Adjust resend count according to throttling rules
-  updateResendCount();
+  return 0;
+}
+
+// Packets for the same bulb (or for a group that overlaps it through group 0)
+// are never interleaved, since repeats of an earlier packet could land after
+// a later one.
+bool PacketSender::canInterleave(const QueuedPacket& packet) {
+  if (numActivePackets == 0) {
+    return true;
+  }
+
+  BulbId bulbId;
+  packet.remoteConfig->packetFormatter->classifyPacket(packet.packet, bulbId);
+
+  for (size_t i = 0; i < numActivePackets; i++) {
+    const QueuedPacket& active = queue.get(activePackets[i].slot);
+
+    // Stick to one radio config at a time to avoid reconfiguring the radio
+    if (&active.remoteConfig->radioConfig != &packet.remoteConfig->radioConfig) {
+      return false;
+    }
+
+    BulbId activeBulbId;
+    active.remoteConfig->packetFormatter->classifyPacket(active.packet, activeBulbId);
+
+    if (activeBulbId.deviceType == bulbId.deviceType
+      && activeBulbId.deviceId == bulbId.deviceId
+      && (activeBulbId.groupId == bulbId.groupId || activeBulbId.groupId == 0 || bulbId.groupId == 0)) {
+      return false;
+    }
+  }
+
+  return true;
 }
 
 void PacketSender::handleCurrentPacket() {
+  ActivePacket& active = activePackets[nextActivePacket];
+  QueuedPacket& packet = queue.get(active.slot);
+
   // Always switch radio.  could've been listening in another context
-  radioSwitchboard.switchRadio(currentPacket->remoteConfig);
+  radioSwitchboard.switchRadio(packet.remoteConfig);
 
-  size_t numToSend = std::min(packetRepeatsRemaining, settings.packetRepeatsPerLoop);
-  sendRepeats(numToSend);
-  packetRepeatsRemaining -= numToSend;
+  size_t numToSend = std::min(active.repeatsRemaining, settings.packetRepeatsPerLoop);
+  sendRepeats(packet, numToSend);
+  active.repeatsRemaining -= numToSend;
+
+  if (active.repeatsRemaining > 0) {
+    nextActivePacket = (nextActivePacket + 1) % numActivePackets;
+    return;
+  }
 
   // If we're done sending this packet, fire the sent packet callback
-  if (packetRepeatsRemaining == 0 && packetSentHandler != nullptr) {
-    packetSentHandler(currentPacket->packet, *currentPacket->remoteConfig);
+  if (packetSentHandler != nullptr) {
+    packetSentHandler(packet.packet, *packet.remoteConfig);
+  }
+  queue.release(active.slot);
+
+  // Close the gap, keeping the rest in the order they were queued
+  for (size_t i = nextActivePacket + 1; i < numActivePackets; i++) {
+    activePackets[i - 1] = activePackets[i];
+  }
+  --numActivePackets;
+
+  if (nextActivePacket >= numActivePackets) {
+    nextActivePacket = 0;
   }
 }
 
@@ -84,20 +192,24 @@ size_t PacketSender::droppedPackets() const {
   return queue.getDroppedPacketCount();
 }
 
-void PacketSender::sendRepeats(size_t num) {
-  size_t len = currentPacket->remoteConfig->packetFormatter->getPacketLength();
+size_t PacketSender::coalescedPackets() const {
+  return queue.getCoalescedPacketCount();
+}
+
+void PacketSender::sendRepeats(QueuedPacket& packet, size_t num) {
+  size_t len = packet.remoteConfig->packetFormatter->getPacketLength();
 
 #ifdef DEBUG_PRINTF
   Serial.printf_P(PSTR("Sending packet (%d repeats): \n"), num);
   for (size_t i = 0; i < len; i++) {
-    Serial.printf_P(PSTR("%02X "), currentPacket->packet[i]);
+    Serial.printf_P(PSTR("%02X "), packet.packet[i]);
   }
   Serial.println();
   int iStart = millis();
 #endif
 
   for (size_t i = 0; i < num; ++i) {
-    radioSwitchboard.write(currentPacket->packet, len);
+    radioSwitchboard.write(packet.packet, len);
   }
 
 #ifdef DEBUG_PRINTF
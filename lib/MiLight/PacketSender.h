@@ -19,12 +19,13 @@ public:
   void enqueue(uint8_t* packet, const MiLightRemoteConfig* remoteConfig, const size_t repeatsOverride = 0);
   void loop();
 
-  // Return true if there are queued packets
+  // Return true if there are queued packets, or the radio is still sending
   bool isSending();
 
   // Return the number of queued packets
   size_t queueLength() const;
   size_t droppedPackets() const;
+  size_t coalescedPackets() const;
 
 private:
   RadioSwitchboard& radioSwitchboard;
@@ -32,22 +33,45 @@ private:
   GroupStateStore* stateStore;
   PacketQueue queue;
 
-  // The current packet we're sending and the number of repeats left
-  std::shared_ptr<QueuedPacket> currentPacket;
-  size_t packetRepeatsRemaining;
+  // Queue slots of the packets we're currently sending, and the number of
+  // repeats left for each.  Normally there's only one.  With interleaving,
+  // this holds several packets for the same radio config, and each gets a
+  // burst of repeats in turn.
+  struct ActivePacket {
+    size_t slot;
+    size_t repeatsRemaining;
+  };
+
+  ActivePacket activePackets[MILIGHT_MAX_INTERLEAVED_PACKETS];
+  size_t numActivePackets;
+  size_t nextActivePacket;
+
+  // Set when a packet was sent ahead of the one at the front of the queue,
+  // along with when that first happened
+  bool headBypassed;
+  unsigned long headBypassedAt;
 
   // Handler called after packets are sent.  Will not be called multiple times
   // per repeat.
   PacketSentHandler packetSentHandler;
 
-  // Send a batch of repeats for the current packet
+  // Send a batch of repeats for the next active packet
   void handleCurrentPacket();
 
-  // Switch to the next packet in the queue
-  void nextPacket();
+  // Move packets from the queue into the active set, as long as they can be
+  // sent alongside what's already there
+  void nextPackets();
+
+  // Position in the queue of the packet to send next.  Prefers the radio config
+  // already in use, as long as the packet at the front hasn't been held back
+  // for longer than the reorder window.
+  size_t choosePacket();
+
+  // True if the queued packet can be interleaved with the active packets
+  bool canInterleave(const QueuedPacket& packet);
 
-  // Send repeats of the current packet N times
-  void sendRepeats(size_t num);
+  // Send repeats of a packet N times
+  void sendRepeats(QueuedPacket& packet, size_t num);
 
   // Used to track auto repeat limiting
   unsigned long lastSend;
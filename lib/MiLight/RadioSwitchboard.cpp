@@ -1,49 +1,166 @@
 #include <RadioSwitchboard.h>
 
+RadioSwitchboard* RadioSwitchboard::interruptInstance = NULL;
+
 RadioSwitchboard::RadioSwitchboard(
   std::shared_ptr<MiLightRadioFactory> radioFactory,
   GroupStateStore* stateStore,
   Settings& settings
-) {
+) : interruptPin(settings.radioInterruptPin)
+  , duplicateFilter(settings.listenDedupeWindow)
+  , listenScheduler(settings.listenRemoteTypes)
+  , hasPendingPacket(false)
+  , listeningRadio(NULL)
+  , listeningConfig(NULL)
+  , reconfigurations(0)
+  , rateWindowStart(millis())
+  , rateWindowCount(0)
+  , lastRateWindowCount(0)
+{
+  memset(receiveStats, 0, sizeof(receiveStats));
+
   for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
     std::shared_ptr<MiLightRadio> radio = radioFactory->create(MiLightRadioConfig::ALL_CONFIGS[i]);
     radio->begin();
     radios.push_back(radio);
+
+    std::shared_ptr<MiLightRadio> listenRadio = radioFactory->createListener(MiLightRadioConfig::ALL_CONFIGS[i]);
+    if (listenRadio != nullptr) {
+      listenRadio->begin();
+      listenRadios.push_back(listenRadio);
+    }
   }
 
   for (size_t i = 0; i < MiLightRemoteConfig::NUM_REMOTES; i++) {
     MiLightRemoteConfig::ALL_REMOTES[i]->packetFormatter->initialize(stateStore, &settings);
   }
+
+  if (isInterruptDriven()) {
+    interruptInstance = this;
+    pinMode(interruptPin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(interruptPin), handleInterrupt, radioFactory->receiveInterruptMode());
+  }
+}
+
+RadioSwitchboard::~RadioSwitchboard() {
+  if (isInterruptDriven()) {
+    detachInterrupt(digitalPinToInterrupt(interruptPin));
+    interruptInstance = NULL;
+  }
 }
 
 size_t RadioSwitchboard::getNumRadios() const {
   return radios.size();
 }
 
-std::shared_ptr<MiLightRadio> RadioSwitchboard::switchRadio(size_t radioIx) {
-  if (radioIx >= getNumRadios()) {
+const MiLightRadioConfig* RadioSwitchboard::currentConfig() const {
+  if (currentRadio == nullptr) {
     return NULL;
   }
 
-  if (this->currentRadio != radios[radioIx]) {
-    this->currentRadio = radios[radioIx];
-    this->currentRadio->configure();
+  return &currentRadio->config();
+}
+
+size_t RadioSwitchboard::getReconfigurationCount() const {
+  return reconfigurations;
+}
+
+size_t RadioSwitchboard::getReconfigurationsPerSecond() {
+  rollRateWindow();
+  return lastRateWindowCount;
+}
+
+// Counts are kept in one-second windows.  If a whole window went by without
+// any activity, the rate is zero.
+void RadioSwitchboard::rollRateWindow() {
+  unsigned long elapsed = millis() - rateWindowStart;
+
+  if (elapsed >= 1000) {
+    lastRateWindowCount = elapsed < 2000 ? rateWindowCount : 0;
+    rateWindowCount = 0;
+    rateWindowStart += elapsed - (elapsed % 1000);
   }
+}
 
-  return this->currentRadio;
+std::shared_ptr<MiLightRadio> RadioSwitchboard::switchRadio(size_t radioIx) {
+  return switchRadio(radios, currentRadio, radioIx);
 }
 
 std::shared_ptr<MiLightRadio> RadioSwitchboard::switchRadio(const MiLightRemoteConfig* remote) {
-  std::shared_ptr<MiLightRadio> radio = NULL;
+  return switchRadio(indexOf(remote));
+}
+
+std::shared_ptr<MiLightRadio> RadioSwitchboard::switchListenRadio(size_t radioIx) {
+  if (!hasListenRadio()) {
+    return switchRadio(radioIx);
+  }
+
+  return switchRadio(listenRadios, currentListenRadio, radioIx);
+}
+
+std::shared_ptr<MiLightRadio> RadioSwitchboard::switchListenRadio(const MiLightRemoteConfig* remote) {
+  return switchListenRadio(indexOf(remote));
+}
+
+std::shared_ptr<MiLightRadio> RadioSwitchboard::switchToNextListenConfig() {
+  const std::shared_ptr<MiLightRadio>& radio = receivingRadio();
 
+  // Switching before the radio has settled would mean it never hears
+  // anything (the LT8900 takes several ms to start receiving)
+  if (radio != nullptr && !radio->isListening()) {
+    return radio;
+  }
+
+  return switchListenRadio(listenScheduler.next());
+}
+
+bool RadioSwitchboard::hasListenRadio() const {
+  return !listenRadios.empty();
+}
+
+// Returns getNumRadios() if there's no radio for the remote
+size_t RadioSwitchboard::indexOf(const MiLightRemoteConfig* remote) const {
   for (size_t i = 0; i < radios.size(); i++) {
     if (&this->radios[i]->config() == &remote->radioConfig) {
-      radio = switchRadio(i);
-      break;
+      return i;
+    }
+  }
+
+  return radios.size();
+}
+
+std::shared_ptr<MiLightRadio> RadioSwitchboard::switchRadio(
+  const std::vector<std::shared_ptr<MiLightRadio>>& pool,
+  std::shared_ptr<MiLightRadio>& current,
+  size_t radioIx
+) {
+  if (radioIx >= pool.size()) {
+    return NULL;
+  }
+
+  if (current != pool[radioIx]) {
+    stopInterruptReads();
+    hasPendingPacket = false;
+
+    // Whatever the old radio still has to send would be lost
+    while (current != nullptr && current->isTransmitting()) {
+      current->loop();
+      yield();
     }
+
+    current = pool[radioIx];
+    current->configure();
+
+    rollRateWindow();
+    ++reconfigurations;
+    ++rateWindowCount;
   }
 
-  return radio;
+  return current;
+}
+
+const std::shared_ptr<MiLightRadio>& RadioSwitchboard::receivingRadio() const {
+  return hasListenRadio() ? currentListenRadio : currentRadio;
 }
 
 void RadioSwitchboard::write(uint8_t* packet, size_t len) {
@@ -51,24 +168,165 @@ void RadioSwitchboard::write(uint8_t* packet, size_t len) {
     return;
   }
 
+  stopInterruptReads();
   this->currentRadio->write(packet, len);
 }
 
+void RadioSwitchboard::loop() {
+  if (!isTransmitting()) {
+    return;
+  }
+
+  if (receivingRadio() == currentRadio) {
+    stopInterruptReads();
+  }
+  this->currentRadio->loop();
+}
+
+bool RadioSwitchboard::isTransmitting() const {
+  return this->currentRadio != nullptr && this->currentRadio->isTransmitting();
+}
+
 size_t RadioSwitchboard::read(uint8_t* packet) {
-  if (currentRadio == nullptr) {
+  if (!available()) {
     return 0;
   }
 
-  size_t length;
-  currentRadio->read(packet, length);
+  memcpy(packet, pendingPacket.packet, pendingPacket.length);
+  hasPendingPacket = false;
 
-  return length;
+  return pendingPacket.length;
 }
 
+// Reads at most one packet off the radio per call, so that a remote repeating
+// a press can't keep this busy.  Duplicates count as nothing available.
 bool RadioSwitchboard::available() {
-  if (currentRadio == nullptr) {
+  const std::shared_ptr<MiLightRadio>& radio = receivingRadio();
+
+  if (radio == nullptr) {
+    return false;
+  }
+
+  if (hasPendingPacket) {
+    return true;
+  }
+
+  stopInterruptReads();
+
+  if (radio->available()) {
+    pendingPacket.length = sizeof(pendingPacket.packet);
+
+    if (radio->read(pendingPacket.packet, pendingPacket.length) > 0
+      && acceptReceived(radio->config(), pendingPacket.packet, pendingPacket.length)) {
+      pendingPacket.config = &radio->config();
+      hasPendingPacket = true;
+    }
+  }
+
+  return hasPendingPacket;
+}
+
+bool RadioSwitchboard::isInterruptDriven() const {
+  return interruptPin >= 0;
+}
+
+void RadioSwitchboard::listen() {
+  const std::shared_ptr<MiLightRadio>& radio = receivingRadio();
+
+  if (radio == nullptr || !isInterruptDriven()) {
+    return;
+  }
+
+  // Cheap if the radio is still listening, but it may have stopped after the
+  // last packet was read
+  stopInterruptReads();
+  radio->listen();
+
+  // A packet that arrived while the main loop had the radio will already have
+  // raised the interrupt line.  Read it now, otherwise the line never changes
+  // again and no more interrupts fire.
+  noInterrupts();
+  listeningConfig = &radio->config();
+  listeningRadio.store(radio.get());
+  receivePending();
+  interrupts();
+}
+
+bool RadioSwitchboard::readReceived(ReceivedPacket& packet) {
+  return receiveRing.pop(packet);
+}
+
+size_t RadioSwitchboard::getReceiveOverflowCount() const {
+  return receiveRing.getOverflowCount();
+}
+
+const MiLightRemoteConfig* RadioSwitchboard::identifyRemote(const MiLightRadioConfig& config, const uint8_t* packet, size_t length) {
+  const MiLightRemoteConfig* remote = MiLightRemoteConfig::fromReceivedPacket(config, packet, length);
+
+  if (remote != NULL) {
+    const size_t configIx = &config - MiLightRadioConfig::ALL_CONFIGS;
+    ++receiveStats[configIx].decoded;
+    listenScheduler.recordDecoded(configIx);
+  }
+
+  return remote;
+}
+
+RadioReceiveStats RadioSwitchboard::getReceiveStats(const MiLightRadioConfig& config) const {
+  const size_t configIx = &config - MiLightRadioConfig::ALL_CONFIGS;
+  RadioReceiveStats stats = receiveStats[configIx];
+
+  stats.crcErrors = radios[configIx]->getCrcErrorCount();
+  if (hasListenRadio()) {
+    stats.crcErrors += listenRadios[configIx]->getCrcErrorCount();
+  }
+
+  return stats;
+}
+
+uint8_t RadioSwitchboard::getListenWeight(const MiLightRadioConfig& config) const {
+  return listenScheduler.getWeight(&config - MiLightRadioConfig::ALL_CONFIGS);
+}
+
+// Counts a packet read off a radio, and returns false if it's a duplicate.
+// Called from the interrupt handler as well as the main loop.
+bool ICACHE_RAM_ATTR RadioSwitchboard::acceptReceived(const MiLightRadioConfig& config, const uint8_t* packet, size_t length) {
+  RadioReceiveStats& stats = receiveStats[&config - MiLightRadioConfig::ALL_CONFIGS];
+  ++stats.received;
+
+  if (duplicateFilter.isDuplicate(config, packet, length)) {
+    ++stats.duplicates;
     return false;
   }
 
-  return currentRadio->available();
-}
\ No newline at end of file
+  return true;
+}
+
+void RadioSwitchboard::stopInterruptReads() {
+  listeningRadio.store(NULL);
+}
+
+void ICACHE_RAM_ATTR RadioSwitchboard::handleInterrupt() {
+  if (interruptInstance != NULL) {
+    interruptInstance->receivePending();
+  }
+}
+
+// Everything this calls is in IRAM (see IsrSpi), since it runs from the
+// interrupt handler
+void ICACHE_RAM_ATTR RadioSwitchboard::receivePending() {
+  MiLightRadio* radio = listeningRadio.load();
+
+  if (radio == NULL) {
+    return;
+  }
+
+  ReceivedPacket received;
+  received.length = sizeof(received.packet);
+
+  if (radio->readPending(received.packet, received.length) > 0
+    && acceptReceived(*listeningConfig, received.packet, received.length)) {
+    received.config = listeningConfig;
+    receiveRing.push(received);
+  }
+}
@@ -4,6 +4,34 @@
 #include <MiLightRemoteConfig.h>
 #include <MiLightRadioConfig.h>
 #include <MiLightRadioFactory.h>
+#include <DuplicatePacketFilter.h>
+#include <ListenScheduler.h>
+#include <SpscRing.h>
+#include <atomic>
+
+// Number of received packets that can wait for the main loop when receiving
+// from the radio's interrupt.  Must be a power of two.
+#ifndef RADIO_RECEIVE_RING_SIZE
+#define RADIO_RECEIVE_RING_SIZE 8
+#endif
+
+struct ReceivedPacket {
+  const MiLightRadioConfig* config;
+  size_t length;
+  uint8_t packet[MILIGHT_MAX_PACKET_LENGTH];
+};
+
+// Counts for packets received with one radio config
+struct RadioReceiveStats {
+  // Read off the radio, including duplicates
+  size_t received;
+  // Dropped as repeats of an earlier packet
+  size_t duplicates;
+  // Dropped by the radio because of a bad CRC
+  size_t crcErrors;
+  // Recognized as coming from a known remote
+  size_t decoded;
+};
 
 class RadioSwitchboard {
 public:
@@ -12,16 +40,115 @@ public:
     GroupStateStore* stateStore,
     Settings& settings
   );
+  ~RadioSwitchboard();
 
   std::shared_ptr<MiLightRadio> switchRadio(const MiLightRemoteConfig* remote);
   std::shared_ptr<MiLightRadio> switchRadio(size_t index);
   size_t getNumRadios() const;
 
+  // Selects the radio that available(), read() and listen() use.  That's the
+  // one selected with switchRadio(), unless there's a dedicated listen radio.
+  std::shared_ptr<MiLightRadio> switchListenRadio(const MiLightRemoteConfig* remote);
+  std::shared_ptr<MiLightRadio> switchListenRadio(size_t index);
+
+  // Switches the listen radio to the config the listen scheduler picks next
+  // (see ListenScheduler).  Keeps the current config until the radio has
+  // started listening with it.
+  std::shared_ptr<MiLightRadio> switchToNextListenConfig();
+
+  // True if a second module does all the listening, so it can carry on while
+  // packets are being sent
+  bool hasListenRadio() const;
+
+  // Config of the radio currently in use, or NULL if none has been selected
+  const MiLightRadioConfig* currentConfig() const;
+
+  // Number of times the radio has been reconfigured for a different config,
+  // in total and during the last full second
+  size_t getReconfigurationCount() const;
+  size_t getReconfigurationsPerSecond();
+
   bool available();
   void write(uint8_t* packet, size_t length);
   size_t read(uint8_t* packet);
 
+  // Carries on with anything the current radio is still sending.  Call often
+  // while isTransmitting() is true.
+  void loop();
+
+  // True while the current radio has packets written to it that haven't all
+  // gone out yet
+  bool isTransmitting() const;
+
+  // True if packets are received from the radio's interrupt (see
+  // Settings::radioInterruptPin) rather than by polling available()/read()
+  bool isInterruptDriven() const;
+
+  // Puts the current listen radio in receive mode and lets the interrupt handler
+  // read from it, until the radio is next used from the main loop
+  void listen();
+
+  // Takes the oldest packet the interrupt handler received.  Returns false if
+  // there isn't one.
+  bool readReceived(ReceivedPacket& packet);
+
+  // Number of received packets dropped because the receive ring was full
+  size_t getReceiveOverflowCount() const;
+
+  // Finds the remote that sent a received packet, or returns NULL if there
+  // isn't one
+  const MiLightRemoteConfig* identifyRemote(const MiLightRadioConfig& config, const uint8_t* packet, size_t length);
+
+  RadioReceiveStats getReceiveStats(const MiLightRadioConfig& config) const;
+
+  // Share of listen time the given config currently gets, relative to the
+  // others.  0 if it isn't listened for.
+  uint8_t getListenWeight(const MiLightRadioConfig& config) const;
+
 private:
+  typedef SpscRing<ReceivedPacket, RADIO_RECEIVE_RING_SIZE> ReceiveRing;
+
+  // Only one switchboard at a time is wired to the interrupt
+  static RadioSwitchboard* interruptInstance;
+  static void handleInterrupt();
+
   std::vector<std::shared_ptr<MiLightRadio>> radios;
   std::shared_ptr<MiLightRadio> currentRadio;
+  // Empty if there's no dedicated listen radio
+  std::vector<std::shared_ptr<MiLightRadio>> listenRadios;
+  std::shared_ptr<MiLightRadio> currentListenRadio;
+
+  const int8_t interruptPin;
+  ReceiveRing receiveRing;
+  DuplicatePacketFilter duplicateFilter;
+  ListenScheduler listenScheduler;
+  RadioReceiveStats receiveStats[MiLightRadioConfig::NUM_CONFIGS];
+  // Packet available() read off the radio for read() to return.  Only used
+  // when polling.
+  ReceivedPacket pendingPacket;
+  bool hasPendingPacket;
+
+  // Radio the interrupt handler may read from.  The main loop clears this
+  // before it talks to any radio itself, so the two never share the SPI bus.
+  std::atomic<MiLightRadio*> listeningRadio;
+  // Its config, so the interrupt handler needn't ask the radio (config() is
+  // in flash)
+  const MiLightRadioConfig* listeningConfig;
+
+  size_t reconfigurations;
+  unsigned long rateWindowStart;
+  size_t rateWindowCount;
+  size_t lastRateWindowCount;
+
+  void rollRateWindow();
+  size_t indexOf(const MiLightRemoteConfig* remote) const;
+  std::shared_ptr<MiLightRadio> switchRadio(
+    const std::vector<std::shared_ptr<MiLightRadio>>& pool,
+    std::shared_ptr<MiLightRadio>& current,
+    size_t index
+  );
+  const std::shared_ptr<MiLightRadio>& receivingRadio() const;
+  void stopInterruptReads();
+  void receivePending();
+  bool acceptReceived(const MiLightRadioConfig& config, const uint8_t* packet, size_t length);
 };
\ No newline at end of file
@@ -157,3 +157,21 @@ BulbId RgbCctPacketFormatter::parsePacket(const uint8_t *packet, JsonObject resu
 
   return bulbId;
 }
+
+PacketCommandClass RgbCctPacketFormatter::classifyCommand(uint8_t command, uint8_t arg) const {
+  switch (command) {
+    case RGB_CCT_COLOR:
+      return PacketCommandClass::HUE;
+    case RGB_CCT_KELVIN:
+      return PacketCommandClass::TEMPERATURE;
+    // brightness and saturation share a command, and are told apart by range
+    case RGB_CCT_BRIGHTNESS:
+      return arg >= (RGB_CCT_BRIGHTNESS_OFFSET - 15)
+        ? PacketCommandClass::BRIGHTNESS
+        : PacketCommandClass::SATURATION;
+    case RGB_CCT_MODE:
+      return PacketCommandClass::MODE;
+    default:
+      return PacketCommandClass::NONE;
+  }
+}
@@ -52,6 +52,9 @@ public:
 
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
 
+protected:
+  virtual PacketCommandClass classifyCommand(uint8_t command, uint8_t arg) const;
+
 protected:
 
   uint8_t lastMode;
@@ -120,6 +120,14 @@ BulbId RgbPacketFormatter::parsePacket(const uint8_t* packet, JsonObject result)
   return bulbId;
 }
 
+PacketCommandClass RgbPacketFormatter::classifyPacket(const uint8_t* packet, BulbId& bulbId) {
+  bulbId = BulbId((packet[1] << 8) | packet[2], 0, REMOTE_TYPE_RGB);
+
+  // Brightness is only ever sent as up/down steps, so color is the only
+  // absolute command
+  return (packet[RGB_COMMAND_INDEX] & 0x7F) == 0 ? PacketCommandClass::HUE : PacketCommandClass::NONE;
+}
+
 void RgbPacketFormatter::format(uint8_t const* packet, char* buffer) {
   buffer += sprintf_P(buffer, PSTR("b0       : %02X\n"), packet[0]);
   buffer += sprintf_P(buffer, PSTR("ID       : %02X%02X\n"), packet[1], packet[2]);
@@ -40,6 +40,7 @@ public:
   virtual void nextMode();
   virtual void previousMode();
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
+  virtual PacketCommandClass classifyPacket(const uint8_t* packet, BulbId& bulbId);
 
   virtual void initializePacket(uint8_t* packet);
 };
@@ -155,6 +155,27 @@ BulbId RgbwPacketFormatter::parsePacket(const uint8_t* packet, JsonObject result
   return bulbId;
 }
 
+PacketCommandClass RgbwPacketFormatter::classifyPacket(const uint8_t* packet, BulbId& bulbId) {
+  uint8_t command = packet[RGBW_COMMAND_INDEX] & 0x7F;
+
+  bulbId = BulbId(
+    (packet[1] << 8) | packet[2],
+    packet[RGBW_BRIGHTNESS_GROUP_INDEX] & 0x7,
+    REMOTE_TYPE_RGBW
+  );
+
+  switch (command) {
+    case RGBW_BRIGHTNESS:
+      return PacketCommandClass::BRIGHTNESS;
+    case RGBW_COLOR:
+      return PacketCommandClass::HUE;
+    case RGBW_DISCO_MODE:
+      return PacketCommandClass::MODE;
+    default:
+      return PacketCommandClass::NONE;
+  }
+}
+
 void RgbwPacketFormatter::format(uint8_t const* packet, char* buffer) {
   PacketFormatter::formatV1Packet(packet, buffer);
 }
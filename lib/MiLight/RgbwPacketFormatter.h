@@ -71,6 +71,7 @@ public:
   virtual void updateMode(uint8_t mode);
   virtual void enableNightMode();
   virtual BulbId parsePacket(const uint8_t* packet, JsonObject result);
+  virtual PacketCommandClass classifyPacket(const uint8_t* packet, BulbId& bulbId);
 
   virtual void initializePacket(uint8_t* packet);
 
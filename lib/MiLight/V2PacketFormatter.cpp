@@ -56,8 +56,32 @@ void V2PacketFormatter::unpair() {
   }
 }
 
-void V2PacketFormatter::finalizePacket(uint8_t* packet) {
-  V2RFEncoding::encodeV2Packet(packet);
+// Packets are encoded all at once when the stream is built, rather than one
+// at a time as they're pushed
+PacketStream& V2PacketFormatter::buildPackets() {
+  PacketStream& stream = PacketFormatter::buildPackets();
+  V2RFEncoding::encodeV2Packets(stream);
+
+  return stream;
+}
+
+PacketCommandClass V2PacketFormatter::classifyPacket(const uint8_t* packet, BulbId& bulbId) {
+  uint8_t packetCopy[V2_PACKET_LEN];
+  memcpy(packetCopy, packet, V2_PACKET_LEN);
+  V2RFEncoding::decodeV2Packet(packetCopy);
+
+  bulbId = BulbId((packetCopy[2] << 8) | packetCopy[3], packetCopy[7], deviceType);
+
+  // Held commands (e.g., night mode) are never absolute values
+  if (packetCopy[V2_COMMAND_INDEX] & 0x80) {
+    return PacketCommandClass::NONE;
+  }
+
+  return classifyCommand(packetCopy[V2_COMMAND_INDEX], packetCopy[V2_ARGUMENT_INDEX]);
+}
+
+PacketCommandClass V2PacketFormatter::classifyCommand(uint8_t command, uint8_t arg) const {
+  return PacketCommandClass::NONE;
 }
 
 void V2PacketFormatter::format(uint8_t const* packet, char* buffer) {
@@ -25,7 +25,9 @@ public:
   virtual void format(uint8_t const* packet, char* buffer);
   virtual void unpair();
 
-  virtual void finalizePacket(uint8_t* packet);
+  virtual PacketStream& buildPackets();
+
+  virtual PacketCommandClass classifyPacket(const uint8_t* packet, BulbId& bulbId);
 
   uint8_t groupCommandArg(MiLightStatus status, uint8_t groupId);
 
@@ -49,6 +51,9 @@ public:
 protected:
   const uint8_t protocolId;
   const uint8_t numGroups;
+
+  // Class of a decoded command byte (without the held bit) and its argument
+  virtual PacketCommandClass classifyCommand(uint8_t command, uint8_t arg) const;
   void switchMode(const GroupState& currentState, BulbMode desiredMode);
 };
 
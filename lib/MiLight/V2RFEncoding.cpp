@@ -1,12 +1,34 @@
 #include <V2RFEncoding.h>
+#include <PacketFormatter.h>
 
-#define V2_OFFSET(byte, key, jumpStart) ( \
-  V2_OFFSETS[byte-1][key%4] \
-    + \
-  ((jumpStart > 0 && key >= jumpStart && key < jumpStart+0x80) ? 0x80 : 0) \
-)
+// Number of bytes after the key byte
+#define V2_ENCODED_LENGTH 8
 
-uint8_t const V2RFEncoding::V2_OFFSETS[][4] = {
+// Keys are grouped into rows by the low two bits of the key, and whether the
+// key is in the jump start range (which adds 0x80 to every offset).
+#define V2_NUM_OFFSET_ROWS 8
+
+// Everything below is computed at compile time.  The tables are indexed by
+// the key byte (packet[0]) so that encoding a packet doesn't need any
+// branches or key derivation.
+
+template <size_t... Ixs>
+struct V2IndexList { };
+
+template <size_t N, size_t... Ixs>
+struct V2MakeIndexList : V2MakeIndexList<N - 1, N - 1, Ixs...> { };
+
+template <size_t... Ixs>
+struct V2MakeIndexList<0, Ixs...> {
+  typedef V2IndexList<Ixs...> Type;
+};
+
+template <size_t N>
+struct V2ByteTable {
+  uint8_t values[N];
+};
+
+static constexpr uint8_t V2_OFFSETS[V2_ENCODED_LENGTH][4] = {
   { 0x45, 0x1F, 0x14, 0x5C }, // request type
   { 0x2B, 0xC9, 0xE3, 0x11 }, // id 1
   { 0x6D, 0x5F, 0x8A, 0x2B }, // id 2
@@ -17,16 +39,55 @@ uint8_t const V2RFEncoding::V2_OFFSETS[][4] = {
   { 0x61, 0x13, 0x38, 0x64 }  // checksum
 };
 
-uint8_t V2RFEncoding::xorKey(uint8_t key) {
-  // Generate most significant nibble
-  const uint8_t shift = (key & 0x0F) < 0x04 ? 0 : 1;
-  const uint8_t x = (((key & 0xF0) >> 4) + shift + 6) % 8;
-  const uint8_t msn = (((4 + x) ^ 1) & 0x0F) << 4;
+static constexpr uint8_t computeXorKey(uint8_t key) {
+  return
+    // Most significant nibble
+    (((4 + ((((key & 0xF0) >> 4) + ((key & 0x0F) < 0x04 ? 0 : 1) + 6) % 8)) ^ 1) & 0x0F) << 4
+      |
+    // Least significant nibble
+    ((((key & 0x0F) + 4) ^ 2) & 0x0F);
+}
+
+// Entry ix is the offset of byte (ix % 8) + 1 in row ix / 8
+static constexpr uint8_t computeOffset(size_t ix) {
+  return static_cast<uint8_t>(
+    V2_OFFSETS[ix % V2_ENCODED_LENGTH][(ix / V2_ENCODED_LENGTH) & 0x03]
+      +
+    (((ix / V2_ENCODED_LENGTH) & 0x04) ? 0x80 : 0)
+  );
+}
+
+template <size_t... Ixs>
+static constexpr V2ByteTable<sizeof...(Ixs)> buildXorKeys(V2IndexList<Ixs...>) {
+  return {{ computeXorKey(Ixs)... }};
+}
+
+template <size_t... Ixs>
+static constexpr V2ByteTable<sizeof...(Ixs)> buildOffsets(V2IndexList<Ixs...>) {
+  return {{ computeOffset(Ixs)... }};
+}
+
+static_assert(computeXorKey(0x00) == 0xB6, "unexpected xor key");
+static_assert(computeOffset(V2_ENCODED_LENGTH * 5) == 0x1F + 0x80, "unexpected offset");
 
-  // Generate least significant nibble
-  const uint8_t lsn = ((((key & 0xF) + 4)^2) & 0x0F);
+static const V2ByteTable<256> V2_XOR_KEYS PROGMEM = buildXorKeys(V2MakeIndexList<256>::Type());
+static const V2ByteTable<V2_NUM_OFFSET_ROWS * V2_ENCODED_LENGTH> V2_OFFSET_ROWS PROGMEM
+  = buildOffsets(V2MakeIndexList<V2_NUM_OFFSET_ROWS * V2_ENCODED_LENGTH>::Type());
 
-  return ( msn | lsn );
+// Offsets of bytes 1-8 for packets encoded with the given key.  Points into
+// PROGMEM.
+static inline const uint8_t* offsetRow(uint8_t key) {
+  const uint8_t jumpStart = static_cast<uint8_t>(key - V2_OFFSET_JUMP_START) < 0x80 ? 0x04 : 0;
+  return V2_OFFSET_ROWS.values + ((jumpStart | (key & 0x03)) * V2_ENCODED_LENGTH);
+}
+
+// The checksum is encoded without the jump start offset (but decoded with it)
+static inline uint8_t checksumOffset(uint8_t key) {
+  return pgm_read_byte(&V2_OFFSET_ROWS.values[(key & 0x03) * V2_ENCODED_LENGTH + V2_ENCODED_LENGTH - 1]);
+}
+
+uint8_t V2RFEncoding::xorKey(uint8_t key) {
+  return pgm_read_byte(&V2_XOR_KEYS.values[key]);
 }
 
 uint8_t V2RFEncoding::decodeByte(uint8_t byte, uint8_t s1, uint8_t xorKey, uint8_t s2) {
@@ -46,21 +107,32 @@ uint8_t V2RFEncoding::encodeByte(uint8_t byte, uint8_t s1, uint8_t xorKey, uint8
 }
 
 void V2RFEncoding::decodeV2Packet(uint8_t *packet) {
-  uint8_t key = xorKey(packet[0]);
+  const uint8_t key = pgm_read_byte(&V2_XOR_KEYS.values[packet[0]]);
+  const uint8_t* offsets = offsetRow(packet[0]);
 
-  for (size_t i = 1; i <= 8; i++) {
-    packet[i] = decodeByte(packet[i], 0, key, V2_OFFSET(i, packet[0], V2_OFFSET_JUMP_START));
+  for (size_t i = 0; i < V2_ENCODED_LENGTH; i++) {
+    packet[i + 1] = (packet[i + 1] - pgm_read_byte(&offsets[i])) ^ key;
   }
 }
 
 void V2RFEncoding::encodeV2Packet(uint8_t *packet) {
-  uint8_t key = xorKey(packet[0]);
+  const uint8_t key = pgm_read_byte(&V2_XOR_KEYS.values[packet[0]]);
+  const uint8_t* offsets = offsetRow(packet[0]);
   uint8_t sum = key;
 
-  for (size_t i = 1; i <= 7; i++) {
-    sum += packet[i];
-    packet[i] = encodeByte(packet[i], 0, key, V2_OFFSET(i, packet[0], V2_OFFSET_JUMP_START));
+  for (size_t i = 0; i < V2_ENCODED_LENGTH - 1; i++) {
+    sum += packet[i + 1];
+    packet[i + 1] = (packet[i + 1] ^ key) + pgm_read_byte(&offsets[i]);
   }
 
-  packet[8] = encodeByte(sum, 2, key, V2_OFFSET(8, packet[0], 0));
+  packet[V2_ENCODED_LENGTH] = ((sum + 2) ^ key) + checksumOffset(packet[0]);
+}
+
+void V2RFEncoding::encodeV2Packets(PacketStream& stream) {
+  uint8_t* packet = stream.packetStream;
+
+  for (size_t i = 0; i < stream.numPackets; i++) {
+    encodeV2Packet(packet);
+    packet += stream.packetLength;
+  }
 }
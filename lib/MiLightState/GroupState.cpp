@@ -622,6 +622,17 @@ void GroupState::dump(Stream& stream) const {
   }
 }
 
+void GroupState::load(const uint8_t* buffer) {
+  static_assert(sizeof(state.rawData) == PERSISTED_SIZE, "PERSISTED_SIZE doesn't match state size");
+
+  memcpy(state.rawData, buffer, PERSISTED_SIZE);
+  clearDirty();
+}
+
+void GroupState::dump(uint8_t* buffer) const {
+  memcpy(buffer, state.rawData, PERSISTED_SIZE);
+}
+
 bool GroupState::applyIncrementCommand(GroupStateField field, IncrementDirection dir) {
   if (field != GroupStateField::KELVIN && field != GroupStateField::BRIGHTNESS) {
     Serial.print(F("WARNING: tried to apply increment for unsupported field: "));
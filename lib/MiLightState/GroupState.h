@@ -151,6 +151,11 @@ public:
   void load(Stream& stream);
   void dump(Stream& stream) const;
 
+  // Same as above, but for a raw buffer of PERSISTED_SIZE bytes
+  static const size_t PERSISTED_SIZE = 8;
+  void load(const uint8_t* buffer);
+  void dump(uint8_t* buffer) const;
+
   void debugState(char const *debugMessage) const;
 
   static const GroupState& defaultState(MiLightRemoteType remoteType);
@@ -1,72 +1,157 @@
 #include <GroupStateCache.h>
 
 GroupStateCache::GroupStateCache(const size_t maxSize)
-  : maxSize(maxSize)
+  : maxSize(maxSize),
+    slab(new GroupCacheNode[maxSize]),
+    size(0),
+    head(NULL),
+    tail(NULL),
+    indexSize(indexSizeFor(maxSize)),
+    index(new GroupCacheNode*[indexSize]())
 { }
 
 GroupStateCache::~GroupStateCache() {
-  ListNode<GroupCacheNode*>* cur = cache.getHead();
-
-  while (cur != NULL) {
-    delete cur->data;
-    cur = cur->next;
-  }
+  delete[] slab;
+  delete[] index;
 }
 
 GroupState* GroupStateCache::get(const BulbId& id) {
-  return getInternal(id);
+  GroupCacheNode* node = index[findSlot(id)];
+
+  if (node == NULL) {
+    return NULL;
+  }
+
+  if (node != head) {
+    unlink(node);
+    pushFront(node);
+  }
+
+  return &node->state;
 }
 
 GroupState* GroupStateCache::set(const BulbId& id, const GroupState& state) {
-  GroupCacheNode* pushedNode = NULL;
-  if (cache.size() >= maxSize) {
-    pushedNode = cache.pop();
-  }
+  GroupState* cachedState = get(id);
 
-  GroupState* cachedState = getInternal(id);
-
-  if (cachedState == NULL) {
-    if (pushedNode == NULL) {
-      GroupCacheNode* newNode = new GroupCacheNode(id, state);
-      cachedState = &newNode->state;
-      cache.unshift(newNode);
-    } else {
-      pushedNode->id = id;
-      pushedNode->state = state;
-      cachedState = &pushedNode->state;
-      cache.unshift(pushedNode);
-    }
-  } else {
+  if (cachedState != NULL) {
     *cachedState = state;
+    return cachedState;
   }
 
-  return cachedState;
+  GroupCacheNode* node = isFull() ? popLru() : &slab[size++];
+  node->id = id;
+  node->state = state;
+  pushFront(node);
+
+  // Slot has to be found after popping the LRU, since removal can shift entries
+  index[findSlot(id)] = node;
+
+  return &node->state;
 }
 
 BulbId GroupStateCache::getLru() {
-  GroupCacheNode* node = cache.getLast();
-  return node->id;
+  return tail->id;
 }
 
 bool GroupStateCache::isFull() const {
-  return cache.size() >= maxSize;
+  return size >= maxSize;
+}
+
+GroupCacheNode* GroupStateCache::getHead() {
+  return head;
+}
+
+GroupCacheNode* GroupStateCache::popLru() {
+  GroupCacheNode* node = tail;
+
+  removeFromIndex(node->id);
+  unlink(node);
+
+  return node;
+}
+
+void GroupStateCache::pushFront(GroupCacheNode* node) {
+  node->prev = NULL;
+  node->next = head;
+
+  if (head != NULL) {
+    head->prev = node;
+  } else {
+    tail = node;
+  }
+
+  head = node;
+}
+
+void GroupStateCache::unlink(GroupCacheNode* node) {
+  if (node->prev != NULL) {
+    node->prev->next = node->next;
+  } else {
+    head = node->next;
+  }
+
+  if (node->next != NULL) {
+    node->next->prev = node->prev;
+  } else {
+    tail = node->prev;
+  }
+
+  node->next = node->prev = NULL;
 }
 
-ListNode<GroupCacheNode*>* GroupStateCache::getHead() {
-  return cache.getHead();
+size_t GroupStateCache::findSlot(const BulbId& id) const {
+  const size_t mask = indexSize - 1;
+  size_t slot = slotFor(id, indexSize);
+
+  // Load factor is capped below 1, so there is always an empty slot to stop at
+  while (index[slot] != NULL && !(index[slot]->id == id)) {
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
 }
 
-GroupState* GroupStateCache::getInternal(const BulbId& id) {
-  ListNode<GroupCacheNode*>* cur = cache.getHead();
+void GroupStateCache::removeFromIndex(const BulbId& id) {
+  const size_t mask = indexSize - 1;
+  size_t hole = findSlot(id);
 
-  while (cur != NULL) {
-    if (cur->data->id == id) {
-      GroupState* result = &cur->data->state;
-      cache.spliceToFront(cur);
-      return result;
+  if (index[hole] == NULL) {
+    return;
+  }
+
+  index[hole] = NULL;
+
+  // Backward-shift deletion: move any entry that can no longer be reached
+  // through the new hole into it, so lookups never need tombstones.
+  for (size_t slot = (hole + 1) & mask; index[slot] != NULL; slot = (slot + 1) & mask) {
+    size_t home = slotFor(index[slot]->id, indexSize);
+
+    // Entry stays put if its home lies cyclically in (hole, slot]
+    bool reachable = (hole < slot)
+      ? (home > hole && home <= slot)
+      : (home > hole || home <= slot);
+
+    if (!reachable) {
+      index[hole] = index[slot];
+      index[slot] = NULL;
+      hole = slot;
     }
-    cur = cur->next;
+  }
+}
+
+size_t GroupStateCache::slotFor(const BulbId& id, const size_t indexSize) {
+  // Fibonacci hashing.  Compact IDs for the same remote differ only in their
+  // low bits, so mix them before masking.
+  uint32_t hash = id.getCompactId() * 2654435769UL;
+  return (hash >> 16) & (indexSize - 1);
+}
+
+size_t GroupStateCache::indexSizeFor(const size_t maxSize) {
+  size_t size = 2;
+
+  while (size < maxSize + maxSize / 2 + 1) {
+    size <<= 1;
   }
 
-  return NULL;
+  return size;
 }
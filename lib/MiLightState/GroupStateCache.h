@@ -1,18 +1,31 @@
 #include <GroupState.h>
-#include <LinkedList.h>
 
 #ifndef _GROUP_STATE_CACHE_H
 #define _GROUP_STATE_CACHE_H
 
 struct GroupCacheNode {
-  GroupCacheNode() {}
+  GroupCacheNode()
+    : next(NULL), prev(NULL) { }
   GroupCacheNode(const BulbId& id, const GroupState& state)
-    : id(id), state(state) { }
+    : id(id), state(state), next(NULL), prev(NULL) { }
 
   BulbId id;
   GroupState state;
+
+  // Intrusive LRU links.  next points towards less recently used entries.
+  GroupCacheNode* next;
+  GroupCacheNode* prev;
 };
 
+/*
+ * LRU cache of GroupStates.  Entries are kept in a list ordered from most to
+ * least recently used, and indexed by an open-addressing (linear probing) hash
+ * table keyed on BulbId::getCompactId() so lookups don't need to walk the list.
+ *
+ * All nodes come from a slab of maxSize entries allocated up front.  Once it's
+ * full, the LRU node is recycled, so the cache never allocates after
+ * construction.
+ */
 class GroupStateCache {
 public:
   GroupStateCache(const size_t maxSize);
@@ -22,13 +35,35 @@ public:
   GroupState* set(const BulbId& id, const GroupState& state);
   BulbId getLru();
   bool isFull() const;
-  ListNode<GroupCacheNode*>* getHead();
+  GroupCacheNode* getHead();
 
 private:
-  LinkedList<GroupCacheNode*> cache;
   const size_t maxSize;
 
-  GroupState* getInternal(const BulbId& id);
+  // Nodes are handed out in order until all maxSize are in use
+  GroupCacheNode* slab;
+  size_t size;
+
+  GroupCacheNode* head;
+  GroupCacheNode* tail;
+
+  // Power of two, at least 1.5x maxSize to keep probe sequences short
+  const size_t indexSize;
+  GroupCacheNode** index;
+
+  GroupCacheNode* popLru();
+  void pushFront(GroupCacheNode* node);
+  void unlink(GroupCacheNode* node);
+
+  // Returns the slot containing id, or the empty slot where it would go
+  size_t findSlot(const BulbId& id) const;
+  void removeFromIndex(const BulbId& id);
+
+  static size_t slotFor(const BulbId& id, const size_t indexSize);
+  static size_t indexSizeFor(const size_t maxSize);
+
+  GroupStateCache(const GroupStateCache&);
+  GroupStateCache& operator=(const GroupStateCache&);
 };
 
 #endif
@@ -1,40 +1,368 @@
 #include <GroupStatePersistence.h>
 #include <FS.h>
 
-static const char FILE_PREFIX[] = "group_states/";
+static const char JOURNAL_FILE[] = "group_states.log";
+static const char COMPACTED_FILE[] = "group_states.tmp";
+
+// Older versions wrote one file per bulb under this directory
+static const char LEGACY_FILE_PREFIX[] = "group_states/";
+
+// "GSJ1", written at the start of the journal
+static const uint32_t JOURNAL_MAGIC = 0x314A5347;
+
+static const uint8_t RECORD_SET = 1;
+static const uint8_t RECORD_CLEAR = 2;
+
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord should be packed into 16 bytes");
+
+// CRC-16/CCITT over everything in the record but the CRC itself
+static uint16_t recordCrc(const JournalRecord& record) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(&record);
+  uint16_t crc = 0xFFFF;
+
+  for (size_t i = 0; i < offsetof(JournalRecord, crc); i++) {
+    crc ^= data[i] << 8;
+
+    for (size_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+GroupStatePersistence::GroupStatePersistence()
+  : index(NULL),
+    indexSize(0),
+    indexCapacity(0),
+    pendingCount(0),
+    journalSize(0),
+    recordCount(0),
+    loaded(false)
+{ }
+
+GroupStatePersistence::~GroupStatePersistence() {
+  delete[] index;
+}
 
 void GroupStatePersistence::get(const BulbId &id, GroupState& state) {
-  char path[30];
-  memset(path, 0, 30);
-  buildFilename(id, path);
+  load();
 
-  if (SPIFFS.exists(path)) {
-    File f = SPIFFS.open(path, "r");
-    state.load(f);
-    f.close();
+  IndexEntry* entry = find(id.getCompactId());
+  JournalRecord record;
+
+  if (entry != NULL && readRecord(entry->offset, record)) {
+    state.load(record.state);
   }
 }
 
 void GroupStatePersistence::set(const BulbId &id, const GroupState& state) {
-  char path[30];
-  memset(path, 0, 30);
-  buildFilename(id, path);
+  load();
+  append(id.getCompactId(), RECORD_SET, &state);
+}
 
-  File f = SPIFFS.open(path, "w");
-  state.dump(f);
+void GroupStatePersistence::clear(const BulbId &id) {
+  load();
+
+  uint32_t compactId = id.getCompactId();
+
+  if (find(compactId) != NULL) {
+    remove(compactId);
+    append(compactId, RECORD_CLEAR, NULL);
+  }
+}
+
+bool GroupStatePersistence::commit() {
+  if (pendingCount == 0) {
+    return true;
+  }
+
+  const size_t length = pendingCount * sizeof(JournalRecord);
+  File f = SPIFFS.open(JOURNAL_FILE, "a");
+
+  // An earlier failed write can leave part of a record at the end of the
+  // journal.  Appending after it would put every new record at the wrong
+  // offset, so write a fresh journal instead.
+  if (f && f.size() != journalSize) {
+    f.close();
+    return compact();
+  }
+
+  size_t written = f ? f.write(reinterpret_cast<const uint8_t*>(pending), length) : 0;
   f.close();
+
+  if (written != length) {
+    Serial.println(F("ERROR: failed to append to state journal"));
+    return compact();
+  }
+
+  journalSize += length;
+  recordCount += pendingCount;
+  pendingCount = 0;
+
+  if (recordCount >= 2 * indexSize + STATE_JOURNAL_COMPACT_SLACK) {
+    compact();
+  }
+
+  return true;
 }
 
-void GroupStatePersistence::clear(const BulbId &id) {
-  char path[30];
-  buildFilename(id, path);
+size_t GroupStatePersistence::getLiveCount() {
+  load();
+  return indexSize;
+}
+
+size_t GroupStatePersistence::getRecordCount() {
+  load();
+  return recordCount + pendingCount;
+}
 
-  if (SPIFFS.exists(path)) {
-    SPIFFS.remove(path);
+// Rebuilds the index by replaying the journal.  Replay stops at the first
+// torn or corrupt record, and the journal is rewritten without it.
+void GroupStatePersistence::load() {
+  if (loaded) {
+    return;
+  }
+  loaded = true;
+
+  // Finish a compaction that was interrupted after the old journal was removed
+  if (!SPIFFS.exists(JOURNAL_FILE) && SPIFFS.exists(COMPACTED_FILE)) {
+    SPIFFS.rename(COMPACTED_FILE, JOURNAL_FILE);
+  }
+
+  if (!SPIFFS.exists(JOURNAL_FILE)) {
+    startJournal();
+    migrateLegacyFiles();
+    return;
+  }
+
+  File f = SPIFFS.open(JOURNAL_FILE, "r");
+  uint32_t magic = 0;
+
+  if (f.readBytes(reinterpret_cast<char*>(&magic), sizeof(magic)) != sizeof(magic) || magic != JOURNAL_MAGIC) {
+    Serial.println(F("WARNING: state journal has an invalid header, starting a new one"));
+    f.close();
+    startJournal();
+    return;
+  }
+
+  JournalRecord record;
+  uint32_t offset = sizeof(magic);
+
+  while (f.readBytes(reinterpret_cast<char*>(&record), sizeof(record)) == sizeof(record)) {
+    if (record.crc != recordCrc(record)) {
+      break;
+    }
+
+    if (record.type == RECORD_SET) {
+      put(record.compactId, offset);
+    } else {
+      remove(record.compactId);
+    }
+
+    offset += sizeof(record);
+    ++recordCount;
+  }
+
+  bool truncated = offset != f.size();
+  f.close();
+  journalSize = offset;
+
+  if (truncated) {
+    Serial.println(F("WARNING: state journal has a corrupt record, compacting"));
+    compact();
   }
 }
 
-char* GroupStatePersistence::buildFilename(const BulbId &id, char *buffer) {
-  uint32_t compactId = id.getCompactId();
-  return buffer + sprintf(buffer, "%s%x", FILE_PREFIX, compactId);
+void GroupStatePersistence::startJournal() {
+  File f = SPIFFS.open(JOURNAL_FILE, "w");
+  f.write(reinterpret_cast<const uint8_t*>(&JOURNAL_MAGIC), sizeof(JOURNAL_MAGIC));
+  f.close();
+
+  journalSize = sizeof(JOURNAL_MAGIC);
+  recordCount = 0;
+}
+
+// Imports states saved one file per bulb, and removes the old files
+void GroupStatePersistence::migrateLegacyFiles() {
+  const size_t prefixLength = strlen(LEGACY_FILE_PREFIX);
+  Dir dir = SPIFFS.openDir(LEGACY_FILE_PREFIX);
+  uint8_t state[GroupState::PERSISTED_SIZE];
+  size_t migrated = 0;
+
+  while (dir.next()) {
+    String name = dir.fileName();
+    File f = dir.openFile("r");
+
+    if (f.readBytes(reinterpret_cast<char*>(state), sizeof(state)) == sizeof(state)) {
+      GroupState loadedState;
+      loadedState.load(state);
+
+      append(strtoul(name.c_str() + prefixLength, NULL, 16), RECORD_SET, &loadedState);
+      ++migrated;
+    }
+
+    f.close();
+  }
+
+  if (migrated == 0 || !commit()) {
+    return;
+  }
+
+  // Only remove the old files once their contents are safely in the journal
+  while (true) {
+    Dir legacy = SPIFFS.openDir(LEGACY_FILE_PREFIX);
+
+    if (!legacy.next() || !SPIFFS.remove(legacy.fileName())) {
+      break;
+    }
+  }
+
+  Serial.printf_P(PSTR("Migrated %u group states to the state journal\n"), static_cast<unsigned int>(migrated));
+}
+
+// Copies live records, including buffered ones, into a fresh journal, then
+// swaps it in.  The old journal is only replaced if every record was written.
+bool GroupStatePersistence::compact() {
+  File out = SPIFFS.open(COMPACTED_FILE, "w");
+
+  if (!out) {
+    Serial.println(F("ERROR: could not open file to compact state journal"));
+    return false;
+  }
+
+  bool ok = out.write(reinterpret_cast<const uint8_t*>(&JOURNAL_MAGIC), sizeof(JOURNAL_MAGIC)) == sizeof(JOURNAL_MAGIC);
+
+  File in = SPIFFS.open(JOURNAL_FILE, "r");
+  JournalRecord record;
+  size_t i = 0;
+
+  while (ok && i < indexSize) {
+    const uint32_t offset = index[i].offset;
+    bool readable;
+
+    if (offset >= journalSize) {
+      record = pending[(offset - journalSize) / sizeof(JournalRecord)];
+      readable = true;
+    } else {
+      readable = in
+        && in.seek(offset, SeekSet)
+        && in.readBytes(reinterpret_cast<char*>(&record), sizeof(record)) == sizeof(record)
+        && record.crc == recordCrc(record);
+    }
+
+    if (!readable) {
+      // Unreadable, so there's nothing worth keeping.  remove() swaps the
+      // last entry into this slot.
+      remove(index[i].compactId);
+      continue;
+    }
+
+    ok = out.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+    ++i;
+  }
+
+  in.close();
+  out.close();
+
+  if (!ok || !SPIFFS.remove(JOURNAL_FILE)) {
+    Serial.println(F("ERROR: failed to compact state journal"));
+    SPIFFS.remove(COMPACTED_FILE);
+    return false;
+  }
+
+  // If this fails, load() finishes the swap on the next boot
+  SPIFFS.rename(COMPACTED_FILE, JOURNAL_FILE);
+
+  // Records were copied in index order
+  for (i = 0; i < indexSize; i++) {
+    index[i].offset = sizeof(JOURNAL_MAGIC) + i * sizeof(JournalRecord);
+  }
+
+  journalSize = sizeof(JOURNAL_MAGIC) + indexSize * sizeof(JournalRecord);
+  recordCount = indexSize;
+  pendingCount = 0;
+
+  return true;
+}
+
+void GroupStatePersistence::append(uint32_t compactId, uint8_t type, const GroupState* state) {
+  // If the buffer is full and can't be written out, this record is lost.  Any
+  // earlier record for the same bulb is still indexed.
+  if (pendingCount == STATE_JOURNAL_BUFFER_RECORDS && !commit()) {
+    return;
+  }
+
+  JournalRecord& record = pending[pendingCount];
+  memset(&record, 0, sizeof(record));
+  record.compactId = compactId;
+  record.type = type;
+
+  if (state != NULL) {
+    state->dump(record.state);
+  }
+
+  record.crc = recordCrc(record);
+
+  if (type == RECORD_SET) {
+    put(compactId, journalSize + pendingCount * sizeof(JournalRecord));
+  }
+
+  ++pendingCount;
+}
+
+bool GroupStatePersistence::readRecord(uint32_t offset, JournalRecord& record) {
+  if (offset >= journalSize) {
+    record = pending[(offset - journalSize) / sizeof(JournalRecord)];
+    return true;
+  }
+
+  File f = SPIFFS.open(JOURNAL_FILE, "r");
+  bool ok = f
+    && f.seek(offset, SeekSet)
+    && f.readBytes(reinterpret_cast<char*>(&record), sizeof(record)) == sizeof(record)
+    && record.crc == recordCrc(record);
+  f.close();
+
+  return ok;
+}
+
+GroupStatePersistence::IndexEntry* GroupStatePersistence::find(uint32_t compactId) {
+  for (size_t i = 0; i < indexSize; i++) {
+    if (index[i].compactId == compactId) {
+      return &index[i];
+    }
+  }
+
+  return NULL;
+}
+
+void GroupStatePersistence::put(uint32_t compactId, uint32_t offset) {
+  IndexEntry* entry = find(compactId);
+
+  if (entry != NULL) {
+    entry->offset = offset;
+    return;
+  }
+
+  if (indexSize == indexCapacity) {
+    indexCapacity = indexCapacity == 0 ? 16 : indexCapacity * 2;
+    IndexEntry* resized = new IndexEntry[indexCapacity];
+
+    memcpy(resized, index, indexSize * sizeof(IndexEntry));
+    delete[] index;
+    index = resized;
+  }
+
+  index[indexSize].compactId = compactId;
+  index[indexSize].offset = offset;
+  ++indexSize;
+}
+
+void GroupStatePersistence::remove(uint32_t compactId) {
+  IndexEntry* entry = find(compactId);
+
+  if (entry != NULL) {
+    *entry = index[--indexSize];
+  }
 }
@@ -3,16 +3,87 @@
 #ifndef _GROUP_STATE_PERSISTENCE_H
 #define _GROUP_STATE_PERSISTENCE_H
 
+// Number of records buffered in RAM before they're appended to the journal.
+// 16 records fill one 256-byte SPIFFS page.
+#ifndef STATE_JOURNAL_BUFFER_RECORDS
+#define STATE_JOURNAL_BUFFER_RECORDS 16
+#endif
+
+// The journal is compacted once it holds this many more records than twice
+// the number of live ones.
+#ifndef STATE_JOURNAL_COMPACT_SLACK
+#define STATE_JOURNAL_COMPACT_SLACK 64
+#endif
+
+struct JournalRecord {
+  uint32_t compactId;
+  uint8_t state[GroupState::PERSISTED_SIZE];
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t crc;
+};
+
+/*
+ * Persists GroupStates in a single append-only journal of fixed-size records
+ * (compact ID, state, CRC) rather than one file per bulb.  An index of where
+ * the latest record for each bulb lives is rebuilt from the journal the first
+ * time it's needed.  Once enough records have been superseded, live records
+ * are copied into a fresh journal.
+ *
+ * set() and clear() are buffered, and only reach flash on commit() (or when
+ * the buffer fills up), so many states can be written in one append.
+ */
 class GroupStatePersistence {
 public:
+  GroupStatePersistence();
+  ~GroupStatePersistence();
+
   void get(const BulbId& id, GroupState& state);
   void set(const BulbId& id, const GroupState& state);
 
   void clear(const BulbId& id);
 
+  // Appends buffered records to the journal.  Returns false if that failed.
+  bool commit();
+
+  // Number of bulbs with persisted state
+  size_t getLiveCount();
+
+  // Number of records in the journal, including superseded ones
+  size_t getRecordCount();
+
 private:
+  struct IndexEntry {
+    uint32_t compactId;
+    uint32_t offset;
+  };
+
+  IndexEntry* index;
+  size_t indexSize;
+  size_t indexCapacity;
+
+  JournalRecord pending[STATE_JOURNAL_BUFFER_RECORDS];
+  size_t pendingCount;
+
+  // Size of the journal file, and the number of records it holds
+  uint32_t journalSize;
+  size_t recordCount;
+  bool loaded;
+
+  void load();
+  void startJournal();
+  void migrateLegacyFiles();
+  bool compact();
+
+  void append(uint32_t compactId, uint8_t type, const GroupState* state);
+  bool readRecord(uint32_t offset, JournalRecord& record);
+
+  IndexEntry* find(uint32_t compactId);
+  void put(uint32_t compactId, uint32_t offset);
+  void remove(uint32_t compactId);
 
-  static char* buildFilename(const BulbId& id, char* buffer);
+  GroupStatePersistence(const GroupStatePersistence&);
+  GroupStatePersistence& operator=(const GroupStatePersistence&);
 };
 
 #endif
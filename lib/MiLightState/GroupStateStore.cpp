@@ -1,10 +1,17 @@
 #include <GroupStateStore.h>
 #include <MiLightRemoteConfig.h>
 
-GroupStateStore::GroupStateStore(const size_t maxSize, const size_t flushRate)
-  : cache(GroupStateCache(maxSize)),
+GroupStateStore::GroupStateStore(
+  const size_t maxSize,
+  const size_t flushRate,
+  const size_t flushBudgetBytes,
+  const unsigned long flushBudgetMicros
+) : cache(maxSize),
     flushRate(flushRate),
-    lastFlush(0)
+    flushBudgetBytes(flushBudgetBytes),
+    flushBudgetMicros(flushBudgetMicros),
+    lastFlush(0),
+    flushIncomplete(false)
 { }
 
 GroupState* GroupStateStore::get(const BulbId& id) {
@@ -95,10 +102,10 @@ void GroupStateStore::clear(const BulbId& bulbId) {
 
 void GroupStateStore::trackEviction() {
   if (cache.isFull()) {
-    evictedIds.add(cache.getLru());
+    evictedIds.push(cache.getLru());
 
 #ifdef STATE_DEBUG
-    BulbId bulbId = evictedIds.getLast();
+    BulbId bulbId = evictedIds.last();
     printf(
       "Evicting from cache: 0x%04X / %d / %s\n",
       bulbId.deviceId,
@@ -110,41 +117,80 @@ void GroupStateStore::trackEviction() {
 }
 
 bool GroupStateStore::flush() {
-  ListNode<GroupCacheNode*>* curr = cache.getHead();
+  return flush(0, 0);
+}
+
+bool GroupStateStore::flush(size_t maxBytes, unsigned long maxMicros) {
+  const unsigned long start = micros();
+  GroupCacheNode* curr = cache.getHead();
+  size_t bytesWritten = 0;
   bool anythingFlushed = false;
 
-  while (curr != NULL && curr->data->state.isDirty() && !anythingFlushed) {
-    persistence.set(curr->data->id, curr->data->state);
-    curr->data->state.clearDirty();
+  flushIncomplete = false;
+
+  while (true) {
+    while (curr != NULL && !curr->state.isDirty()) {
+      curr = curr->next;
+    }
+
+    if (curr == NULL && evictedIds.isEmpty()) {
+      break;
+    }
+
+    if (anythingFlushed
+      && ((maxBytes != 0 && bytesWritten + sizeof(JournalRecord) > maxBytes)
+        || (maxMicros != 0 && micros() - start >= maxMicros))) {
+      flushIncomplete = true;
+      break;
+    }
+
+    if (curr != NULL) {
+      persistence.set(curr->id, curr->state);
+      curr->state.clearDirty();
 
 #ifdef STATE_DEBUG
-    BulbId bulbId = curr->data->id;
-    printf(
-      "Flushing dirty state for 0x%04X / %d / %s\n",
-      bulbId.deviceId,
-      bulbId.groupId,
-      MiLightRemoteConfig::fromType(bulbId.deviceType)->name.c_str()
-    );
+      BulbId bulbId = curr->id;
+      printf(
+        "Flushing dirty state for 0x%04X / %d / %s\n",
+        bulbId.deviceId,
+        bulbId.groupId,
+        MiLightRemoteConfig::fromType(bulbId.deviceType)->name.c_str()
+      );
 #endif
 
-    curr = curr->next;
-    anythingFlushed = true;
-  }
+      curr = curr->next;
+    } else {
+      persistence.clear(evictedIds.shift());
+    }
 
-  while (evictedIds.size() > 0 && !anythingFlushed) {
-    persistence.clear(evictedIds.shift());
+    bytesWritten += sizeof(JournalRecord);
     anythingFlushed = true;
   }
 
+  // Everything above goes out in a single append
+  persistence.commit();
+
   return anythingFlushed;
 }
 
 void GroupStateStore::limitedFlush() {
   unsigned long now = millis();
 
-  if ((lastFlush + flushRate) < now) {
-    if (flush()) {
+  if (flushIncomplete || (lastFlush + flushRate) < now) {
+    if (flush(flushBudgetBytes, flushBudgetMicros)) {
       lastFlush = now;
     }
   }
 }
+
+size_t GroupStateStore::flushBacklog() {
+  size_t backlog = evictedIds.size();
+
+  for (GroupCacheNode* curr = cache.getHead(); curr != NULL; curr = curr->next) {
+    if (curr->state.isDirty()) {
+      ++backlog;
+    }
+  }
+
+  return backlog;
+}
@@ -1,13 +1,24 @@
 #include <GroupState.h>
 #include <GroupStateCache.h>
 #include <GroupStatePersistence.h>
+#include <Settings.h>
+#include <CircularBuffer.h>
 
 #ifndef _GROUP_STATE_STORE_H
 #define _GROUP_STATE_STORE_H
 
 class GroupStateStore {
 public:
-  GroupStateStore(const size_t maxSize, const size_t flushRate);
+  /*
+   * flushBudgetBytes and flushBudgetMicros limit how much limitedFlush() writes
+   * per call.  0 means no limit.
+   */
+  GroupStateStore(
+    const size_t maxSize,
+    const size_t flushRate,
+    const size_t flushBudgetBytes = 0,
+    const unsigned long flushBudgetMicros = 0
+  );
 
   /*
    * Returns the state for the given BulbId.  If accessing state for a valid device
@@ -29,25 +40,40 @@ public:
   void clear(const BulbId& id);
 
   /*
-   * Flushes all states to persistent storage.  Returns true iff anything was
-   * flushed.
+   * Flushes all dirty states and pending evictions to persistent storage in one
+   * batch.  Returns true iff anything was flushed.
    */
   bool flush();
 
   /*
-   * Flushes at most one dirty state to persistent storage.  Rate limit
+   * Starts a flush once per flush interval.  Each call writes at most one
+   * batch's worth of states, so a large backlog is spread over several calls,
+   * which happen back to back until it's cleared.  Rate limit and budget are
    * specified by Settings.
    */
   void limitedFlush();
 
+  /*
+   * Number of dirty states and evictions not yet flushed.
+   */
+  size_t flushBacklog();
+
 private:
   GroupStateCache cache;
   GroupStatePersistence persistence;
-  LinkedList<BulbId> evictedIds;
+  // IDs evicted from the cache whose persisted state still needs clearing.
+  // If this fills up before flush() catches up, the oldest are dropped.
+  CircularBuffer<BulbId, MILIGHT_MAX_STATE_ITEMS> evictedIds;
   const size_t flushRate;
+  const size_t flushBudgetBytes;
+  const unsigned long flushBudgetMicros;
   unsigned long lastFlush;
+  bool flushIncomplete;
 
   void trackEviction();
+
+  // Writes states until the budget runs out.  Always writes at least one.
+  bool flush(size_t maxBytes, unsigned long maxMicros);
 };
 
 #endif
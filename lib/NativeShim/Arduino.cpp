@@ -0,0 +1,111 @@
+#include <Arduino.h>
+
+HardwareSerial Serial;
+
+static unsigned long nowMicros = 0;
+
+void NativeClock::reset() {
+  nowMicros = 0;
+}
+
+void NativeClock::advanceMicros(unsigned long us) {
+  nowMicros += us;
+}
+
+void NativeClock::advanceMillis(unsigned long ms) {
+  nowMicros += ms * 1000UL;
+}
+
+unsigned long millis() {
+  return nowMicros / 1000UL;
+}
+
+unsigned long micros() {
+  return nowMicros;
+}
+
+void delay(unsigned long ms) {
+  NativeClock::advanceMillis(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+  NativeClock::advanceMicros(us);
+}
+
+void yield() { }
+
+static uint8_t pinStates[256];
+static std::function<int()> pinReadHandlers[256];
+static std::function<void(uint8_t)> pinWriteHandlers[256];
+
+void NativePins::onRead(uint8_t pin, std::function<int()> handler) {
+  pinReadHandlers[pin] = handler;
+}
+
+void NativePins::onWrite(uint8_t pin, std::function<void(uint8_t)> handler) {
+  pinWriteHandlers[pin] = handler;
+}
+
+void NativePins::clearHandlers() {
+  for (size_t i = 0; i < 256; i++) {
+    pinReadHandlers[i] = nullptr;
+    pinWriteHandlers[i] = nullptr;
+  }
+}
+
+void pinMode(uint8_t, uint8_t) { }
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  pinStates[pin] = value;
+
+  if (pinWriteHandlers[pin]) {
+    pinWriteHandlers[pin](value);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  if (pinReadHandlers[pin]) {
+    return pinReadHandlers[pin]();
+  }
+
+  return pinStates[pin];
+}
+
+void analogWrite(uint8_t, int) { }
+
+static void (*interruptHandlers[256])();
+static bool interruptsEnabled = true;
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int) {
+  interruptHandlers[interrupt] = handler;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  interruptHandlers[interrupt] = NULL;
+}
+
+void noInterrupts() {
+  interruptsEnabled = false;
+}
+
+void interrupts() {
+  interruptsEnabled = true;
+}
+
+void NativeInterrupts::trigger(uint8_t pin) {
+  if (interruptsEnabled && interruptHandlers[pin] != NULL) {
+    interruptHandlers[pin]();
+  }
+}
+
+long random(long max) {
+  return max <= 0 ? 0 : (rand() % max);
+}
+
+long random(long min, long max) {
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+  srand(seed);
+}
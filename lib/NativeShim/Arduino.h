@@ -0,0 +1,124 @@
+/*
+ * Host-side stand-in for the Arduino core.  Only compiled for the `native`
+ * PlatformIO environment (see library.json).
+ *
+ * Time is virtual: millis()/micros() report a clock that only moves when
+ * delay(), delayMicroseconds() or NativeClock::advance*() are called, which
+ * keeps tests deterministic.
+ */
+
+#ifndef _NATIVE_ARDUINO_H
+#define _NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <functional>
+
+#include <WString.h>
+#include <Print.h>
+#include <Stream.h>
+#include <pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+// Interrupt handlers have to live in IRAM on the ESP8266
+#define ICACHE_RAM_ATTR
+
+#define _BV(b) (1UL << (b))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+template <typename A, typename B>
+inline auto min(const A& a, const B& b) -> decltype(a < b ? a : b) { return b < a ? b : a; }
+
+template <typename A, typename B>
+inline auto max(const A& a, const B& b) -> decltype(a < b ? a : b) { return a < b ? b : a; }
+
+template <typename T, typename L, typename H>
+inline T constrain(const T& x, const L& low, const H& high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+namespace NativeClock {
+  void reset();
+  void advanceMicros(unsigned long us);
+  void advanceMillis(unsigned long ms);
+}
+
+// Interrupts never fire on their own.  Tests raise them with trigger(), which
+// runs the attached handler unless interrupts are disabled.
+namespace NativeInterrupts {
+  void trigger(uint8_t pin);
+}
+
+// Pins hold whatever was last written to them, unless a handler is attached.
+// Handlers let tests model a chip that drives a pin, or reacts to one.
+namespace NativePins {
+  void onRead(uint8_t pin, std::function<int()> handler);
+  void onWrite(uint8_t pin, std::function<void(uint8_t)> handler);
+  void clearHandlers();
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) { }
+  void setDebugOutput(bool) { }
+
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+  virtual size_t write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
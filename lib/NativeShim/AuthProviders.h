@@ -0,0 +1,4 @@
+// Settings.h pulls this in from RichHttpServer, which isn't built on the host.
+#ifndef _NATIVE_AUTH_PROVIDERS_H
+#define _NATIVE_AUTH_PROVIDERS_H
+#endif
@@ -0,0 +1,4 @@
+#include <ESP8266WiFi.h>
+
+NativeWiFiClass WiFi;
+NativeEspClass ESP;
@@ -0,0 +1,26 @@
+#ifndef _NATIVE_ESP8266_WIFI_H
+#define _NATIVE_ESP8266_WIFI_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+class NativeWiFiClass {
+public:
+  IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+  String macAddress() const { return String("00:00:00:00:00:00"); }
+  int hostByName(const char*, IPAddress& result) { result = localIP(); return 1; }
+};
+
+class NativeEspClass {
+public:
+  uint32_t getFreeHeap() const { return 0; }
+  String getResetReason() const { return String("Native"); }
+  String getCoreVersion() const { return String("native"); }
+  uint32_t getChipId() const { return 0; }
+  void restart() { }
+};
+
+extern NativeWiFiClass WiFi;
+extern NativeEspClass ESP;
+
+#endif
@@ -0,0 +1,3 @@
+#include <FS.h>
+
+FS SPIFFS;
@@ -0,0 +1,253 @@
+/*
+ * In-memory replacement for the ESP8266 SPIFFS API.
+ */
+
+#ifndef _NATIVE_FS_H
+#define _NATIVE_FS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+namespace fs {
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+// Counts of flash-costly operations, used to compare storage layouts
+struct FSStats {
+  FSStats() : writeOpens(0), bytesWritten(0), creates(0), removes(0), renames(0) { }
+
+  size_t writeOpens;
+  size_t bytesWritten;
+  size_t creates;
+  size_t removes;
+  size_t renames;
+};
+
+class FS;
+
+class File : public Stream {
+public:
+  File() : position_(0), readable(false), writable(false), fs(NULL) { }
+  File(std::shared_ptr<std::string> data, const String& name, bool readable, bool writable, size_t position, FS* fs = NULL)
+    : data(data),
+      name_(name),
+      position_(position),
+      readable(readable),
+      writable(writable),
+      fs(fs)
+  { }
+
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+  virtual int available() { return (data && readable && position_ < data->size()) ? data->size() - position_ : 0; }
+  virtual int read() { return available() ? static_cast<uint8_t>((*data)[position_++]) : -1; }
+  virtual int peek() { return available() ? static_cast<uint8_t>((*data)[position_]) : -1; }
+  virtual void flush() { }
+
+  size_t read(uint8_t* buffer, size_t size) { return readBytes(buffer, size); }
+
+  bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+    if (!data) {
+      return false;
+    }
+    size_t base = mode == SeekSet ? 0 : (mode == SeekCur ? position_ : data->size());
+    position_ = base + pos;
+    return position_ <= data->size();
+  }
+
+  size_t position() const { return position_; }
+  size_t size() const { return data ? data->size() : 0; }
+  const char* name() const { return name_.c_str(); }
+  void close() { data.reset(); }
+
+  operator bool() const { return static_cast<bool>(data); }
+
+private:
+  std::shared_ptr<std::string> data;
+  String name_;
+  size_t position_;
+  bool readable;
+  bool writable;
+  FS* fs;
+};
+
+// Iterates over files whose names start with a prefix
+class Dir {
+public:
+  Dir() : fs(NULL), started(false) { }
+  Dir(FS* fs, const std::string& prefix) : fs(fs), prefix(prefix), started(false) { }
+
+  bool next();
+  String fileName() const { return String(current.c_str()); }
+  File openFile(const char* mode);
+
+private:
+  FS* fs;
+  std::string prefix;
+  std::string current;
+  bool started;
+};
+
+class FS {
+public:
+  FS() : capacity(0) { }
+
+  bool begin() { return true; }
+  void end() { }
+  // Also lifts any limit set with setCapacity()
+  bool format() { files.clear(); capacity = 0; return true; }
+
+  // Limits the total size of all files, to simulate a full filesystem.  Like
+  // SPIFFS, writes that don't fit are cut short.  0 means no limit.
+  void setCapacity(size_t bytes) { capacity = bytes; }
+  size_t bytesFree() const {
+    if (capacity == 0) {
+      return SIZE_MAX;
+    }
+
+    size_t used = 0;
+    for (std::map<std::string, std::shared_ptr<std::string>>::const_iterator it = files.begin(); it != files.end(); ++it) {
+      used += it->second->size();
+    }
+    return used < capacity ? capacity - used : 0;
+  }
+
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+  File open(const char* path, const char* mode) {
+    bool plus = strchr(mode, '+') != NULL;
+    std::map<std::string, std::shared_ptr<std::string>>::iterator it = files.find(path);
+
+    if (mode[0] == 'r') {
+      if (it == files.end()) {
+        return File();
+      }
+      if (plus) {
+        ++stats.writeOpens;
+      }
+      return File(it->second, path, true, plus, 0, this);
+    }
+
+    if (it == files.end()) {
+      it = files.insert(std::make_pair(std::string(path), std::make_shared<std::string>())).first;
+      ++stats.creates;
+    }
+
+    ++stats.writeOpens;
+
+    if (mode[0] == 'w') {
+      it->second->clear();
+      return File(it->second, path, plus, true, 0, this);
+    } else if (mode[0] == 'a') {
+      return File(it->second, path, plus, true, it->second->size(), this);
+    }
+
+    return File();
+  }
+
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool exists(const char* path) { return files.count(path) > 0; }
+
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool remove(const char* path) {
+    if (files.erase(path) == 0) {
+      return false;
+    }
+    ++stats.removes;
+    return true;
+  }
+
+  bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+  bool rename(const char* from, const char* to) {
+    std::map<std::string, std::shared_ptr<std::string>>::iterator it = files.find(from);
+    if (it == files.end()) {
+      return false;
+    }
+    files[to] = it->second;
+    files.erase(it);
+    ++stats.renames;
+    return true;
+  }
+
+  Dir openDir(const String& path) { return openDir(path.c_str()); }
+  Dir openDir(const char* path) { return Dir(this, path); }
+
+  size_t fileCount() const { return files.size(); }
+
+  const FSStats& getStats() const { return stats; }
+  void resetStats() { stats = FSStats(); }
+
+private:
+  friend class Dir;
+  friend class File;
+
+  std::map<std::string, std::shared_ptr<std::string>> files;
+  FSStats stats;
+  size_t capacity;
+};
+
+inline size_t File::write(const uint8_t* buffer, size_t size) {
+  if (!data || !writable) {
+    return 0;
+  }
+  if (position_ > data->size()) {
+    data->resize(position_);
+  }
+  if (fs) {
+    // Overwriting existing bytes takes no extra space
+    size_t growth = position_ + size > data->size() ? position_ + size - data->size() : 0;
+    size_t available = fs->bytesFree();
+
+    if (growth > available) {
+      size -= growth - available;
+    }
+  }
+  data->replace(position_, size, reinterpret_cast<const char*>(buffer), size);
+  position_ += size;
+  if (fs) {
+    fs->stats.bytesWritten += size;
+  }
+  return size;
+}
+
+inline bool Dir::next() {
+  std::map<std::string, std::shared_ptr<std::string>>::iterator it = started
+    ? fs->files.upper_bound(current)
+    : fs->files.lower_bound(prefix);
+  started = true;
+
+  if (it == fs->files.end() || it->first.compare(0, prefix.size(), prefix) != 0) {
+    current.clear();
+    return false;
+  }
+
+  current = it->first;
+  return true;
+}
+
+inline File Dir::openFile(const char* mode) {
+  return fs->open(current.c_str(), mode);
+}
+
+}
+
+using fs::FS;
+using fs::File;
+using fs::Dir;
+using fs::FSStats;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+extern FS SPIFFS;
+
+#endif
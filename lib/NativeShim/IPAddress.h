@@ -0,0 +1,34 @@
+#ifndef _NATIVE_IP_ADDRESS_H
+#define _NATIVE_IP_ADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  IPAddress() : bytes{0, 0, 0, 0} { }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} { }
+
+  uint8_t operator[](int index) const { return bytes[index]; }
+  uint8_t& operator[](int index) { return bytes[index]; }
+  bool operator==(const IPAddress& other) const { return memcmp(bytes, other.bytes, sizeof(bytes)) == 0; }
+
+  bool fromString(const String& s) {
+    unsigned int a, b, c, d;
+    if (sscanf(s.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d) != 4) {
+      return false;
+    }
+    bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d;
+    return true;
+  }
+
+  String toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return String(buffer);
+  }
+
+private:
+  uint8_t bytes[4];
+};
+
+#endif
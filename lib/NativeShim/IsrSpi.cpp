@@ -0,0 +1,22 @@
+/*
+ * Host version of IsrSpi::transfer(), going through the SPI stub so that
+ * simulated radios see the same bytes and CS changes the real one makes.
+ */
+
+#include <IsrSpi.h>
+
+void IsrSpi::transfer(uint8_t csPin, uint8_t dataMode, const uint8_t* out, uint8_t* in, size_t length) {
+  if (length == 0 || length > ISR_SPI_MAX_TRANSFER) {
+    return;
+  }
+
+  uint8_t buffer[ISR_SPI_MAX_TRANSFER];
+  memcpy(buffer, out, length);
+
+  const uint8_t savedMode = SPI.dataMode;
+  SPI.setDataMode(dataMode);
+  digitalWrite(csPin, LOW);
+  SPI.transferBytes(buffer, in, length);
+  digitalWrite(csPin, HIGH);
+  SPI.setDataMode(savedMode);
+}
@@ -0,0 +1,53 @@
+#include <NativeHeap.h>
+#include <new>
+#include <stdlib.h>
+
+static size_t allocations = 0;
+
+size_t NativeHeap::allocationCount() {
+  return allocations;
+}
+
+static void* countedAlloc(size_t size) {
+  ++allocations;
+
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == NULL) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new(size_t size) {
+  return countedAlloc(size);
+}
+
+void* operator new[](size_t size) {
+  return countedAlloc(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++allocations;
+  return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  ++allocations;
+  return malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
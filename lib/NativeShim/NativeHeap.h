@@ -0,0 +1,20 @@
+/*
+ * Counts heap allocations made through operator new, so tests can check that
+ * code paths don't allocate once warmed up:
+ *
+ *   size_t before = NativeHeap::allocationCount();
+ *   ...
+ *   TEST_ASSERT_EQUAL_INT(before, NativeHeap::allocationCount());
+ */
+
+#ifndef _NATIVE_HEAP_H
+#define _NATIVE_HEAP_H
+
+#include <stddef.h>
+
+namespace NativeHeap {
+  // Total number of allocations since program start
+  size_t allocationCount();
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef _NATIVE_PRINT_H
+#define _NATIVE_PRINT_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <WString.h>
+#include <pgmspace.h>
+
+class Print {
+public:
+  virtual ~Print() { }
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t write(const char* str) { return str == NULL ? 0 : write(reinterpret_cast<const uint8_t*>(str), strlen(str)); }
+  size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+  virtual void flush() { }
+
+  size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(unsigned char n, int base = DEC) { return print(String(n, base)); }
+  size_t print(int n, int base = DEC) { return print(String(n, base)); }
+  size_t print(unsigned int n, int base = DEC) { return print(String(n, base)); }
+  size_t print(long n, int base = DEC) { return print(String(n, base)); }
+  size_t print(unsigned long n, int base = DEC) { return print(String(n, base)); }
+  size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+
+  template <typename T>
+  size_t println(const T& value) { return print(value) + println(); }
+  template <typename T>
+  size_t println(const T& value, int base) { return print(value, base) + println(); }
+  size_t println() { return write("\r\n"); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprint(format, args);
+    va_end(args);
+    return n;
+  }
+
+private:
+  size_t vprint(const char* format, va_list args) {
+    char buf[256];
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    if (len < 0) {
+      return 0;
+    }
+    return write(buf, len < static_cast<int>(sizeof(buf)) ? len : sizeof(buf) - 1);
+  }
+};
+
+#endif
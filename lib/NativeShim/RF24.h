@@ -0,0 +1,331 @@
+/*
+ * Stand-in for the TMRh20 RF24 driver, backed by a small model of the nRF24's
+ * registers and RX FIFO.
+ *
+ * Each call costs roughly as many SPI transactions as the real driver (v1.3)
+ * issues for it, and each transaction advances the virtual clock by
+ * RF24_SIMULATED_SPI_MICROS.  begin() and powering up also include the real
+ * driver's delays.  That makes it possible to compare how much listen time a
+ * receive path gives up to talking to the radio.
+ *
+ * Frames only reach the RX FIFO while the radio is listening on the right
+ * channel, and the FIFO holds three of them.  Written frames are recorded.
+ *
+ * Once begun, it also answers the SPI stub while its CSN pin is low, for code
+ * that talks to the radio without the driver (see IsrSpi).  Only the commands
+ * it takes to receive a packet are understood: NOP, R_RX_PAYLOAD, FLUSH_RX
+ * and writing STATUS.
+ */
+
+#ifndef __RF24_H__
+#define __RF24_H__
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <deque>
+#include <vector>
+
+// Time taken by one SPI transaction (CSN low, command, data, CSN high)
+#ifndef RF24_SIMULATED_SPI_MICROS
+#define RF24_SIMULATED_SPI_MICROS 5
+#endif
+
+typedef enum { RF24_PA_MIN = 0, RF24_PA_LOW, RF24_PA_HIGH, RF24_PA_MAX, RF24_PA_ERROR } rf24_pa_dbm_e;
+typedef enum { RF24_1MBPS = 0, RF24_2MBPS, RF24_250KBPS } rf24_datarate_e;
+typedef enum { RF24_CRC_DISABLED = 0, RF24_CRC_8, RF24_CRC_16 } rf24_crclength_e;
+
+class RF24 {
+public:
+  static const size_t RX_FIFO_DEPTH = 3;
+
+  RF24(uint16_t cePin, uint16_t csnPin)
+    : spiTransactions(0),
+      begins(0),
+      droppedFrames(0),
+      cePin(cePin),
+      csnPin(csnPin),
+      payloadSize(32),
+      listening(false),
+      airChannel(0),
+      airPeriod(0),
+      nextAirFrame(0),
+      nextArrival(0),
+      spiAttached(false)
+  {
+    powerCycle();
+  }
+
+  ~RF24() {
+    if (spiAttached) {
+      NativePins::onWrite(csnPin, nullptr);
+    }
+  }
+
+  bool begin() {
+    ++begins;
+    attachSpi();
+    wait(5000);
+
+    // Reset CONFIG, then setRetries, setPALevel, setDataRate (twice), read
+    // RF_SETUP, toggle_features, FEATURE, DYNPD, STATUS, setChannel,
+    // flush_rx, flush_tx
+    setRegister(CONFIG, 0x0C);
+    transactions(19);
+    setRegister(RF_CH, 76);
+    rxFifo.clear();
+
+    powerUp();
+    transactions(2);
+    listening = false;
+
+    return true;
+  }
+
+  void setAutoAck(bool) { transactions(1); }
+  bool setDataRate(rf24_datarate_e) { transactions(3); return true; }
+  void disableCRC() { transactions(2); }
+  void setAddressWidth(uint8_t width) { setRegister(SETUP_AW, width - 2); }
+  void setPALevel(uint8_t) { transactions(2); }
+  void maskIRQ(bool, bool, bool) { transactions(2); }
+  void openWritingPipe(const uint8_t*) { transactions(3); }
+  void openReadingPipe(uint8_t, const uint8_t*) { transactions(4); }
+  void setChannel(uint8_t channel) { setRegister(RF_CH, channel); }
+  uint8_t getChannel() { return getRegister(RF_CH); }
+  void setPayloadSize(uint8_t size) { payloadSize = size; }
+
+  bool isChipConnected() {
+    uint8_t setup = getRegister(SETUP_AW);
+    return setup >= 1 && setup <= 3;
+  }
+
+  void startListening() {
+    powerUp();
+    // CONFIG read/write, STATUS, RX_ADDR_P0 and FEATURE
+    transactions(5);
+    registers[CONFIG] |= PRIM_RX;
+    listening = true;
+  }
+
+  void stopListening() {
+    transactions(1);
+    listening = false;
+    wait(85);
+    transactions(4);
+    registers[CONFIG] &= ~PRIM_RX;
+  }
+
+  bool available() {
+    transactions(1);
+    return !rxFifo.empty();
+  }
+
+  bool rxFifoFull() {
+    transactions(1);
+    return rxFifo.size() == RX_FIFO_DEPTH;
+  }
+
+  void flush_rx() {
+    transactions(1);
+    rxFifo.clear();
+  }
+
+  void read(void* buffer, uint8_t length) {
+    // R_RX_PAYLOAD, then clear RX_DR in STATUS
+    transactions(2);
+
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    memset(out, 0, length);
+    if (!rxFifo.empty()) {
+      const std::vector<uint8_t>& frame = rxFifo.front();
+      memcpy(out, frame.data(), min(frame.size(), static_cast<size_t>(length)));
+      rxFifo.pop_front();
+    }
+  }
+
+  bool write(const void* buffer, uint8_t length) {
+    transactions(4);
+    const uint8_t* in = static_cast<const uint8_t*>(buffer);
+    txFrames.push_back(std::vector<uint8_t>(in, in + length));
+    return true;
+  }
+
+  // Test hooks
+
+  // Delivers a frame right away, as long as the radio is listening and the
+  // RX FIFO has room
+  void inject(const uint8_t* frame, size_t length) {
+    deliver(std::vector<uint8_t>(frame, frame + length));
+  }
+
+  // Something on air transmitting these frames in turn, one every periodMicros
+  // on the given nRF24 channel
+  void setAirTraffic(const std::vector<std::vector<uint8_t>>& frames, uint8_t channel, unsigned long periodMicros) {
+    catchUp();
+    airFrames = frames;
+    airChannel = channel;
+    airPeriod = periodMicros;
+    nextAirFrame = 0;
+    nextArrival = micros() + periodMicros;
+  }
+
+  // Registers go back to their power-on values, as after a brownout
+  void powerCycle() {
+    catchUp();
+    memset(registers, 0, sizeof(registers));
+    registers[CONFIG] = 0x08;
+    registers[EN_AA] = 0x3F;
+    registers[EN_RXADDR] = 0x03;
+    registers[SETUP_AW] = 0x03;
+    registers[RF_CH] = 0x02;
+    registers[RF_SETUP] = 0x0F;
+    registers[STATUS] = 0x0E;
+    listening = false;
+    rxFifo.clear();
+  }
+
+  std::vector<std::vector<uint8_t>> txFrames;
+  size_t spiTransactions;
+  size_t begins;
+  // Frames that were on air while listening, but found the RX FIFO full
+  size_t droppedFrames;
+
+private:
+  enum Register { CONFIG = 0x00, EN_AA = 0x01, EN_RXADDR = 0x02, SETUP_AW = 0x03, RF_CH = 0x05, RF_SETUP = 0x06, STATUS = 0x07 };
+  enum Command { R_RX_PAYLOAD = 0x61, FLUSH_RX = 0xE2 };
+  static const uint8_t PWR_UP = 0x02;
+  static const uint8_t PRIM_RX = 0x01;
+
+  uint16_t cePin;
+  uint16_t csnPin;
+  uint8_t payloadSize;
+  uint8_t registers[0x20];
+  bool listening;
+  std::deque<std::vector<uint8_t>> rxFifo;
+
+  std::vector<std::vector<uint8_t>> airFrames;
+  uint8_t airChannel;
+  unsigned long airPeriod;
+  size_t nextAirFrame;
+  unsigned long nextArrival;
+
+  // Hooked up in begin(), by which time the object has stopped being copied
+  // around (e.g. into NRF24Factory)
+  bool spiAttached;
+  std::vector<uint8_t> spiCommand;
+  SPIClass::Responder otherResponder;
+
+  void attachSpi() {
+    if (spiAttached) {
+      return;
+    }
+    spiAttached = true;
+
+    NativePins::onWrite(csnPin, [this](uint8_t value) {
+      if (value == LOW) {
+        catchUp();
+        spiCommand.clear();
+        otherResponder = SPI.responder;
+        SPI.responder = [this](uint8_t data) { return spiTransfer(data); };
+      } else {
+        SPI.responder = otherResponder;
+        endSpiCommand();
+        transactions(1);
+      }
+    });
+  }
+
+  // STATUS: RX_DR and the pipe the first frame in the RX FIFO came in on
+  // (always 1 here), or all of RX_P_NO set if it's empty
+  uint8_t status() const {
+    return rxFifo.empty() ? 0x0E : 0x42;
+  }
+
+  uint8_t spiTransfer(uint8_t data) {
+    const size_t position = spiCommand.size();
+    spiCommand.push_back(data);
+
+    if (position == 0) {
+      return status();
+    }
+
+    if (spiCommand[0] == R_RX_PAYLOAD && !rxFifo.empty() && position <= rxFifo.front().size()) {
+      return rxFifo.front()[position - 1];
+    }
+
+    return 0;
+  }
+
+  void endSpiCommand() {
+    if (spiCommand.empty()) {
+      return;
+    }
+
+    if (spiCommand[0] == R_RX_PAYLOAD && !rxFifo.empty()) {
+      rxFifo.pop_front();
+    } else if (spiCommand[0] == FLUSH_RX) {
+      rxFifo.clear();
+    }
+  }
+
+  bool receiving() const {
+    return listening && (registers[CONFIG] & (PWR_UP | PRIM_RX)) == (PWR_UP | PRIM_RX);
+  }
+
+  void deliver(const std::vector<uint8_t>& frame) {
+    if (!receiving()) {
+      return;
+    }
+
+    if (rxFifo.size() == RX_FIFO_DEPTH) {
+      ++droppedFrames;
+    } else {
+      rxFifo.push_back(frame);
+    }
+  }
+
+  // Delivers frames that went out on air since the last call.  Every call
+  // that changes whether the radio is receiving runs this first.
+  void catchUp() {
+    if (airPeriod == 0) {
+      return;
+    }
+
+    while (nextArrival <= micros()) {
+      if (registers[RF_CH] == airChannel) {
+        deliver(airFrames[nextAirFrame]);
+      }
+
+      nextAirFrame = (nextAirFrame + 1) % airFrames.size();
+      nextArrival += airPeriod;
+    }
+  }
+
+  void wait(unsigned long us) {
+    delayMicroseconds(us);
+    catchUp();
+  }
+
+  void transactions(size_t count) {
+    spiTransactions += count;
+    wait(count * RF24_SIMULATED_SPI_MICROS);
+  }
+
+  uint8_t getRegister(uint8_t reg) {
+    transactions(1);
+    return registers[reg];
+  }
+
+  void setRegister(uint8_t reg, uint8_t value) {
+    transactions(1);
+    registers[reg] = value;
+  }
+
+  void powerUp() {
+    if (!(getRegister(CONFIG) & PWR_UP)) {
+      setRegister(CONFIG, registers[CONFIG] | PWR_UP);
+      wait(5000);
+    }
+  }
+};
+
+#endif
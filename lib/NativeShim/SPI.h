@@ -0,0 +1,77 @@
+/*
+ * SPI bus stub.  Transfers are counted and answered with whatever the
+ * attached responder returns (0 by default).  Multi-byte writes count one
+ * transfer per byte, and one call.
+ */
+
+#ifndef _NATIVE_SPI_H
+#define _NATIVE_SPI_H
+
+#include <Arduino.h>
+#include <functional>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+class SPISettings {
+public:
+  SPISettings() { }
+  SPISettings(uint32_t, uint8_t, uint8_t) { }
+};
+
+class SPIClass {
+public:
+  typedef std::function<uint8_t(uint8_t)> Responder;
+
+  SPIClass() : dataMode(SPI_MODE0), transfers(0), calls(0) { }
+
+  void begin() { }
+  void end() { }
+  void setBitOrder(uint8_t) { }
+  void setDataMode(uint8_t mode) { dataMode = mode; }
+  void setFrequency(uint32_t) { }
+  void setClockDivider(uint32_t) { }
+  void beginTransaction(SPISettings) { }
+  void endTransaction() { }
+
+  uint8_t transfer(uint8_t data) {
+    ++calls;
+    return exchange(data);
+  }
+
+  void writeBytes(uint8_t* data, uint32_t size) {
+    ++calls;
+    for (uint32_t i = 0; i < size; i++) {
+      exchange(data[i]);
+    }
+  }
+
+  void transferBytes(uint8_t* out, uint8_t* in, uint32_t size) {
+    ++calls;
+    for (uint32_t i = 0; i < size; i++) {
+      uint8_t received = exchange(out != NULL ? out[i] : 0xFF);
+      if (in != NULL) {
+        in[i] = received;
+      }
+    }
+  }
+
+  Responder responder;
+  uint8_t dataMode;
+  // Bytes exchanged
+  size_t transfers;
+  // Calls to transfer(), writeBytes() and transferBytes()
+  size_t calls;
+
+private:
+  uint8_t exchange(uint8_t data) {
+    ++transfers;
+    return responder ? responder(data) : 0;
+  }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef _NATIVE_STREAM_H
+#define _NATIVE_STREAM_H
+
+#include <Print.h>
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long) { }
+
+  size_t readBytes(char* buffer, size_t length) { return readBytes(reinterpret_cast<uint8_t*>(buffer), length); }
+  virtual size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = read();
+      if (c < 0) {
+        break;
+      }
+      *buffer++ = static_cast<uint8_t>(c);
+      count++;
+    }
+    return count;
+  }
+
+  String readString() {
+    String s;
+    int c;
+    while ((c = read()) >= 0) {
+      s += static_cast<char>(c);
+    }
+    return s;
+  }
+};
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Minimal Arduino String built on top of std::string.  Only the parts of the
+ * API used by the hub and its dependencies are implemented.
+ */
+
+#ifndef _NATIVE_WSTRING_H
+#define _NATIVE_WSTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <strings.h>
+#include <ctype.h>
+#include <string>
+
+class __FlashStringHelper;
+
+#define HEX 16
+#define DEC 10
+#define OCT 8
+#define BIN 2
+
+class String {
+public:
+  String() { }
+  String(const char* s) : str(s != NULL ? s : "") { }
+  String(const __FlashStringHelper* s) : str(s != NULL ? reinterpret_cast<const char*>(s) : "") { }
+  String(const std::string& s) : str(s) { }
+  String(const String& other) = default;
+  String(String&& other) = default;
+  explicit String(char c) : str(1, c) { }
+  explicit String(unsigned char value, unsigned char base = 10) { fromUnsigned(value, base); }
+  explicit String(int value, unsigned char base = 10) { fromSigned(value, base); }
+  explicit String(unsigned int value, unsigned char base = 10) { fromUnsigned(value, base); }
+  explicit String(long value, unsigned char base = 10) { fromSigned(value, base); }
+  explicit String(unsigned long value, unsigned char base = 10) { fromUnsigned(value, base); }
+  explicit String(float value, unsigned char decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+  explicit String(double value, unsigned char decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+
+  String& operator=(const String& other) = default;
+  String& operator=(String&& other) = default;
+  String& operator=(const char* s) { str = (s != NULL ? s : ""); return *this; }
+
+  unsigned int length() const { return str.length(); }
+  const char* c_str() const { return str.c_str(); }
+  bool reserve(unsigned int size) { str.reserve(size); return true; }
+
+  bool concat(const String& s) { str += s.str; return true; }
+  bool concat(const char* s) { if (s) str += s; return true; }
+  bool concat(char c) { str += c; return true; }
+  bool concat(unsigned char c) { str += String(c).str; return true; }
+  bool concat(int v) { str += String(v).str; return true; }
+  bool concat(unsigned int v) { str += String(v).str; return true; }
+  bool concat(long v) { str += String(v).str; return true; }
+  bool concat(unsigned long v) { str += String(v).str; return true; }
+  bool concat(double v) { str += String(v).str; return true; }
+
+  template <typename T>
+  String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+  friend String operator+(const String& lhs, const String& rhs) { return String(lhs.str + rhs.str); }
+  friend String operator+(const String& lhs, const char* rhs) { return String(lhs.str + (rhs ? rhs : "")); }
+  friend String operator+(const char* lhs, const String& rhs) { return String((lhs ? lhs : "") + rhs.str); }
+  friend String operator+(const String& lhs, char rhs) { return String(lhs.str + rhs); }
+
+  bool equals(const String& s) const { return str == s.str; }
+  bool equals(const char* s) const { return str == (s ? s : ""); }
+  bool equalsIgnoreCase(const String& s) const { return strcasecmp(str.c_str(), s.c_str()) == 0; }
+  bool operator==(const String& s) const { return equals(s); }
+  bool operator==(const char* s) const { return equals(s); }
+  bool operator!=(const String& s) const { return !equals(s); }
+  bool operator!=(const char* s) const { return !equals(s); }
+  bool operator<(const String& s) const { return str < s.str; }
+  bool operator>(const String& s) const { return str > s.str; }
+  int compareTo(const String& s) const { return str.compare(s.str); }
+
+  bool startsWith(const String& prefix) const { return str.compare(0, prefix.str.length(), prefix.str) == 0; }
+  bool endsWith(const String& suffix) const {
+    return str.length() >= suffix.str.length()
+      && str.compare(str.length() - suffix.str.length(), suffix.str.length(), suffix.str) == 0;
+  }
+
+  char charAt(unsigned int index) const { return index < str.length() ? str[index] : 0; }
+  void setCharAt(unsigned int index, char c) { if (index < str.length()) str[index] = c; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index) { return str[index]; }
+
+  int indexOf(char c, unsigned int from = 0) const { return toIndex(str.find(c, from)); }
+  int indexOf(const String& s, unsigned int from = 0) const { return toIndex(str.find(s.str, from)); }
+  int lastIndexOf(char c) const { return toIndex(str.rfind(c)); }
+  int lastIndexOf(const String& s) const { return toIndex(str.rfind(s.str)); }
+
+  String substring(unsigned int from) const { return from < str.length() ? String(str.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int tmp = from; from = to; to = tmp; }
+    if (from >= str.length()) return String();
+    return String(str.substr(from, to - from));
+  }
+
+  void toLowerCase() { for (char& c : str) c = tolower(c); }
+  void toUpperCase() { for (char& c : str) c = toupper(c); }
+  void trim() {
+    size_t start = str.find_first_not_of(" \t\r\n");
+    size_t end = str.find_last_not_of(" \t\r\n");
+    str = (start == std::string::npos) ? std::string() : str.substr(start, end - start + 1);
+  }
+  void remove(unsigned int index) { if (index < str.length()) str.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < str.length()) str.erase(index, count); }
+  void replace(const String& find, const String& replace) {
+    if (find.str.empty()) return;
+    size_t pos = 0;
+    while ((pos = str.find(find.str, pos)) != std::string::npos) {
+      str.replace(pos, find.str.length(), replace.str);
+      pos += replace.str.length();
+    }
+  }
+
+  long toInt() const { return strtol(str.c_str(), NULL, 10); }
+  float toFloat() const { return strtof(str.c_str(), NULL); }
+
+  void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const { getBytes(reinterpret_cast<unsigned char*>(buf), bufsize, index); }
+  void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const {
+    if (bufsize == 0) return;
+    size_t n = index < str.length() ? str.copy(reinterpret_cast<char*>(buf), bufsize - 1, index) : 0;
+    buf[n] = 0;
+  }
+
+private:
+  std::string str;
+
+  static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : static_cast<int>(pos); }
+
+  void fromUnsigned(unsigned long value, unsigned char base) {
+    char buf[8 * sizeof(long) + 1];
+    char* ptr = buf + sizeof(buf) - 1;
+    *ptr = 0;
+    do {
+      unsigned char digit = value % base;
+      *--ptr = digit < 10 ? ('0' + digit) : ('a' + digit - 10);
+      value /= base;
+    } while (value);
+    str = ptr;
+  }
+
+  void fromSigned(long value, unsigned char base) {
+    if (value < 0 && base == 10) {
+      fromUnsigned(static_cast<unsigned long>(-value), base);
+      str.insert(0, 1, '-');
+    } else {
+      fromUnsigned(static_cast<unsigned long>(value), base);
+    }
+  }
+
+  void fromDouble(double value, unsigned char decimalPlaces) {
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+    str = buf;
+  }
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Loopback UDP socket.  Tests queue inbound datagrams with inject() and
+ * inspect whatever the code under test sent through sentPackets.
+ */
+
+#ifndef _NATIVE_WIFI_UDP_H
+#define _NATIVE_WIFI_UDP_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <deque>
+#include <vector>
+
+class WiFiUDP : public Stream {
+public:
+  struct Datagram {
+    IPAddress ip;
+    uint16_t port;
+    std::vector<uint8_t> data;
+  };
+
+  WiFiUDP() : localPort(0), readPosition(0) { }
+
+  uint8_t begin(uint16_t port) { localPort = port; return 1; }
+  void stop() { localPort = 0; inbound.clear(); current.data.clear(); }
+
+  void inject(const uint8_t* data, size_t length, IPAddress ip = IPAddress(127, 0, 0, 1), uint16_t port = 0) {
+    inbound.push_back(Datagram{ip, port, std::vector<uint8_t>(data, data + length)});
+  }
+
+  int parsePacket() {
+    if (inbound.empty()) {
+      return 0;
+    }
+    current = inbound.front();
+    inbound.pop_front();
+    readPosition = 0;
+    return current.data.size();
+  }
+
+  virtual int available() { return current.data.size() - readPosition; }
+  virtual int read() { return available() > 0 ? current.data[readPosition++] : -1; }
+  virtual int peek() { return available() > 0 ? current.data[readPosition] : -1; }
+  int read(uint8_t* buffer, size_t length) { return readBytes(buffer, length); }
+  int read(char* buffer, size_t length) { return readBytes(buffer, length); }
+
+  IPAddress remoteIP() const { return current.ip; }
+  uint16_t remotePort() const { return current.port; }
+
+  int beginPacket(IPAddress ip, uint16_t port) {
+    outbound = Datagram{ip, port, std::vector<uint8_t>()};
+    return 1;
+  }
+  virtual size_t write(uint8_t c) { outbound.data.push_back(c); return 1; }
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    outbound.data.insert(outbound.data.end(), buffer, buffer + size);
+    return size;
+  }
+  using Print::write;
+  int endPacket() { sentPackets.push_back(outbound); return 1; }
+
+  std::vector<Datagram> sentPackets;
+
+private:
+  uint16_t localPort;
+  std::deque<Datagram> inbound;
+  Datagram current;
+  Datagram outbound;
+  size_t readPosition;
+};
+
+#endif
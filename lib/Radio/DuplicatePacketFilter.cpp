@@ -0,0 +1,46 @@
+#include <DuplicatePacketFilter.h>
+
+DuplicatePacketFilter::DuplicatePacketFilter(unsigned long windowMillis)
+  : windowMillis(windowMillis),
+    nextEntry(0)
+{
+  memset(entries, 0, sizeof(entries));
+}
+
+bool ICACHE_RAM_ATTR DuplicatePacketFilter::isDuplicate(const MiLightRadioConfig& config, const uint8_t* packet, size_t length) {
+  if (windowMillis == 0) {
+    return false;
+  }
+
+  const uint32_t packetHash = hash(packet, length);
+  const unsigned long now = millis();
+
+  for (size_t i = 0; i < DUPLICATE_PACKET_FILTER_SIZE; i++) {
+    Entry& entry = entries[i];
+
+    if (entry.config == &config && entry.hash == packetHash) {
+      bool duplicate = (now - entry.seenAt) < windowMillis;
+      entry.seenAt = now;
+      return duplicate;
+    }
+  }
+
+  Entry& entry = entries[nextEntry];
+  entry.config = &config;
+  entry.hash = packetHash;
+  entry.seenAt = now;
+  nextEntry = (nextEntry + 1) % DUPLICATE_PACKET_FILTER_SIZE;
+
+  return false;
+}
+
+// 32-bit FNV-1a, with the length mixed in first
+uint32_t ICACHE_RAM_ATTR DuplicatePacketFilter::hash(const uint8_t* packet, size_t length) {
+  uint32_t result = (2166136261UL ^ length) * 16777619UL;
+
+  for (size_t i = 0; i < length; i++) {
+    result = (result ^ packet[i]) * 16777619UL;
+  }
+
+  return result;
+}
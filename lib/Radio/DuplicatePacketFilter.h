@@ -0,0 +1,44 @@
+#include <Arduino.h>
+#include <MiLightRadioConfig.h>
+
+#ifndef _DUPLICATE_PACKET_FILTER_H
+#define _DUPLICATE_PACKET_FILTER_H
+
+// Number of distinct recent packets remembered
+#ifndef DUPLICATE_PACKET_FILTER_SIZE
+#define DUPLICATE_PACKET_FILTER_SIZE 64
+#endif
+
+/*
+ * Remotes send each button press on three channels, and repeat it many times
+ * on each.  This remembers recently received packets so that every copy after
+ * the first can be dropped, whichever channel or radio it came in on.
+ *
+ * A packet counts as a duplicate if the same bytes were received with the
+ * same radio config less than windowMillis ago.  Each repeat restarts the
+ * window, so a press is only reported once no matter how long it's repeated.
+ */
+class DuplicatePacketFilter {
+public:
+  DuplicatePacketFilter(unsigned long windowMillis);
+
+  // Remembers the packet, and returns true if it's a duplicate
+  bool isDuplicate(const MiLightRadioConfig& config, const uint8_t* packet, size_t length);
+
+private:
+  struct Entry {
+    const MiLightRadioConfig* config;
+    uint32_t hash;
+    unsigned long seenAt;
+  };
+
+  const unsigned long windowMillis;
+  Entry entries[DUPLICATE_PACKET_FILTER_SIZE];
+  // Entry to overwrite next.  Entries are written in order, so this is also
+  // the oldest one.
+  size_t nextEntry;
+
+  static uint32_t hash(const uint8_t* packet, size_t length);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include <IsrSpi.h>
+
+// The host build has a stand-in in NativeShim
+#ifdef ESP8266
+
+// Same register settings SPIClass::setDataMode() makes
+static void ICACHE_RAM_ATTR setDataMode(uint8_t dataMode) {
+  bool cpha = (dataMode & 0x01);
+  bool cpol = (dataMode & 0x10);
+
+  if (cpol) {
+    cpha = !cpha;
+  }
+
+  if (cpha) {
+    SPI1U |= SPIUSME;
+  } else {
+    SPI1U &= ~SPIUSME;
+  }
+
+  if (cpol) {
+    SPI1P |= 1 << 29;
+  } else {
+    SPI1P &= ~(1 << 29);
+  }
+}
+
+void ICACHE_RAM_ATTR IsrSpi::transfer(uint8_t csPin, uint8_t dataMode, const uint8_t* out, uint8_t* in, size_t length) {
+  if (length == 0 || length > ISR_SPI_MAX_TRANSFER) {
+    return;
+  }
+
+  while (SPI1CMD & SPIBUSY) { }
+
+  const uint32_t savedUser = SPI1U;
+  const uint32_t savedUser1 = SPI1U1;
+  const uint32_t savedPin = SPI1P;
+
+  setDataMode(dataMode);
+
+  const uint32_t bits = length * 8 - 1;
+  SPI1U1 = (SPI1U1 & ~((SPIMMOSI << SPILMOSI) | (SPIMMISO << SPILMISO)))
+    | (bits << SPILMOSI)
+    | (bits << SPILMISO);
+
+  // The FIFO is little-endian words.  Bytes are copied one at a time since
+  // the buffers needn't be word-aligned.
+  volatile uint32_t* fifo = &SPI1W0;
+  for (size_t i = 0; i < length; i += 4) {
+    uint32_t word = 0;
+    for (size_t j = 0; j < 4 && i + j < length; j++) {
+      word |= static_cast<uint32_t>(out[i + j]) << (8 * j);
+    }
+    fifo[i / 4] = word;
+  }
+
+  digitalWrite(csPin, LOW);
+  SPI1CMD |= SPIBUSY;
+  while (SPI1CMD & SPIBUSY) { }
+  digitalWrite(csPin, HIGH);
+
+  for (size_t i = 0; i < length; i += 4) {
+    uint32_t word = fifo[i / 4];
+    for (size_t j = 0; j < 4 && i + j < length; j++) {
+      in[i + j] = word >> (8 * j);
+    }
+  }
+
+  SPI1U = savedUser;
+  SPI1U1 = savedUser1;
+  SPI1P = savedPin;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <SPI.h>
+
+#ifndef _ISR_SPI_H
+#define _ISR_SPI_H
+
+// Most bytes one transfer() can exchange (the size of the ESP8266's SPI FIFO)
+#define ISR_SPI_MAX_TRANSFER 64
+
+/*
+ * SPI transfers that are safe to make from an interrupt handler.  The Arduino
+ * SPI class runs from flash, which can't be read while the cache is off
+ * (e.g. during a flash write), so this stays in IRAM and drives the SPI
+ * registers itself.
+ *
+ * Doesn't share the bus with anything: only use it while the main loop
+ * leaves the radio alone (see RadioSwitchboard::listen()).
+ */
+namespace IsrSpi {
+  // Selects the device on csPin and exchanges length bytes with it in the
+  // given SPI mode.  in may be the same buffer as out.  The bus is left in
+  // the mode it was in.
+  void transfer(uint8_t csPin, uint8_t dataMode, const uint8_t* out, uint8_t* in, size_t length);
+}
+
+#endif
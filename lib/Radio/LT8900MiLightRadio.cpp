@@ -11,15 +11,52 @@
 
 #include "LT8900MiLightRadio.h"
 #include <SPI.h>
+#include <IsrSpi.h>
+
+/**************************************************************************/
+// Register shadow
+/**************************************************************************/
+LT8900Registers::LT8900Registers()
+{
+  invalidate();
+}
+
+void LT8900Registers::invalidate()
+{
+  memset(_known, 0, sizeof(_known));
+}
+
+bool LT8900Registers::holds(uint8_t reg, uint16_t value) const
+{
+  return reg < LT8900_NUM_REGISTERS && _known[reg] && _values[reg] == value;
+}
+
+void LT8900Registers::record(uint8_t reg, uint16_t value)
+{
+  if (reg >= LT8900_NUM_REGISTERS || reg == R_CHANNEL || reg == R_FIFO || reg == R_FIFO_CONTROL) {
+    return;
+  }
+
+  _values[reg] = value;
+  _known[reg] = true;
+}
 
 /**************************************************************************/
 // Constructor
 /**************************************************************************/
-LT8900MiLightRadio::LT8900MiLightRadio(byte byCSPin, byte byResetPin, byte byPktFlag, const MiLightRadioConfig& config)
+LT8900MiLightRadio::LT8900MiLightRadio(byte byCSPin, byte byResetPin, byte byPktFlag, const MiLightRadioConfig& config, LT8900Registers& registers)
   : _config(config),
+    _registers(registers),
     _channel(0),
+    _crcErrors(0),
     _currentPacketLen(0),
-    _currentPacketPos(0)
+    _currentPacketPos(0),
+    _state(IDLE),
+    _stateSince(0),
+    _stateWaitMicros(0),
+    _rxStartMicros(0),
+    _repeatsPending(0),
+    _txChannelIx(0)
 {
   _csPin = byCSPin;
 	_pin_pktflag = byPktFlag;
@@ -33,6 +70,7 @@ LT8900MiLightRadio::LT8900MiLightRadio(byte byCSPin, byte byResetPin, byte byPkt
 		delay(200);
 		digitalWrite(byResetPin, HIGH);
 		delay(200);
+		_registers.invalidate();
 	}
 
   pinMode(_csPin, OUTPUT);
@@ -147,54 +185,58 @@ void LT8900MiLightRadio::vSetSyncWord(uint16_t syncWord3, uint16_t syncWord2, ui
 }
 
 /**************************************************************************/
-// Low level register write with delay
+// Low level register write with delay.  Neither happens if the register
+// already holds the value.
 /**************************************************************************/
 void LT8900MiLightRadio::regWrite16(byte ADDR, byte V1, byte V2, byte WAIT)
 {
-	digitalWrite(_csPin, LOW);
-	SPI.transfer(ADDR);
-	SPI.transfer(V1);
-	SPI.transfer(V2);
-	digitalWrite(_csPin, HIGH);
+	uint16_t value = (V1 << 8) | V2;
+
+	if (_registers.holds(ADDR, value)) {
+		return;
+	}
+
+	uiWriteRegister(ADDR, value);
 	delayMicroseconds(WAIT);
 }
 
 
 /**************************************************************************/
-// Low level register read
+// Low level register read.  Goes through IsrSpi since readPending() reads
+// registers from the interrupt handler.
 /**************************************************************************/
-uint16_t LT8900MiLightRadio::uiReadRegister(uint8_t reg)
+uint16_t ICACHE_RAM_ATTR LT8900MiLightRadio::uiReadRegister(uint8_t reg)
 {
-	SPI.setDataMode(SPI_MODE1);
-	digitalWrite(_csPin, LOW);
-	SPI.transfer(REGISTER_READ | (REGISTER_MASK & reg));
-	uint8_t high = SPI.transfer(0x00);
-	uint8_t low = SPI.transfer(0x00);
+	uint8_t buffer[3] = { static_cast<uint8_t>(REGISTER_READ | (REGISTER_MASK & reg)), 0x00, 0x00 };
 
-	digitalWrite(_csPin, HIGH);
+	IsrSpi::transfer(_csPin, SPI_MODE1, buffer, buffer, sizeof(buffer));
 
-	SPI.setDataMode(SPI_MODE0);
-	return (high << 8 | low);
+	return (buffer[1] << 8 | buffer[2]);
 }
 
 
 /**************************************************************************/
 // Low level 16bit register write
 /**************************************************************************/
-uint8_t LT8900MiLightRadio::uiWriteRegister(uint8_t reg, uint16_t data)
+void LT8900MiLightRadio::uiWriteRegister(uint8_t reg, uint16_t data)
 {
-	uint8_t high = data >> 8;
-	uint8_t low = data & 0xFF;
-
-	digitalWrite(_csPin, LOW);
+	if (_registers.holds(reg, data)) {
+		return;
+	}
 
-	uint8_t result = SPI.transfer(REGISTER_WRITE | (REGISTER_MASK & reg));
-	SPI.transfer(high);
-	SPI.transfer(low);
+	uint8_t buffer[3] = {
+		static_cast<uint8_t>(REGISTER_WRITE | (REGISTER_MASK & reg)),
+		static_cast<uint8_t>(data >> 8),
+		static_cast<uint8_t>(data & 0xFF)
+	};
 
+	SPI.setDataMode(SPI_MODE1);
+	digitalWrite(_csPin, LOW);
+	SPI.writeBytes(buffer, sizeof(buffer));
 	digitalWrite(_csPin, HIGH);
+	SPI.setDataMode(SPI_MODE0);
 
-	return result;
+	_registers.record(reg, data);
 }
 
 /**************************************************************************/
@@ -209,25 +251,102 @@ void LT8900MiLightRadio::vStartListening(uint uiChannelToListenTo)
   _channel = uiChannelToListenTo;
 
   vResumeRX();
-	delay(5);
+  _rxStartMicros = LT8900_RX_START_uS;
 }
 
 /**************************************************************************/
-// Resume listening - without changing the channel and syncword
+// Resume listening - without changing the channel and syncword.  RX is
+// enabled by advance() once the radio has settled.
 /**************************************************************************/
 void LT8900MiLightRadio::vResumeRX(void)
 {
   _dupes_received = 0;
 	uiWriteRegister(R_CHANNEL, _channel & CHANNEL_MASK);   //turn off rx/tx
-	delay(3);
-	uiWriteRegister(R_FIFO_CONTROL, 0x0080);  //flush rx
-	uiWriteRegister(R_CHANNEL, (_channel & CHANNEL_MASK) | _BV(CHANNEL_RX_BIT));   //enable RX
+  _rxStartMicros = 0;
+  enterState(RX_RESUMING, LT8900_RX_RESUME_uS);
+}
+
+/**************************************************************************/
+// Wait for the given number of microseconds in a new state
+/**************************************************************************/
+void LT8900MiLightRadio::enterState(State state, unsigned long waitMicros)
+{
+  _state = state;
+  _stateSince = micros();
+  _stateWaitMicros = waitMicros;
+}
+
+bool LT8900MiLightRadio::waitElapsed() const
+{
+  return micros() - _stateSince >= _stateWaitMicros;
+}
+
+/**************************************************************************/
+// Moves through as many states as have finished waiting.  Never blocks.
+/**************************************************************************/
+void LT8900MiLightRadio::advance()
+{
+  while (true) {
+    switch (_state) {
+      case RX_RESUMING:
+        if (!waitElapsed()) {
+          return;
+        }
+        uiWriteRegister(R_FIFO_CONTROL, 0x0080);  //flush rx
+        uiWriteRegister(R_CHANNEL, (_channel & CHANNEL_MASK) | _BV(CHANNEL_RX_BIT));   //enable RX
+        enterState(RX_STARTING, _rxStartMicros);
+        break;
+
+      case RX_STARTING:
+        if (!waitElapsed()) {
+          return;
+        }
+        enterState(LISTENING, 0);
+        return;
+
+      case TX_LOADED:
+        if (!waitElapsed()) {
+          return;
+        }
+        uiWriteRegister(R_CHANNEL, (_config.channels[_txChannelIx] & CHANNEL_MASK) | _BV(CHANNEL_TX_BIT));   //enable TX
+        enterState(TX_SENDING, LT8900_TX_TIMEOUT_uS);
+        break;
+
+      case TX_SENDING:
+        if (digitalRead(_pin_pktflag) == 0 && !waitElapsed()) {
+          return;
+        }
+        enterState(TX_GAP, DEFAULT_TIME_BETWEEN_RETRANSMISSIONS_uS);
+        break;
+
+      case TX_GAP:
+        if (!waitElapsed()) {
+          return;
+        }
+
+        if (++_txChannelIx == MiLightRadioConfig::NUM_CHANNELS) {
+          _txChannelIx = 0;
+          --_repeatsPending;
+        }
+
+        if (_repeatsPending == 0) {
+          enterState(IDLE, 0);
+          return;
+        }
+
+        loadTransmission();
+        break;
+
+      default:
+        return;
+    }
+  }
 }
 
 /**************************************************************************/
 // Check if data is available using the hardware pin PKT_FLAG
 /**************************************************************************/
-bool LT8900MiLightRadio::bAvailablePin() {
+bool ICACHE_RAM_ATTR LT8900MiLightRadio::bAvailablePin() {
   return digitalRead(_pin_pktflag) > 0;
 }
 
@@ -239,6 +358,7 @@ bool LT8900MiLightRadio::bAvailableRegister() {
 	uint16_t value = uiReadRegister(R_STATUS);
 
   if (bitRead(value, STATUS_CRC_BIT) != 0) {
+    ++_crcErrors;
 #ifdef DEBUG_PRINTF
     Serial.println(F("LT8900: CRC failed"));
 #endif
@@ -250,17 +370,13 @@ bool LT8900MiLightRadio::bAvailableRegister() {
 }
 
 /**************************************************************************/
-// Read the RX buffer
+// Read the RX buffer.  Callers check that a packet is available first.
 /**************************************************************************/
-int LT8900MiLightRadio::iReadRXBuffer(uint8_t *buffer, size_t maxBuffer) {
+int ICACHE_RAM_ATTR LT8900MiLightRadio::iReadRXBuffer(uint8_t *buffer, size_t maxBuffer) {
   size_t bufferIx = 0;
   uint16_t data;
 
   if (_currentPacketLen == 0) {
-    if (! available()) {
-      return -1;
-    }
-
     data = uiReadRegister(R_FIFO);
 
     _currentPacketLen = (data >> 8);
@@ -320,6 +436,7 @@ int LT8900MiLightRadio::begin()
 /**************************************************************************/
 int LT8900MiLightRadio::configure()
 {
+  finishTransmitting();
   vInitRadioModule();
   vSetSyncWord(_config.syncword3, 0,0,_config.syncword0);
   vStartListening(_config.channels[0]);
@@ -335,6 +452,15 @@ bool LT8900MiLightRadio::available()
     return true;
   }
 
+  if (_state == IDLE) {
+    vResumeRX();
+  }
+  advance();
+
+  if (_state != LISTENING) {
+    return false;
+  }
+
   return bAvailablePin() && bAvailableRegister();
 }
 
@@ -366,7 +492,64 @@ int LT8900MiLightRadio::read(uint8_t frame[], size_t &frame_length)
 }
 
 /**************************************************************************/
-// Write data
+// Resume listening if a send or an interrupt-driven read stopped it
+/**************************************************************************/
+int LT8900MiLightRadio::listen()
+{
+  if (_state == IDLE) {
+    vResumeRX();
+  }
+  advance();
+
+  return 0;
+}
+
+/**************************************************************************/
+// Read a packet that PKT_FLAG has signalled, without waiting.  RX stays off
+// until the next listen(), because vResumeRX() has to let the radio settle.
+// Runs from the interrupt handler, along with everything it calls.
+/**************************************************************************/
+int ICACHE_RAM_ATTR LT8900MiLightRadio::readPending(uint8_t frame[], size_t &frame_length)
+{
+  if (_state != LISTENING || !bAvailablePin()) {
+    frame_length = 0;
+    return -1;
+  }
+
+  _state = IDLE;
+
+  uint16_t status = uiReadRegister(R_STATUS);
+  if (bitRead(status, STATUS_CRC_BIT) != 0) {
+    ++_crcErrors;
+    frame_length = 0;
+    return -1;
+  }
+
+  if ((status & STATUS_PKT_BIT_MASK) == 0) {
+    frame_length = 0;
+    return -1;
+  }
+
+  uint8_t buf[MILIGHT_MAX_PACKET_LENGTH];
+  int packetSize = iReadRXBuffer(buf, MILIGHT_MAX_PACKET_LENGTH);
+
+  if (packetSize <= 0) {
+    frame_length = 0;
+    return -1;
+  }
+
+  if (frame_length > static_cast<size_t>(packetSize)) {
+    frame_length = packetSize;
+  }
+  for (size_t i = 0; i < frame_length; i++) {
+    frame[i] = buf[i];
+  }
+
+  return packetSize;
+}
+
+/**************************************************************************/
+// Write data.  Only starts sending it; loop() does the rest.
 /**************************************************************************/
 int LT8900MiLightRadio::write(uint8_t frame[], size_t frame_length)
 {
@@ -374,16 +557,17 @@ int LT8900MiLightRadio::write(uint8_t frame[], size_t frame_length)
     return -1;
   }
 
+  // Repeats of the packet being sent are queued behind it.  Anything else has
+  // to wait for it to finish.
+  if (isTransmitting()
+    && (frame_length != _out_packet[0] || memcmp(_out_packet + 1, frame, frame_length) != 0)) {
+    finishTransmitting();
+  }
+
   memcpy(_out_packet + 1, frame, frame_length);
   _out_packet[0] = frame_length;
 
-  SPI.setDataMode(SPI_MODE1);
-
   int retval = resend();
-  yield();
-
-  SPI.setDataMode(SPI_MODE0);
-
   if (retval < 0) {
     return retval;
   }
@@ -391,59 +575,78 @@ int LT8900MiLightRadio::write(uint8_t frame[], size_t frame_length)
 }
 
 /**************************************************************************/
-// Handle the transmission to regarding to freq diversity and repeats
+// Queue another transmission on each channel, for freq diversity
 /**************************************************************************/
 int LT8900MiLightRadio::resend()
 {
-  byte Length =  _out_packet[0];
+  // Must be connected to module otherwise it might lookup waiting for _pin_pktflag
+  if (!_bConnected || _out_packet[0] < 1) {
+    return 0;
+  }
 
-  for (size_t i = 0; i < MiLightRadioConfig::NUM_CHANNELS; i++)
-  {
-    sendPacket(_out_packet, Length, _config.channels[i]);
-    delayMicroseconds(DEFAULT_TIME_BETWEEN_RETRANSMISSIONS_uS);
+  ++_repeatsPending;
+
+  if (!isTransmitting()) {
+    _txChannelIx = 0;
+    loadTransmission();
+    advance();
   }
 
   return 0;
 }
 
-/**************************************************************************/
-// The actual transmit happens here
-/**************************************************************************/
-bool LT8900MiLightRadio::sendPacket(uint8_t *data, size_t packetSize, byte byChannel)
+void LT8900MiLightRadio::loop()
 {
-  if(_bConnected) // Must be connected to module otherwise it might lookup waiting for _pin_pktflag
-  {
-    if (packetSize < 1 || packetSize > 255)
-    {
-      return false;
-    }
+  advance();
+}
 
-    uiWriteRegister(R_CHANNEL, 0x0000);
-    uiWriteRegister(R_FIFO_CONTROL, 0x8080);  //flush tx and RX
+bool LT8900MiLightRadio::isTransmitting()
+{
+  return _state == TX_LOADED || _state == TX_SENDING || _state == TX_GAP;
+}
 
-    digitalWrite(_csPin, LOW);        // Enable PL1167 SPI transmission
-    SPI.transfer(R_FIFO);             // Start writing PL1167's FIFO Data register
-    SPI.transfer(packetSize);         // Length of data buffer: x bytes
+bool LT8900MiLightRadio::isListening()
+{
+  return _state == LISTENING;
+}
 
-    for (byte iCounter = 0; iCounter < packetSize; iCounter++)
-    {
-      SPI.transfer((data[1+iCounter]));
-    }
-    digitalWrite(_csPin, HIGH);  // Disable PL1167 SPI transmission
-    delayMicroseconds(10);
+/**************************************************************************/
+// Puts the packet in the TX FIFO, for TX to be enabled on the current
+// channel once the radio has taken it
+/**************************************************************************/
+void LT8900MiLightRadio::loadTransmission()
+{
+  // FIFO register, then the length and data in _out_packet, in one go
+  uint8_t buffer[sizeof(_out_packet) + 1];
+  buffer[0] = R_FIFO;
+  memcpy(buffer + 1, _out_packet, _out_packet[0] + 1);
 
-    uiWriteRegister(R_CHANNEL,  (byChannel & CHANNEL_MASK) | _BV(CHANNEL_TX_BIT));   //enable RX
+  uiWriteRegister(R_CHANNEL, 0x0000);
+  uiWriteRegister(R_FIFO_CONTROL, 0x8080);  //flush tx and RX
 
-    //Wait until the packet is sent.
-    while (digitalRead(_pin_pktflag) == 0)
-    {
-        //do nothing.
-    }
+  SPI.setDataMode(SPI_MODE1);
+  digitalWrite(_csPin, LOW);        // Enable PL1167 SPI transmission
+  SPI.writeBytes(buffer, _out_packet[0] + 2);
+  digitalWrite(_csPin, HIGH);  // Disable PL1167 SPI transmission
+  SPI.setDataMode(SPI_MODE0);
 
-    return true;
+  enterState(TX_LOADED, LT8900_TX_LOAD_uS);
+}
+
+/**************************************************************************/
+// Blocks until queued transmissions are sent.  Only for when the radio is
+// needed for something else in the meantime.
+/**************************************************************************/
+void LT8900MiLightRadio::finishTransmitting()
+{
+  while (isTransmitting()) {
+    advance();
+    yield();
   }
+}
 
-  return false;
+size_t LT8900MiLightRadio::getCrcErrorCount() const {
+  return _crcErrors;
 }
 
 const MiLightRadioConfig& LT8900MiLightRadio::config() {
@@ -37,28 +37,92 @@
 #define DEFAULT_TIME_BETWEEN_RETRANSMISSIONS_uS	350
 // #define DEFAULT_TIME_BETWEEN_RETRANSMISSIONS_uS	0
 
+// Time the radio needs after RX/TX is turned off before RX can be enabled again
+#define LT8900_RX_RESUME_uS         3000
+// Extra time before checking for packets after changing channel and syncword
+#define LT8900_RX_START_uS          5000
+// Time between loading the TX FIFO and enabling TX
+#define LT8900_TX_LOAD_uS           10
+// Move on if PKT_FLAG hasn't signalled a packet was sent after this long
+#define LT8900_TX_TIMEOUT_uS        5000
+
+#define LT8900_NUM_REGISTERS        64
+
 #ifndef MILIGHTRADIOPL1167_LT8900_H_
 #define MILIGHTRADIOPL1167_LT8900_H_
 
+/*
+ * Last value written to each register of an LT8900 module, so that writes
+ * which wouldn't change anything can be skipped.  Every radio config is a
+ * separate LT8900MiLightRadio on the same module, so they share one of these.
+ *
+ * R_CHANNEL, R_FIFO and R_FIFO_CONTROL are never skipped: writing to them
+ * does something even when the value is the same.
+ */
+class LT8900Registers {
+  public:
+    LT8900Registers();
+
+    // Forget every value, e.g. because the module was reset
+    void invalidate();
+
+    // True if the register is known to hold the value already
+    bool holds(uint8_t reg, uint16_t value) const;
+    void record(uint8_t reg, uint16_t value);
+
+  private:
+    uint16_t _values[LT8900_NUM_REGISTERS];
+    bool _known[LT8900_NUM_REGISTERS];
+};
+
 class LT8900MiLightRadio : public MiLightRadio {
   public:
-    LT8900MiLightRadio(byte byCSPin, byte byResetPin, byte byPktFlag, const MiLightRadioConfig& config);
+    LT8900MiLightRadio(byte byCSPin, byte byResetPin, byte byPktFlag, const MiLightRadioConfig& config, LT8900Registers& registers);
 
     virtual int begin();
     virtual bool available();
     virtual int read(uint8_t frame[], size_t &frame_length);
+    virtual int listen();
+    virtual int readPending(uint8_t frame[], size_t &frame_length);
+    virtual size_t getCrcErrorCount() const;
     virtual int write(uint8_t frame[], size_t frame_length);
     virtual int resend();
+    virtual void loop();
+    virtual bool isTransmitting();
+    virtual bool isListening();
     virtual int configure();
     virtual const MiLightRadioConfig& config();
 
   private:
+    // Sending and receiving both involve waiting on the radio.  Rather than
+    // block, the driver records what it's waiting for and carries on from
+    // loop() (or the next call) once micros() says the wait is over.
+    enum State {
+      IDLE,
+      // RX/TX turned off, waiting to enable RX
+      RX_RESUMING,
+      // RX enabled, waiting for it to settle
+      RX_STARTING,
+      LISTENING,
+      // Packet is in the TX FIFO, waiting to enable TX
+      TX_LOADED,
+      // Waiting for PKT_FLAG to signal the packet was sent
+      TX_SENDING,
+      // Waiting between transmissions
+      TX_GAP
+    };
+
+    void enterState(State state, unsigned long waitMicros);
+    bool waitElapsed() const;
+    void advance();
+    void loadTransmission();
+    void finishTransmitting();
 
     void vInitRadioModule();
     void vSetSyncWord(uint16_t syncWord3, uint16_t syncWord2, uint16_t syncWord1, uint16_t syncWord0);
     uint16_t uiReadRegister(uint8_t reg);
     void regWrite16(byte ADDR, byte V1, byte V2, byte WAIT);
-    uint8_t uiWriteRegister(uint8_t reg, uint16_t data);
+    void uiWriteRegister(uint8_t reg, uint16_t data);
 
     bool bAvailablePin(void);
     bool bAvailableRegister(void);
@@ -68,21 +132,31 @@ class LT8900MiLightRadio : public MiLightRadio {
     void vSetChannel(uint8_t channel);
     void vGenericSendPacket(int iMode, int iLength, byte *pbyFrame, byte byChannel );
     bool bCheckRadioConnection(void);
-    bool sendPacket(uint8_t *data, size_t packetSize,byte byChannel);
 
     byte _pin_pktflag;
     byte _csPin;
     bool _bConnected;
 
     const MiLightRadioConfig& _config;
+    LT8900Registers& _registers;
 
     uint8_t _channel;
     uint8_t _packet[10];
     uint8_t _out_packet[10];
     bool _waiting;
     int _dupes_received;
+    size_t _crcErrors;
     size_t _currentPacketLen;
     size_t _currentPacketPos;
+
+    State _state;
+    unsigned long _stateSince;
+    unsigned long _stateWaitMicros;
+    // Settle time for RX after the current resume
+    unsigned long _rxStartMicros;
+    // Repeats of _out_packet still to send, including the one in progress
+    size_t _repeatsPending;
+    size_t _txChannelIx;
 };
 
 
@@ -14,13 +14,41 @@
 class MiLightRadio {
   public:
 
-    virtual int begin();
-    virtual bool available();
-    virtual int read(uint8_t frame[], size_t &frame_length);
-    virtual int write(uint8_t frame[], size_t frame_length);
-    virtual int resend();
-    virtual int configure();
-    virtual const MiLightRadioConfig& config();
+    virtual ~MiLightRadio() { }
+
+    virtual int begin() = 0;
+    virtual bool available() = 0;
+    virtual int read(uint8_t frame[], size_t &frame_length) = 0;
+
+    // Puts the radio in receive mode without checking for a packet, so that
+    // the next one raises the radio's interrupt line.
+    virtual int listen() = 0;
+
+    // Reads a packet the radio has already flagged as received.  Unlike
+    // available()/read(), this never waits or reconfigures the radio, so it
+    // can be called from an interrupt handler.  It and everything it calls
+    // must be in IRAM (ICACHE_RAM_ATTR, see IsrSpi).  Returns the packet
+    // length, or -1 if there wasn't a (new) packet.
+    virtual int readPending(uint8_t frame[], size_t &frame_length) = 0;
+
+    // Number of received packets dropped because their CRC didn't match
+    virtual size_t getCrcErrorCount() const = 0;
+
+    virtual int write(uint8_t frame[], size_t frame_length) = 0;
+    virtual int resend() = 0;
+
+    // Radios that can't send a write() without waiting on the hardware carry
+    // on with it from loop(), and are transmitting until every repeat has gone
+    // out.  Others send synchronously and never are.
+    virtual void loop() { }
+    virtual bool isTransmitting() { return false; }
+
+    // Radios that have to settle after being configured (or after sending)
+    // can't receive anything until they have.  Others always can.
+    virtual bool isListening() { return true; }
+
+    virtual int configure() = 0;
+    virtual const MiLightRadioConfig& config() = 0;
 
 };
 
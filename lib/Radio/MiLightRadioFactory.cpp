@@ -8,7 +8,9 @@ std::shared_ptr<MiLightRadioFactory> MiLightRadioFactory::fromSettings(const Set
         settings.cePin,
         settings.rf24PowerLevel,
         settings.rf24Channels,
-        settings.rf24ListenChannel
+        settings.rf24ListenChannel,
+        settings.listenCsnPin,
+        settings.listenCePin
       );
 
     case LT8900:
@@ -24,17 +26,33 @@ NRF24Factory::NRF24Factory(
   uint8_t cePin,
   RF24PowerLevel rF24PowerLevel,
   const std::vector<RF24Channel>& channels,
-  RF24Channel listenChannel
+  RF24Channel listenChannel,
+  int8_t listenCsnPin,
+  int8_t listenCePin
 )
 : rf24(RF24(cePin, csnPin)),
+  csnPin(csnPin),
+  listenCsnPin(listenCsnPin),
   channels(channels),
   listenChannel(listenChannel)
 {
   rf24.setPALevel(RF24PowerLevelHelpers::rf24ValueFromValue(rF24PowerLevel));
+
+  if (listenCsnPin >= 0 && listenCePin >= 0) {
+    listenRf24 = std::make_shared<RF24>(listenCePin, listenCsnPin);
+  }
 }
 
 std::shared_ptr<MiLightRadio> NRF24Factory::create(const MiLightRadioConfig &config) {
-  return std::make_shared<NRF24MiLightRadio>(rf24, config, channels, listenChannel);
+  return std::make_shared<NRF24MiLightRadio>(rf24, csnPin, config, channels, listenChannel);
+}
+
+std::shared_ptr<MiLightRadio> NRF24Factory::createListener(const MiLightRadioConfig &config) {
+  if (listenRf24 == nullptr) {
+    return NULL;
+  }
+
+  return std::make_shared<NRF24MiLightRadio>(*listenRf24, listenCsnPin, config, channels, listenChannel);
 }
 
 LT8900Factory::LT8900Factory(uint8_t csPin, uint8_t resetPin, uint8_t pktFlag)
@@ -44,5 +62,5 @@ LT8900Factory::LT8900Factory(uint8_t csPin, uint8_t resetPin, uint8_t pktFlag)
 { }
 
 std::shared_ptr<MiLightRadio> LT8900Factory::create(const MiLightRadioConfig& config) {
-  return std::make_shared<LT8900MiLightRadio>(_csPin, _resetPin, _pktFlag, config);
+  return std::make_shared<LT8900MiLightRadio>(_csPin, _resetPin, _pktFlag, config, _registers);
 }
@@ -19,6 +19,14 @@ public:
   virtual ~MiLightRadioFactory() { };
   virtual std::shared_ptr<MiLightRadio> create(const MiLightRadioConfig& config) = 0;
 
+  // Creates a radio on a second, receive-only module, or returns NULL if
+  // there isn't one.  Radios from create() are then only used to send.
+  virtual std::shared_ptr<MiLightRadio> createListener(const MiLightRadioConfig& config) { return NULL; }
+
+  // Edge on the radio's interrupt line that signals a received packet.  The
+  // nRF24's IRQ pin is active low.
+  virtual int receiveInterruptMode() const { return FALLING; }
+
   static std::shared_ptr<MiLightRadioFactory> fromSettings(const Settings& settings);
 
 };
@@ -31,14 +39,21 @@ public:
     uint8_t csnPin,
     RF24PowerLevel rF24PowerLevel,
     const std::vector<RF24Channel>& channels,
-    RF24Channel listenChannel
+    RF24Channel listenChannel,
+    int8_t listenCsnPin = -1,
+    int8_t listenCePin = -1
   );
 
   virtual std::shared_ptr<MiLightRadio> create(const MiLightRadioConfig& config);
+  virtual std::shared_ptr<MiLightRadio> createListener(const MiLightRadioConfig& config);
 
 protected:
 
   RF24 rf24;
+  const uint8_t csnPin;
+  // Second module that only listens, if one is wired up
+  std::shared_ptr<RF24> listenRf24;
+  const int8_t listenCsnPin;
   const std::vector<RF24Channel>& channels;
   const RF24Channel listenChannel;
 
@@ -51,11 +66,16 @@ public:
 
   virtual std::shared_ptr<MiLightRadio> create(const MiLightRadioConfig& config);
 
+  // PKT_FLAG goes high when a packet has been received
+  virtual int receiveInterruptMode() const { return RISING; }
+
 protected:
 
   uint8_t _csPin;
   uint8_t _resetPin;
   uint8_t _pktFlag;
+  // Shared by the radios for every config, which all use the same module
+  LT8900Registers _registers;
 
 };
 
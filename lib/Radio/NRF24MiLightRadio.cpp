@@ -3,17 +3,16 @@
 #include <PL1167_nRF24.h>
 #include <NRF24MiLightRadio.h>
 
-#define PACKET_ID(packet, packet_length) ( (packet[1] << 8) | packet[packet_length - 1] )
-
 NRF24MiLightRadio::NRF24MiLightRadio(
   RF24& rf24,
+  uint8_t csnPin,
   const MiLightRadioConfig& config,
   const std::vector<RF24Channel>& channels,
   RF24Channel listenChannel
 )
   : channels(channels),
     listenChannelIx(static_cast<size_t>(listenChannel)),
-    _pl1167(PL1167_nRF24(rf24)),
+    _pl1167(PL1167_nRF24(rf24, csnPin)),
     _config(config),
     _waiting(false)
 { }
@@ -61,32 +60,47 @@ bool NRF24MiLightRadio::available() {
 #ifdef DEBUG_PRINTF
   printf("NRF24MiLightRadio - received packet!\n");
 #endif
-    size_t packet_length = sizeof(_packet);
-    if (_pl1167.readFIFO(_packet, packet_length) < 0) {
-      return false;
-    }
+    takePacket();
+  }
+
+  return _waiting;
+}
+
+int NRF24MiLightRadio::listen() {
+  return _pl1167.listen(_config.channels[listenChannelIx]);
+}
+
+// Runs from the interrupt handler, along with everything it calls
+int ICACHE_RAM_ATTR NRF24MiLightRadio::readPending(uint8_t frame[], size_t &frame_length) {
+  if (!_waiting && _pl1167.receivePending() > 0) {
+    takePacket();
+  }
+
+  return read(frame, frame_length);
+}
+
+size_t NRF24MiLightRadio::getCrcErrorCount() const {
+  return _pl1167.getCrcErrorCount();
+}
+
+// Moves a received packet out of the PL1167 FIFO.  Repeats are filtered out
+// further up (see DuplicatePacketFilter).
+void ICACHE_RAM_ATTR NRF24MiLightRadio::takePacket() {
+  size_t packet_length = sizeof(_packet);
+  if (_pl1167.readFIFO(_packet, packet_length) < 0) {
+    return;
+  }
 #ifdef DEBUG_PRINTF
   printf("NRF24MiLightRadio - Checking packet length (expecting %d, is %d)\n", _packet[0] + 1U, packet_length);
 #endif
-    if (packet_length == 0 || packet_length != _packet[0] + 1U) {
-      return false;
-    }
-    uint32_t packet_id = PACKET_ID(_packet, packet_length);
-#ifdef DEBUG_PRINTF
-  printf("Packet id: %d\n", packet_id);
-#endif
-    if (packet_id == _prev_packet_id) {
-      _dupes_received++;
-    } else {
-      _prev_packet_id = packet_id;
-      _waiting = true;
-    }
+  if (packet_length == 0 || packet_length != _packet[0] + 1U) {
+    return;
   }
 
-  return _waiting;
+  _waiting = true;
 }
 
-int NRF24MiLightRadio::read(uint8_t frame[], size_t &frame_length)
+int ICACHE_RAM_ATTR NRF24MiLightRadio::read(uint8_t frame[], size_t &frame_length)
 {
   if (!_waiting) {
     frame_length = 0;
@@ -101,7 +115,9 @@ int NRF24MiLightRadio::read(uint8_t frame[], size_t &frame_length)
     frame_length = _packet[0];
   }
 
-  memcpy(frame, _packet + 1, frame_length);
+  for (size_t i = 0; i < frame_length; i++) {
+    frame[i] = _packet[i + 1];
+  }
   _waiting = false;
 
   return _packet[0];
@@ -114,6 +130,7 @@ int NRF24MiLightRadio::write(uint8_t frame[], size_t frame_length) {
 
   memcpy(_out_packet + 1, frame, frame_length);
   _out_packet[0] = frame_length;
+  _pl1167.writeFIFO(_out_packet, _out_packet[0] + 1);
 
   int retval = resend();
   if (retval < 0) {
@@ -122,12 +139,12 @@ int NRF24MiLightRadio::write(uint8_t frame[], size_t frame_length) {
   return frame_length;
 }
 
+// Sends the packet framed by the last write() again, on every channel
 int NRF24MiLightRadio::resend() {
   for (std::vector<RF24Channel>::const_iterator it = channels.begin(); it != channels.end(); ++it) {
     size_t channelIx = static_cast<uint8_t>(*it);
     uint8_t channel = _config.channels[channelIx];
 
-    _pl1167.writeFIFO(_out_packet, _out_packet[0] + 1);
     _pl1167.transmit(channel);
   }
 
@@ -20,6 +20,7 @@ class NRF24MiLightRadio : public MiLightRadio {
   public:
     NRF24MiLightRadio(
       RF24& rf, 
+      uint8_t csnPin,
       const MiLightRadioConfig& config, 
       const std::vector<RF24Channel>& channels, 
       RF24Channel listenChannel
@@ -28,7 +29,9 @@ class NRF24MiLightRadio : public MiLightRadio {
     int begin();
     bool available();
     int read(uint8_t frame[], size_t &frame_length);
-    int dupesReceived();
+    int listen();
+    int readPending(uint8_t frame[], size_t &frame_length);
+    size_t getCrcErrorCount() const;
     int write(uint8_t frame[], size_t frame_length);
     int resend();
     int configure();
@@ -40,12 +43,12 @@ class NRF24MiLightRadio : public MiLightRadio {
 
     PL1167_nRF24 _pl1167;
     const MiLightRadioConfig& _config;
-    uint32_t _prev_packet_id;
 
     uint8_t _packet[10];
     uint8_t _out_packet[10];
     bool _waiting;
-    int _dupes_received;
+
+    void takePacket();
 };
 
 
@@ -12,12 +12,23 @@
 
 #include "PL1167_nRF24.h"
 #include <RadioUtils.h>
+#include <IsrSpi.h>
 #include <MiLightRadioConfig.h>
 
-static uint16_t calc_crc(uint8_t *data, size_t data_length);
+// nRF24 commands and STATUS bits receivePending() uses to talk to the radio
+// without the RF24 driver
+static const uint8_t NRF24_R_RX_PAYLOAD = 0x61;
+static const uint8_t NRF24_FLUSH_RX = 0xE2;
+static const uint8_t NRF24_W_STATUS = 0x27;
+static const uint8_t NRF24_NOP = 0xFF;
+static const uint8_t NRF24_STATUS_CLEAR_IRQS = 0x70;
+static const uint8_t NRF24_STATUS_RX_EMPTY = 0x0E;
 
-PL1167_nRF24::PL1167_nRF24(RF24 &radio)
-  : _radio(radio)
+static uint16_t calc_crc(const uint8_t *data, size_t data_length);
+
+PL1167_nRF24::PL1167_nRF24(RF24 &radio, uint8_t csnPin)
+  : _radio(radio),
+    _csnPin(csnPin)
 { }
 
 int PL1167_nRF24::open() {
@@ -26,6 +37,9 @@ int PL1167_nRF24::open() {
   _radio.setDataRate(RF24_1MBPS);
   _radio.disableCRC();
 
+  // Only pull the IRQ line low when a packet arrives, not when one is sent
+  _radio.maskIRQ(true, true, false);
+
   _syncwordLength = MiLightRadioConfig::SYNCWORD_LENGTH;
   _radio.setAddressWidth(_syncwordLength);
 
@@ -57,6 +71,9 @@ int PL1167_nRF24::recalc_parameters() {
   _radio.setChannel(2 + _channel);
   _radio.setPayloadSize( packet_length );
 
+  // Another config may have used the radio since, so start listening afresh
+  _listening = false;
+
   return 0;
 }
 
@@ -71,7 +88,7 @@ int PL1167_nRF24::setMaxPacketLength(uint8_t maxPacketLength) {
   return recalc_parameters();
 }
 
-int PL1167_nRF24::receive(uint8_t channel) {
+int PL1167_nRF24::listen(uint8_t channel) {
   if (channel != _channel) {
     _channel = channel;
     int retval = recalc_parameters();
@@ -80,12 +97,33 @@ int PL1167_nRF24::receive(uint8_t channel) {
     }
   }
 
-  _radio.startListening();
+  if (!_listening) {
+    _radio.startListening();
+    _listening = true;
+    _lastHealthCheck = millis();
+  }
+
+  return 0;
+}
+
+int PL1167_nRF24::receive(uint8_t channel) {
+  int retval = listen(channel);
+  if (retval < 0) {
+    return retval;
+  }
+
   if (_radio.available()) {
 #ifdef DEBUG_PRINTF
   printf("Radio is available\n");
 #endif
     internal_receive();
+    _lastHealthCheck = millis();
+  } else if (millis() - _lastHealthCheck >= PL1167_NRF24_HEALTH_CHECK_INTERVAL) {
+    _lastHealthCheck = millis();
+
+    if (!check_health()) {
+      return -1;
+    }
   }
 
   if(_received) {
@@ -100,31 +138,105 @@ int PL1167_nRF24::receive(uint8_t channel) {
   }
 }
 
-int PL1167_nRF24::readFIFO(uint8_t data[], size_t &data_length)
+// Like receive(), but only picks up a packet that's already in the RX FIFO.
+// Doesn't start listening, change channels or check the radio's health.
+//
+// Called from an interrupt handler, so this talks to the radio through
+// IsrSpi with the same commands the RF24 driver would send.
+int ICACHE_RAM_ATTR PL1167_nRF24::receivePending() {
+  if (!_listening) {
+    return _received ? _packet_length : 0;
+  }
+
+  uint8_t buffer[1 + sizeof(_packet)];
+
+  buffer[0] = NRF24_NOP;
+  IsrSpi::transfer(_csnPin, SPI_MODE0, buffer, buffer, 1);
+
+  if ((buffer[0] & NRF24_STATUS_RX_EMPTY) != NRF24_STATUS_RX_EMPTY) {
+    buffer[0] = NRF24_R_RX_PAYLOAD;
+    for (size_t i = 1; i <= _receive_length; i++) {
+      buffer[i] = NRF24_NOP;
+    }
+    IsrSpi::transfer(_csnPin, SPI_MODE0, buffer, buffer, 1 + _receive_length);
+
+    // As in internal_receive(), plus clearing RX_DR like RF24::read() does
+    uint8_t command[2] = { NRF24_FLUSH_RX };
+    IsrSpi::transfer(_csnPin, SPI_MODE0, command, command, 1);
+
+    command[0] = NRF24_W_STATUS;
+    command[1] = NRF24_STATUS_CLEAR_IRQS;
+    IsrSpi::transfer(_csnPin, SPI_MODE0, command, command, 2);
+
+    decode(buffer + 1);
+  }
+
+  return _received ? _packet_length : 0;
+}
+
+// Re-opens the radio if it lost its configuration
+bool PL1167_nRF24::check_health() {
+  if (_radio.getChannel() == 2 + _channel) {
+    return true;
+  }
+
+  Serial.println(F("WARNING: nRF24 lost its configuration, resetting"));
+
+  return open() >= 0;
+}
+
+// Called from the interrupt handler too (see receivePending()), so this
+// copies byte by byte rather than with memcpy()/memmove() in flash
+int ICACHE_RAM_ATTR PL1167_nRF24::readFIFO(uint8_t data[], size_t &data_length)
 {
   if (data_length > _packet_length) {
     data_length = _packet_length;
   }
-  memcpy(data, _packet, data_length);
+  for (size_t i = 0; i < data_length; i++) {
+    data[i] = _packet[i];
+  }
   _packet_length -= data_length;
-  if (_packet_length) {
-    memmove(_packet, _packet + data_length, _packet_length);
+  for (size_t i = 0; i < _packet_length; i++) {
+    _packet[i] = _packet[i + data_length];
   }
   return _packet_length;
 }
 
+size_t PL1167_nRF24::getCrcErrorCount() const {
+  return _crcErrors;
+}
+
+// Frames the packet for transmit().  Repeats of the same packet reuse the
+// frame built for the first one.
 int PL1167_nRF24::writeFIFO(const uint8_t data[], size_t data_length)
 {
-  if (data_length > sizeof(_packet)) {
-    data_length = sizeof(_packet);
+  if (data_length > sizeof(_tx_payload)) {
+    data_length = sizeof(_tx_payload);
   }
-  memcpy(_packet, data, data_length);
-  _packet_length = data_length;
   _received = false;
 
+  if (_tx_frame_length > 0 && data_length == _tx_payload_length && memcmp(_tx_payload, data, data_length) == 0) {
+    return data_length;
+  }
+
+  memcpy(_tx_payload, data, data_length);
+  _tx_payload_length = data_length;
+
+  uint16_t crc = calc_crc(data, data_length);
+  uint8_t outp = 0;
+
+  for (size_t inp = 0; inp < data_length; inp++) {
+    _tx_frame[outp++] = reverseBits(data[inp]);
+  }
+  _tx_frame[outp++] = reverseBits(crc & 0xFF);
+  _tx_frame[outp++] = reverseBits(crc >> 8);
+
+  _tx_frame_length = outp;
+
   return data_length;
 }
 
+// Sends the frame built by the last writeFIFO() on the given channel
 int PL1167_nRF24::transmit(uint8_t channel) {
   if (channel != _channel) {
     _channel = channel;
@@ -136,25 +248,9 @@ int PL1167_nRF24::transmit(uint8_t channel) {
   }
 
   _radio.stopListening();
-  uint8_t tmp[sizeof(_packet)];
-  int outp=0;
-
-  uint16_t crc = calc_crc(_packet, _packet_length);
-
-  // +1 for packet length
-  // +2 for crc
-  // = 3
-  for (int inp = 0; inp < _packet_length + 3; inp++) {
-    if (inp < _packet_length) {
-      tmp[outp++] = reverseBits(_packet[inp]);}
-    else if (inp < _packet_length + 2) {
-      tmp[outp++] = reverseBits((crc >> ( (inp - _packet_length) * 8)) & 0xff);
-    }
-  }
+  _listening = false;
 
-  yield();
-
-  _radio.write(tmp, outp);
+  _radio.write(_tx_frame, _tx_frame_length);
   return 0;
 }
 
@@ -171,12 +267,21 @@ int PL1167_nRF24::transmit(uint8_t channel) {
  */
 int PL1167_nRF24::internal_receive() {
   uint8_t tmp[sizeof(_packet)];
-  int outp = 0;
 
   _radio.read(tmp, _receive_length);
 
-  // HACK HACK HACK: Reset radio
-  open();
+  // Anything else in the RX FIFO is almost certainly a repeat of this packet.
+  // Drop it so that the next read is fresh.  The radio stays configured and
+  // listening.
+  _radio.flush_rx();
+
+  return decode(tmp);
+}
+
+// Checks the CRC of a frame read off the radio, and keeps the packet in it if
+// it's good.  Decodes in place.
+int ICACHE_RAM_ATTR PL1167_nRF24::decode(uint8_t tmp[]) {
+  int outp = 0;
 
 // Currently, the syncword width is set to 5 in order to include the
 // PL1167 trailer.  The trailer is 4 bits, which pushes packet data
@@ -223,6 +328,7 @@ int PL1167_nRF24::internal_receive() {
   uint16_t recvCrc = (tmp[outp - 1] << 8) | tmp[outp - 2];
 
   if ( crc != recvCrc ) {
+    ++_crcErrors;
 #ifdef DEBUG_PRINTF
     Serial.printf_P(PSTR("Failed CRC: expected %04X, got %04X\n"), crc, recvCrc);
 #endif
@@ -230,7 +336,9 @@ int PL1167_nRF24::internal_receive() {
   }
   outp -= 2;
 
-  memcpy(_packet, tmp, outp);
+  for (int i = 0; i < outp; i++) {
+    _packet[i] = tmp[i];
+  }
 
   _packet_length = outp;
   _received = true;
@@ -242,20 +350,18 @@ int PL1167_nRF24::internal_receive() {
   return outp;
 }
 
-#define CRC_POLY 0x8408
+// CRC-16 (polynomial 0x8408, reflected) of each nibble, so the CRC can be
+// computed four bits at a time
+static const uint16_t CRC_NIBBLES[16] = {
+  0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+  0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F
+};
 
-static uint16_t calc_crc(uint8_t *data, size_t data_length) {
+static uint16_t ICACHE_RAM_ATTR calc_crc(const uint8_t *data, size_t data_length) {
   uint16_t state = 0;
   for (size_t i = 0; i < data_length; i++) {
-    uint8_t byte = data[i];
-    for (int j = 0; j < 8; j++) {
-      if ((byte ^ state) & 0x01) {
-        state = (state >> 1) ^ CRC_POLY;
-      } else {
-        state = state >> 1;
-      }
-      byte = byte >> 1;
-    }
+    state = (state >> 4) ^ CRC_NIBBLES[(state ^ data[i]) & 0x0F];
+    state = (state >> 4) ^ CRC_NIBBLES[(state ^ (data[i] >> 4)) & 0x0F];
   }
   return state;
-}
\ No newline at end of file
+}
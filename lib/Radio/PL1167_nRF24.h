@@ -10,15 +10,23 @@
 #endif
 
 #include "RF24.h"
+#include <MiLightRadioConfig.h>
 
 // #define DEBUG_PRINTF
 
+// While nothing is being received, check this often (in milliseconds) that
+// the nRF24 still has the configuration we gave it.  If it doesn't (e.g., it
+// browned out and reset), it's set up again from scratch.
+#ifndef PL1167_NRF24_HEALTH_CHECK_INTERVAL
+#define PL1167_NRF24_HEALTH_CHECK_INTERVAL 1000
+#endif
+
 #ifndef PL1167_NRF24_H_
 #define PL1167_NRF24_H_
 
 class PL1167_nRF24 {
   public:
-    PL1167_nRF24(RF24& radio);
+    PL1167_nRF24(RF24& radio, uint8_t csnPin);
     int open();
 
     int setSyncword(const uint8_t syncword[], size_t syncwordLength);
@@ -26,11 +34,15 @@ class PL1167_nRF24 {
 
     int writeFIFO(const uint8_t data[], size_t data_length);
     int transmit(uint8_t channel);
+    int listen(uint8_t channel);
     int receive(uint8_t channel);
+    int receivePending();
     int readFIFO(uint8_t data[], size_t &data_length);
+    size_t getCrcErrorCount() const;
 
   private:
     RF24 &_radio;
+    const uint8_t _csnPin;
 
     const uint8_t* _syncwordBytes = nullptr;
     uint8_t _syncwordLength = 4;
@@ -45,10 +57,21 @@ class PL1167_nRF24 {
     uint8_t _receive_length = 0;
     uint8_t _preamble = 0;
     uint8_t _packet[32];
+    // Last packet given to writeFIFO(), and how it's sent over the air: with
+    // the bits of each byte reversed, followed by a CRC
+    uint8_t _tx_payload[MILIGHT_MAX_PACKET_LENGTH + 1];
+    uint8_t _tx_payload_length = 0;
+    uint8_t _tx_frame[MILIGHT_MAX_PACKET_LENGTH + 3];
+    uint8_t _tx_frame_length = 0;
     bool _received = false;
+    bool _listening = false;
+    size_t _crcErrors = 0;
+    unsigned long _lastHealthCheck = 0;
 
     int recalc_parameters();
     int internal_receive();
+    int decode(uint8_t frame[]);
+    bool check_health();
 
 };
 
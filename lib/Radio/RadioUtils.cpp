@@ -4,15 +4,13 @@
 #include <stddef.h>
 #include <Arduino.h>
 
-uint8_t reverseBits(uint8_t byte) {
-  uint8_t result = byte;
-  uint8_t i = 7;
+// Each nibble with its bits reversed.  Two lookups per byte rather than one
+// in a 256 byte table, since constant tables take up RAM on the ESP8266.
+static const uint8_t REVERSED_NIBBLES[16] = {
+  0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+  0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+};
 
-  for (byte >>= 1; byte; byte >>= 1) {
-    result <<= 1;
-    result |= byte & 1;
-    --i;
-  }
-
-  return result << i;
-}
\ No newline at end of file
+uint8_t ICACHE_RAM_ATTR reverseBits(uint8_t byte) {
+  return (REVERSED_NIBBLES[byte & 0x0F] << 4) | REVERSED_NIBBLES[byte >> 4];
+}
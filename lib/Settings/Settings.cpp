@@ -73,6 +73,9 @@ void Settings::patch(JsonObject parsedSettings) {
   this->setIfPresent(parsedSettings, "csn_pin", csnPin);
   this->setIfPresent(parsedSettings, "reset_pin", resetPin);
   this->setIfPresent(parsedSettings, "led_pin", ledPin);
+  this->setIfPresent(parsedSettings, "radio_interrupt_pin", radioInterruptPin);
+  this->setIfPresent(parsedSettings, "listen_ce_pin", listenCePin);
+  this->setIfPresent(parsedSettings, "listen_csn_pin", listenCsnPin);
   this->setIfPresent(parsedSettings, "packet_repeats", packetRepeats);
   this->setIfPresent(parsedSettings, "http_repeat_factor", httpRepeatFactor);
   this->setIfPresent(parsedSettings, "auto_restart_period", _autoRestartPeriod);
@@ -86,7 +89,10 @@ void Settings::patch(JsonObject parsedSettings) {
   this->setIfPresent(parsedSettings, "simple_mqtt_client_status", simpleMqttClientStatus);
   this->setIfPresent(parsedSettings, "discovery_port", discoveryPort);
   this->setIfPresent(parsedSettings, "listen_repeats", listenRepeats);
+  this->setIfPresent(parsedSettings, "listen_dedupe_window", listenDedupeWindow);
   this->setIfPresent(parsedSettings, "state_flush_interval", stateFlushInterval);
+  this->setIfPresent(parsedSettings, "state_flush_budget_bytes", stateFlushBudgetBytes);
+  this->setIfPresent(parsedSettings, "state_flush_budget_micros", stateFlushBudgetMicros);
   this->setIfPresent(parsedSettings, "mqtt_state_rate_limit", mqttStateRateLimit);
   this->setIfPresent(parsedSettings, "mqtt_debounce_delay", mqttDebounceDelay);
   this->setIfPresent(parsedSettings, "mqtt_retain", mqttRetain);
@@ -94,6 +100,9 @@ void Settings::patch(JsonObject parsedSettings) {
   this->setIfPresent(parsedSettings, "packet_repeat_throttle_sensitivity", packetRepeatThrottleSensitivity);
   this->setIfPresent(parsedSettings, "packet_repeat_minimum", packetRepeatMinimum);
   this->setIfPresent(parsedSettings, "enable_automatic_mode_switching", enableAutomaticModeSwitching);
+  this->setIfPresent(parsedSettings, "enable_packet_coalescing", enablePacketCoalescing);
+  this->setIfPresent(parsedSettings, "interleave_packet_repeats", interleavePacketRepeats);
+  this->setIfPresent(parsedSettings, "packet_reorder_window", packetReorderWindow);
   this->setIfPresent(parsedSettings, "led_mode_packet_count", ledModePacketCount);
   this->setIfPresent(parsedSettings, "hostname", hostname);
   this->setIfPresent(parsedSettings, "wifi_static_ip", wifiStaticIP);
@@ -112,6 +121,11 @@ void Settings::patch(JsonObject parsedSettings) {
     rf24Channels = JsonHelpers::jsonArrToVector<RF24Channel, String>(arr, RF24ChannelHelpers::valueFromName);
   }
 
+  if (parsedSettings.containsKey("listen_remote_types")) {
+    JsonArray arr = parsedSettings["listen_remote_types"];
+    listenRemoteTypes = JsonHelpers::jsonArrToVector<MiLightRemoteType, String>(arr, MiLightRemoteTypeHelpers::remoteTypeFromString);
+  }
+
   if (parsedSettings.containsKey("rf24_listen_channel")) {
     this->rf24ListenChannel = RF24ChannelHelpers::valueFromName(parsedSettings["rf24_listen_channel"]);
   }
@@ -257,6 +271,9 @@ void Settings::serialize(Print& stream, const bool prettyPrint) {
   root["csn_pin"] = this->csnPin;
   root["reset_pin"] = this->resetPin;
   root["led_pin"] = this->ledPin;
+  root["radio_interrupt_pin"] = this->radioInterruptPin;
+  root["listen_ce_pin"] = this->listenCePin;
+  root["listen_csn_pin"] = this->listenCsnPin;
   root["radio_interface_type"] = typeToString(this->radioInterfaceType);
   root["packet_repeats"] = this->packetRepeats;
   root["http_repeat_factor"] = this->httpRepeatFactor;
@@ -271,7 +288,10 @@ void Settings::serialize(Print& stream, const bool prettyPrint) {
   root["simple_mqtt_client_status"] = this->simpleMqttClientStatus;
   root["discovery_port"] = this->discoveryPort;
   root["listen_repeats"] = this->listenRepeats;
+  root["listen_dedupe_window"] = this->listenDedupeWindow;
   root["state_flush_interval"] = this->stateFlushInterval;
+  root["state_flush_budget_bytes"] = this->stateFlushBudgetBytes;
+  root["state_flush_budget_micros"] = this->stateFlushBudgetMicros;
   root["mqtt_state_rate_limit"] = this->mqttStateRateLimit;
   root["mqtt_debounce_delay"] = this->mqttDebounceDelay;
   root["mqtt_retain"] = this->mqttRetain;
@@ -279,6 +299,9 @@ void Settings::serialize(Print& stream, const bool prettyPrint) {
   root["packet_repeat_throttle_threshold"] = this->packetRepeatThrottleThreshold;
   root["packet_repeat_minimum"] = this->packetRepeatMinimum;
   root["enable_automatic_mode_switching"] = this->enableAutomaticModeSwitching;
+  root["enable_packet_coalescing"] = this->enablePacketCoalescing;
+  root["interleave_packet_repeats"] = this->interleavePacketRepeats;
+  root["packet_reorder_window"] = this->packetReorderWindow;
   root["led_mode_wifi_config"] = LEDStatus::LEDModeToString(this->ledModeWifiConfig);
   root["led_mode_wifi_failed"] = LEDStatus::LEDModeToString(this->ledModeWifiFailed);
   root["led_mode_operating"] = LEDStatus::LEDModeToString(this->ledModeOperating);
@@ -298,6 +321,9 @@ void Settings::serialize(Print& stream, const bool prettyPrint) {
   JsonArray channelArr = root.createNestedArray("rf24_channels");
   JsonHelpers::vectorToJsonArr<RF24Channel, String>(channelArr, rf24Channels, RF24ChannelHelpers::nameFromValue);
 
+  JsonArray listenRemoteTypesArr = root.createNestedArray("listen_remote_types");
+  JsonHelpers::vectorToJsonArr<MiLightRemoteType, String>(listenRemoteTypesArr, listenRemoteTypes, MiLightRemoteTypeHelpers::remoteTypeToString);
+
   JsonArray deviceIdsArr = root.createNestedArray("device_ids");
   JsonHelpers::copyFrom<uint16_t>(deviceIdsArr, this->deviceIds);
 
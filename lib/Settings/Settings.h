@@ -94,13 +94,19 @@ public:
     csnPin(15),
     resetPin(0),
     ledPin(-2),
+    radioInterruptPin(-1),
+    listenCePin(-1),
+    listenCsnPin(-1),
     radioInterfaceType(nRF24),
     packetRepeats(50),
     httpRepeatFactor(1),
     listenRepeats(3),
+    listenDedupeWindow(500),
     discoveryPort(48899),
     simpleMqttClientStatus(false),
     stateFlushInterval(10000),
+    stateFlushBudgetBytes(256),
+    stateFlushBudgetMicros(0),
     mqttStateRateLimit(500),
     mqttDebounceDelay(500),
     mqttRetain(true),
@@ -108,6 +114,9 @@ public:
     packetRepeatThrottleSensitivity(0),
     packetRepeatMinimum(3),
     enableAutomaticModeSwitching(false),
+    enablePacketCoalescing(true),
+    interleavePacketRepeats(false),
+    packetReorderWindow(100),
     ledModeWifiConfig(LEDStatus::LEDMode::FastToggle),
     ledModeWifiFailed(LEDStatus::LEDMode::On),
     ledModeOperating(LEDStatus::LEDMode::SlowBlip),
@@ -155,10 +164,21 @@ public:
   uint8_t csnPin;
   uint8_t resetPin;
   int8_t ledPin;
+  // Pin wired to the radio's IRQ (nRF24) or PKT_FLAG (LT8900) line.  Negative
+  // to poll the radio from the main loop instead.
+  int8_t radioInterruptPin;
+  // CE and CSN pins of an optional second nRF24 that only listens, so that
+  // remotes can be heard while sending.  Negative if there isn't one.
+  int8_t listenCePin;
+  int8_t listenCsnPin;
   RadioInterfaceType radioInterfaceType;
   size_t packetRepeats;
   size_t httpRepeatFactor;
   uint8_t listenRepeats;
+  // Repeats of a received packet within this many milliseconds are ignored
+  size_t listenDedupeWindow;
+  // Only listen for these types of remotes.  Listens for all of them if empty.
+  std::vector<MiLightRemoteType> listenRemoteTypes;
   uint16_t discoveryPort;
   String _mqttServer;
   String mqttUsername;
@@ -169,6 +189,8 @@ public:
   String mqttClientStatusTopic;
   bool simpleMqttClientStatus;
   size_t stateFlushInterval;
+  size_t stateFlushBudgetBytes;
+  size_t stateFlushBudgetMicros;
   size_t mqttStateRateLimit;
   size_t mqttDebounceDelay;
   bool mqttRetain;
@@ -176,6 +198,9 @@ public:
   size_t packetRepeatThrottleSensitivity;
   size_t packetRepeatMinimum;
   bool enableAutomaticModeSwitching;
+  bool enablePacketCoalescing;
+  bool interleavePacketRepeats;
+  size_t packetReorderWindow;
   LEDStatus::LEDMode ledModeWifiConfig;
   LEDStatus::LEDMode ledModeWifiFailed;
   LEDStatus::LEDMode ledModeOperating;
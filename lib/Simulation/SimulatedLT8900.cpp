@@ -0,0 +1,146 @@
+#include <SimulatedLT8900.h>
+#include <LT8900MiLightRadio.h>
+#include <SPI.h>
+#include <algorithm>
+
+SimulatedLT8900::SimulatedLT8900(uint8_t csPin, uint8_t pktFlagPin, unsigned long txMicros)
+  : transactions(0)
+  , wrongModeTransfers(0)
+  , csPin(csPin)
+  , pktFlagPin(pktFlagPin)
+  , txMicros(txMicros)
+  , selected(false)
+  , transmitting(false)
+  , txStart(0)
+{
+  memset(registers, 0, sizeof(registers));
+  registers[0] = 0x6FE0;
+  registers[1] = 0x5681;
+
+  SPI.responder = [this](uint8_t data) { return transfer(data); };
+
+  NativePins::onWrite(csPin, [this](uint8_t value) {
+    if (value == LOW) {
+      selected = true;
+      command.clear();
+    } else if (selected) {
+      selected = false;
+      ++transactions;
+      endTransaction();
+    }
+  });
+
+  NativePins::onRead(pktFlagPin, [this]() {
+    NativeClock::advanceMicros(1);
+    return packetFlag() ? HIGH : LOW;
+  });
+}
+
+SimulatedLT8900::~SimulatedLT8900() {
+  SPI.responder = nullptr;
+  NativePins::clearHandlers();
+}
+
+bool SimulatedLT8900::inject(const uint8_t* frame, size_t length) {
+  if (!isListening()) {
+    return false;
+  }
+
+  rxFifo.clear();
+  rxFifo.push_back(length);
+  rxFifo.insert(rxFifo.end(), frame, frame + length);
+
+  return true;
+}
+
+bool SimulatedLT8900::isListening() const {
+  return bitRead(registers[R_CHANNEL], CHANNEL_RX_BIT) != 0;
+}
+
+uint16_t SimulatedLT8900::getRegister(uint8_t reg) const {
+  return registers[reg];
+}
+
+bool SimulatedLT8900::packetFlag() const {
+  if (transmitting) {
+    return micros() - txStart >= txMicros;
+  }
+
+  return isListening() && !rxFifo.empty();
+}
+
+uint8_t SimulatedLT8900::transfer(uint8_t data) {
+  NativeClock::advanceMicros(SIMULATED_LT8900_SPI_BYTE_MICROS);
+
+  if (!selected) {
+    return 0;
+  }
+
+  if (SPI.dataMode != SPI_MODE1) {
+    ++wrongModeTransfers;
+  }
+
+  command.push_back(data);
+
+  if (command.size() == 1) {
+    return 0;
+  }
+
+  const uint8_t reg = command[0] & REGISTER_MASK;
+
+  if ((command[0] & REGISTER_READ) == 0) {
+    if (reg == R_FIFO) {
+      txFifo.push_back(data);
+    }
+    return 0;
+  }
+
+  if (reg == R_FIFO) {
+    if (rxFifo.empty()) {
+      return 0;
+    }
+
+    uint8_t value = rxFifo.front();
+    rxFifo.pop_front();
+    return value;
+  }
+
+  if (reg == R_STATUS && command.size() == 3 && packetFlag()) {
+    return STATUS_PKT_BIT_MASK;
+  }
+
+  return command.size() == 2 ? registers[reg] >> 8 : registers[reg] & 0xFF;
+}
+
+void SimulatedLT8900::endTransaction() {
+  if (command.size() == 3 && (command[0] & REGISTER_READ) == 0 && (command[0] & REGISTER_MASK) != R_FIFO) {
+    writeRegister(command[0] & REGISTER_MASK, (command[1] << 8) | command[2]);
+  }
+}
+
+void SimulatedLT8900::writeRegister(uint8_t reg, uint16_t value) {
+  registers[reg] = value;
+
+  if (reg == R_FIFO_CONTROL) {
+    if (value & 0x8000) {
+      txFifo.clear();
+    }
+    if (value & 0x0080) {
+      rxFifo.clear();
+    }
+  } else if (reg == R_CHANNEL) {
+    transmitting = bitRead(value, CHANNEL_TX_BIT) != 0;
+
+    if (transmitting) {
+      txStart = micros();
+
+      SimulatedLT8900Frame frame;
+      frame.timestamp = txStart;
+      frame.channel = value & CHANNEL_MASK;
+      if (!txFifo.empty()) {
+        frame.data.assign(txFifo.begin() + 1, txFifo.begin() + 1 + std::min<size_t>(txFifo[0], txFifo.size() - 1));
+      }
+      txFrames.push_back(frame);
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+
+#ifndef _SIMULATED_LT8900_H
+#define _SIMULATED_LT8900_H
+
+// Time from enabling TX until PKT_FLAG signals the packet was sent: PLL
+// settling plus the frame itself at 1Mbps
+#ifndef SIMULATED_LT8900_TX_MICROS
+#define SIMULATED_LT8900_TX_MICROS 300
+#endif
+
+// One byte on the SPI bus at 4MHz
+#ifndef SIMULATED_LT8900_SPI_BYTE_MICROS
+#define SIMULATED_LT8900_SPI_BYTE_MICROS 2
+#endif
+
+struct SimulatedLT8900Frame {
+  // micros() at the moment TX was enabled
+  unsigned long timestamp;
+  uint8_t channel;
+  std::vector<uint8_t> data;
+};
+
+/*
+ * Model of an LT8900 module for LT8900MiLightRadio to talk to on the host.
+ * Attaches to the SPI stub and to the CS and PKT_FLAG pins, so only one can
+ * exist at a time.
+ *
+ * Covers the registers and FIFOs the driver uses.  Each SPI byte advances the
+ * virtual clock by SIMULATED_LT8900_SPI_BYTE_MICROS, and each read of PKT_FLAG
+ * by a microsecond, so time spent talking to the radio (or waiting on it)
+ * shows up in micros().
+ *
+ * Frames are recorded when TX is enabled, and injected frames are only heard
+ * while RX is enabled.
+ */
+class SimulatedLT8900 {
+public:
+  SimulatedLT8900(uint8_t csPin, uint8_t pktFlagPin, unsigned long txMicros = SIMULATED_LT8900_TX_MICROS);
+  ~SimulatedLT8900();
+
+  // Receive a frame, as if it came over the air.  Returns false if the radio
+  // wasn't listening.
+  bool inject(const uint8_t* frame, size_t length);
+
+  bool isListening() const;
+
+  // Value last written to a register
+  uint16_t getRegister(uint8_t reg) const;
+
+  std::vector<SimulatedLT8900Frame> txFrames;
+  // Number of times CS was taken low and back high
+  size_t transactions;
+  // Bytes exchanged while the SPI bus wasn't in the LT8900's mode (SPI_MODE1)
+  size_t wrongModeTransfers;
+
+private:
+  const uint8_t csPin;
+  const uint8_t pktFlagPin;
+  const unsigned long txMicros;
+
+  uint16_t registers[128];
+  bool selected;
+  std::vector<uint8_t> command;
+  std::vector<uint8_t> txFifo;
+  std::deque<uint8_t> rxFifo;
+  bool transmitting;
+  unsigned long txStart;
+
+  uint8_t transfer(uint8_t data);
+  void endTransaction();
+  void writeRegister(uint8_t reg, uint16_t value);
+  bool packetFlag() const;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include <SimulatedMiLightRadio.h>
+
+SimulatedMiLightRadio::SimulatedMiLightRadio(
+  const MiLightRadioConfig& config,
+  std::shared_ptr<SimulatedAirLog> airLog,
+  unsigned long txMicros
+) : _config(config)
+  , airLog(airLog)
+  , txMicros(txMicros)
+  , lastFrameLength(0)
+  , configureCount(0)
+  , writeCount(0)
+{ }
+
+int SimulatedMiLightRadio::begin() {
+  return configure();
+}
+
+int SimulatedMiLightRadio::configure() {
+  ++configureCount;
+  return 0;
+}
+
+bool SimulatedMiLightRadio::available() {
+  return !rxQueue.empty();
+}
+
+int SimulatedMiLightRadio::read(uint8_t frame[], size_t& frame_length) {
+  if (rxQueue.empty()) {
+    frame_length = 0;
+    return -1;
+  }
+
+  const std::vector<uint8_t>& packet = rxQueue.front();
+  frame_length = std::min(packet.size(), static_cast<size_t>(MILIGHT_MAX_PACKET_LENGTH));
+  memcpy(frame, packet.data(), frame_length);
+  rxQueue.pop_front();
+
+  return frame_length;
+}
+
+int SimulatedMiLightRadio::listen() {
+  return 0;
+}
+
+int SimulatedMiLightRadio::readPending(uint8_t frame[], size_t& frame_length) {
+  return read(frame, frame_length);
+}
+
+size_t SimulatedMiLightRadio::getCrcErrorCount() const {
+  return 0;
+}
+
+int SimulatedMiLightRadio::write(uint8_t frame[], size_t frame_length) {
+  if (frame_length > sizeof(lastFrame)) {
+    return -1;
+  }
+
+  memcpy(lastFrame, frame, frame_length);
+  lastFrameLength = frame_length;
+
+  int retval = resend();
+  if (retval < 0) {
+    return retval;
+  }
+  return frame_length;
+}
+
+int SimulatedMiLightRadio::resend() {
+  SimulatedFrame sent;
+  sent.timestamp = micros();
+  sent.config = &_config;
+  sent.length = lastFrameLength;
+  memcpy(sent.data, lastFrame, lastFrameLength);
+
+  airLog->push_back(sent);
+  ++writeCount;
+
+  delayMicroseconds(txMicros);
+
+  return 0;
+}
+
+const MiLightRadioConfig& SimulatedMiLightRadio::config() {
+  return _config;
+}
+
+void SimulatedMiLightRadio::inject(const uint8_t* frame, size_t length) {
+  rxQueue.push_back(std::vector<uint8_t>(frame, frame + length));
+}
+
+size_t SimulatedMiLightRadio::getConfigureCount() const {
+  return configureCount;
+}
+
+size_t SimulatedMiLightRadio::getWriteCount() const {
+  return writeCount;
+}
+
+SimulatedRadioFactory::SimulatedRadioFactory(unsigned long txMicros, bool withListener)
+  : txMicros(txMicros)
+  , withListener(withListener)
+  , airLog(std::make_shared<SimulatedAirLog>())
+{ }
+
+std::shared_ptr<MiLightRadio> SimulatedRadioFactory::create(const MiLightRadioConfig& config) {
+  std::shared_ptr<SimulatedMiLightRadio> radio = std::make_shared<SimulatedMiLightRadio>(config, airLog, txMicros);
+  radios.push_back(radio);
+  return radio;
+}
+
+std::shared_ptr<MiLightRadio> SimulatedRadioFactory::createListener(const MiLightRadioConfig& config) {
+  if (!withListener) {
+    return NULL;
+  }
+
+  std::shared_ptr<SimulatedMiLightRadio> radio = std::make_shared<SimulatedMiLightRadio>(config, airLog, txMicros);
+  listenRadios.push_back(radio);
+  return radio;
+}
+
+std::shared_ptr<SimulatedMiLightRadio> SimulatedRadioFactory::radioFor(const MiLightRadioConfig& config) const {
+  return find(radios, config);
+}
+
+std::shared_ptr<SimulatedMiLightRadio> SimulatedRadioFactory::listenRadioFor(const MiLightRadioConfig& config) const {
+  return find(listenRadios, config);
+}
+
+std::shared_ptr<SimulatedMiLightRadio> SimulatedRadioFactory::find(
+  const std::vector<std::shared_ptr<SimulatedMiLightRadio>>& radios,
+  const MiLightRadioConfig& config
+) {
+  for (size_t i = 0; i < radios.size(); i++) {
+    if (&radios[i]->config() == &config) {
+      return radios[i];
+    }
+  }
+
+  return nullptr;
+}
+
+const SimulatedAirLog& SimulatedRadioFactory::getAirLog() const {
+  return *airLog;
+}
+
+void SimulatedRadioFactory::clearAirLog() {
+  airLog->clear();
+}
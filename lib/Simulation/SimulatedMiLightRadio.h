@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include <MiLightRadio.h>
+#include <MiLightRadioConfig.h>
+#include <MiLightRadioFactory.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#ifndef _SIMULATED_MILIGHT_RADIO_H
+#define _SIMULATED_MILIGHT_RADIO_H
+
+// Approximate time on air for one write() on the nRF24: three channels, each
+// with a TX settle period plus the packet itself at 1Mbps.
+#ifndef SIMULATED_RADIO_TX_MICROS
+#define SIMULATED_RADIO_TX_MICROS 900
+#endif
+
+struct SimulatedFrame {
+  // micros() at the moment the frame started transmitting
+  unsigned long timestamp;
+  const MiLightRadioConfig* config;
+  uint8_t data[MILIGHT_MAX_PACKET_LENGTH];
+  size_t length;
+};
+
+// Shared by every radio created by the same factory, so the log reflects the
+// order frames hit the air regardless of which radio config sent them.
+typedef std::vector<SimulatedFrame> SimulatedAirLog;
+
+class SimulatedMiLightRadio : public MiLightRadio {
+public:
+  SimulatedMiLightRadio(
+    const MiLightRadioConfig& config,
+    std::shared_ptr<SimulatedAirLog> airLog,
+    unsigned long txMicros = SIMULATED_RADIO_TX_MICROS
+  );
+
+  virtual int begin();
+  virtual bool available();
+  virtual int read(uint8_t frame[], size_t& frame_length);
+  virtual int listen();
+  virtual int readPending(uint8_t frame[], size_t& frame_length);
+  virtual size_t getCrcErrorCount() const;
+  virtual int write(uint8_t frame[], size_t frame_length);
+  virtual int resend();
+  virtual int configure();
+  virtual const MiLightRadioConfig& config();
+
+  // Queue a frame as if it had been received over the air
+  void inject(const uint8_t* frame, size_t length);
+
+  size_t getConfigureCount() const;
+  size_t getWriteCount() const;
+
+private:
+  const MiLightRadioConfig& _config;
+  std::shared_ptr<SimulatedAirLog> airLog;
+  const unsigned long txMicros;
+
+  std::deque<std::vector<uint8_t>> rxQueue;
+  uint8_t lastFrame[MILIGHT_MAX_PACKET_LENGTH];
+  size_t lastFrameLength;
+
+  size_t configureCount;
+  size_t writeCount;
+};
+
+class SimulatedRadioFactory : public MiLightRadioFactory {
+public:
+  SimulatedRadioFactory(unsigned long txMicros = SIMULATED_RADIO_TX_MICROS, bool withListener = false);
+
+  virtual std::shared_ptr<MiLightRadio> create(const MiLightRadioConfig& config);
+  // Only creates radios if the factory was built withListener
+  virtual std::shared_ptr<MiLightRadio> createListener(const MiLightRadioConfig& config);
+
+  // Radio created for the given config, or nullptr if none was created yet
+  std::shared_ptr<SimulatedMiLightRadio> radioFor(const MiLightRadioConfig& config) const;
+  std::shared_ptr<SimulatedMiLightRadio> listenRadioFor(const MiLightRadioConfig& config) const;
+
+  const SimulatedAirLog& getAirLog() const;
+  void clearAirLog();
+
+private:
+  const unsigned long txMicros;
+  const bool withListener;
+  std::shared_ptr<SimulatedAirLog> airLog;
+  std::vector<std::shared_ptr<SimulatedMiLightRadio>> radios;
+  std::vector<std::shared_ptr<SimulatedMiLightRadio>> listenRadios;
+
+  static std::shared_ptr<SimulatedMiLightRadio> find(
+    const std::vector<std::shared_ptr<SimulatedMiLightRadio>>& radios,
+    const MiLightRadioConfig& config
+  );
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <Transition.h>
+#include <FieldTransition.h>
 
 #pragma once
 
@@ -7,31 +8,22 @@ public:
 
   class Builder : public Transition::Builder {
   public:
-    Builder(size_t id, GroupStateField field, uint16_t arg, std::shared_ptr<Transition::Builder> delgate);
-
-    virtual std::shared_ptr<Transition> _build() const override;
-
-  private:
-    const std::shared_ptr<Transition::Builder> delegate;
-    const GroupStateField field;
-    const uint16_t arg;
+    // delegate must describe a field transition
+    Builder(GroupStateField field, uint16_t arg, const Transition::Builder& delegate);
   };
 
-  ChangeFieldOnFinishTransition(
-    std::shared_ptr<Transition> delegate,
-    GroupStateField field,
-    uint16_t arg,
-    size_t period
-  );
+  // Expects a builder with its defaults bound
+  ChangeFieldOnFinishTransition(const Transition::Builder& builder);
 
   virtual bool isFinished() override;
 
 private:
-  std::shared_ptr<Transition> delegate;
+  FieldTransition delegate;
   const GroupStateField field;
   const uint16_t arg;
   bool changeSent;
 
   virtual void step() override;
+  virtual bool skipStep() override;
   virtual void childSerialize(JsonObject& json) override;
-};
\ No newline at end of file
+};
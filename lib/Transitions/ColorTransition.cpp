@@ -1,38 +1,11 @@
 #include <ColorTransition.h>
 #include <Arduino.h>
 
-ColorTransition::Builder::Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, TransitionFn callback, const ParsedColor& start, const ParsedColor& end)
-  : Transition::Builder(id, defaultPeriod, bulbId, callback, calculateMaxDistance(start, end))
-  , start(start)
-  , end(end)
-{ }
-
-std::shared_ptr<Transition> ColorTransition::Builder::_build() const {
-  size_t duration = getOrComputeDuration();
-  size_t numPeriods = getOrComputeNumPeriods();
-  size_t period = getOrComputePeriod();
-
-  int16_t dr = end.r - start.r
-        , dg = end.g - start.g
-        , db = end.b - start.b;
-
-  RgbColor stepSizes(
-    calculateStepSizePart(dr, duration, period),
-    calculateStepSizePart(dg, duration, period),
-    calculateStepSizePart(db, duration, period)
-  );
-
-  return std::make_shared<ColorTransition>(
-    id,
-    bulbId,
-    start,
-    end,
-    stepSizes,
-    duration,
-    period,
-    numPeriods,
-    callback
-  );
+ColorTransition::Builder::Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, const TransitionFn& callback, const ParsedColor& start, const ParsedColor& end)
+  : Transition::Builder(COLOR, id, defaultPeriod, bulbId, callback, calculateMaxDistance(start, end))
+{
+  this->startColor = start;
+  this->endColor = end;
 }
 
 ColorTransition::RgbColor::RgbColor()
@@ -57,26 +30,22 @@ bool ColorTransition::RgbColor::operator==(const RgbColor& other) {
   return r == other.r && g == other.g && b == other.b;
 }
 
-ColorTransition::ColorTransition(
-  size_t id,
-  const BulbId& bulbId,
-  const ParsedColor& startColor,
-  const ParsedColor& endColor,
-  RgbColor stepSizes,
-  size_t duration,
-  size_t period,
-  size_t numPeriods,
-  TransitionFn callback
-) : Transition(id, bulbId, period, callback)
-  , endColor(endColor)
-  , currentColor(startColor)
-  , stepSizes(stepSizes)
+ColorTransition::ColorTransition(const Transition::Builder& builder)
+  : Transition(builder)
+  , startColor(builder.startColor)
+  , endColor(builder.endColor)
+  , currentColor(builder.startColor)
+  , numSteps(builder.getOrComputeNumPeriods())
+  , stepIndex(0)
   , lastHue(400)         // use impossible values to force a packet send
   , lastSaturation(200)
+  , finished(false)
 {
-  int16_t dr = endColor.r - startColor.r
-        , dg = endColor.g - startColor.g
-        , db = endColor.b - startColor.b;
+  size_t duration = builder.getOrComputeDuration();
+
+  int16_t dr = endColor.r - currentColor.r
+        , dg = endColor.g - currentColor.g
+        , db = endColor.b - currentColor.b;
   // Calculate step sizes in terms of the period
   stepSizes.r = calculateStepSizePart(dr, duration, period);
   stepSizes.g = calculateStepSizePart(dg, duration, period);
@@ -122,15 +91,37 @@ void ColorTransition::step() {
     lastSaturation = parsedColor.saturation;
   }
   
-  if (!isFinished()) {
+  if (currentColor == endColor) {
+    finished = true;
+  } else {
+    advance();
+  }
+}
+
+bool ColorTransition::skipStep() {
+  if (finished || currentColor == endColor) {
+    return false;
+  }
+
+  advance();
+  return true;
+}
+
+void ColorTransition::advance() {
+  if (easing == EASING_LINEAR) {
     Transition::stepValue(currentColor.r, endColor.r, stepSizes.r);
     Transition::stepValue(currentColor.g, endColor.g, stepSizes.g);
     Transition::stepValue(currentColor.b, endColor.b, stepSizes.b);
+  } else {
+    ++stepIndex;
+    currentColor.r = Easing::interpolate(easing, startColor.r, endColor.r, stepIndex, numSteps);
+    currentColor.g = Easing::interpolate(easing, startColor.g, endColor.g, stepIndex, numSteps);
+    currentColor.b = Easing::interpolate(easing, startColor.b, endColor.b, stepIndex, numSteps);
   }
 }
 
 bool ColorTransition::isFinished() {
-  return currentColor == endColor; 
+  return finished;
 }
 
 void ColorTransition::childSerialize(JsonObject& json) {
@@ -16,27 +16,11 @@ public:
 
   class Builder : public Transition::Builder {
   public:
-    Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, TransitionFn callback, const ParsedColor& start, const ParsedColor& end);
-
-    virtual std::shared_ptr<Transition> _build() const override;
-
-  private:
-    const ParsedColor& start;
-    const ParsedColor& end;
-    RgbColor stepSizes;
+    Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, const TransitionFn& callback, const ParsedColor& start, const ParsedColor& end);
   };
 
-  ColorTransition(
-    size_t id,
-    const BulbId& bulbId,
-    const ParsedColor& startColor,
-    const ParsedColor& endColor,
-    RgbColor stepSizes,
-    size_t duration,
-    size_t period,
-    size_t numPeriods,
-    TransitionFn callback
-  );
+  // Expects a builder with its defaults bound
+  ColorTransition(const Transition::Builder& builder);
 
   static size_t calculateColorPeriod(ColorTransition* t, const ParsedColor& start, const ParsedColor& end, size_t stepSize, size_t duration);
   inline static size_t calculateMaxDistance(const ParsedColor& start, const ParsedColor& end);
@@ -44,15 +28,23 @@ public:
   virtual bool isFinished() override;
 
 protected:
+  const RgbColor startColor;
   const RgbColor endColor;
   RgbColor currentColor;
   RgbColor stepSizes;
 
+  // Used instead of stepSizes by eased transitions
+  const size_t numSteps;
+  size_t stepIndex;
+
   // Store these to avoid wasted packets
   uint16_t lastHue;
   uint16_t lastSaturation;
+  bool finished;
 
   virtual void step() override;
+  virtual bool skipStep() override;
   virtual void childSerialize(JsonObject& json) override;
+  void advance();
   static inline void stepPart(uint16_t& current, uint16_t end, int16_t step);
 };
\ No newline at end of file
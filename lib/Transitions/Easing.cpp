@@ -0,0 +1,140 @@
+#include <Easing.h>
+#include <Size.h>
+
+namespace EasingNames {
+  static const char LINEAR[] = "linear";
+  static const char EASE_IN[] = "ease_in";
+  static const char EASE_OUT[] = "ease_out";
+  static const char EASE_IN_OUT[] = "ease_in_out";
+  static const char PERCEPTUAL[] = "perceptual";
+}
+
+// Indexed by TransitionEasing
+static const char* EASING_NAMES[] = {
+  EasingNames::LINEAR,
+  EasingNames::EASE_IN,
+  EasingNames::EASE_OUT,
+  EasingNames::EASE_IN_OUT,
+  EasingNames::PERCEPTUAL
+};
+
+//================================================================================
+// Curves, evaluated at point i of SEGMENTS by the compiler
+//================================================================================
+
+static const uint64_t N = Easing::SEGMENTS;
+static const uint64_t FULL = Easing::FULL;
+
+static constexpr uint16_t divideRounded(uint64_t numerator, uint64_t denominator) {
+  return (numerator + denominator / 2) / denominator;
+}
+
+// t^3
+static constexpr uint16_t easeInAt(uint64_t i) {
+  return divideRounded(i * i * i * FULL, N * N * N);
+}
+
+// 1 - (1 - t)^3
+static constexpr uint16_t easeOutAt(uint64_t i) {
+  return FULL - easeInAt(N - i);
+}
+
+// 4t^3 for the first half, mirrored for the second
+static constexpr uint16_t easeInOutAt(uint64_t i) {
+  return 2 * i <= N
+    ? divideRounded(4 * i * i * i * FULL, N * N * N)
+    : FULL - divideRounded(4 * (N - i) * (N - i) * (N - i) * FULL, N * N * N);
+}
+
+// Relative luminance for a lightness (CIE L*) of 100t:
+//   ((100t + 16) / 116)^3  when 100t > 8
+//   100t / 903.3           otherwise
+static constexpr uint16_t perceptualAt(uint64_t i) {
+  return 100 * i > 8 * N
+    ? divideRounded((100 * i + 16 * N) * (100 * i + 16 * N) * (100 * i + 16 * N) * FULL, (116 * N) * (116 * N) * (116 * N))
+    : divideRounded(1000 * i * FULL, 9033 * N);
+}
+
+#define EASING_TABLE(fn) { \
+  fn(0),  fn(1),  fn(2),  fn(3),  fn(4),  fn(5),  fn(6),  fn(7), \
+  fn(8),  fn(9),  fn(10), fn(11), fn(12), fn(13), fn(14), fn(15), \
+  fn(16), fn(17), fn(18), fn(19), fn(20), fn(21), fn(22), fn(23), \
+  fn(24), fn(25), fn(26), fn(27), fn(28), fn(29), fn(30), fn(31), \
+  fn(32) \
+}
+
+static const uint16_t EASE_IN_TABLE[Easing::SEGMENTS + 1] PROGMEM = EASING_TABLE(easeInAt);
+static const uint16_t EASE_OUT_TABLE[Easing::SEGMENTS + 1] PROGMEM = EASING_TABLE(easeOutAt);
+static const uint16_t EASE_IN_OUT_TABLE[Easing::SEGMENTS + 1] PROGMEM = EASING_TABLE(easeInOutAt);
+static const uint16_t PERCEPTUAL_TABLE[Easing::SEGMENTS + 1] PROGMEM = EASING_TABLE(perceptualAt);
+
+//================================================================================
+
+uint16_t Easing::apply(TransitionEasing easing, uint16_t progress) {
+  const uint16_t* table;
+
+  switch (easing) {
+    case EASING_EASE_IN:
+      table = EASE_IN_TABLE;
+      break;
+    case EASING_EASE_OUT:
+      table = EASE_OUT_TABLE;
+      break;
+    case EASING_EASE_IN_OUT:
+      table = EASE_IN_OUT_TABLE;
+      break;
+    case EASING_PERCEPTUAL:
+      table = PERCEPTUAL_TABLE;
+      break;
+    default:
+      return progress;
+  }
+
+  if (progress >= Easing::FULL) {
+    return Easing::FULL;
+  }
+
+  // Each segment covers FULL / SEGMENTS (1024) steps of progress
+  const uint16_t segmentBits = 10;
+  const uint16_t segment = progress >> segmentBits;
+  const uint16_t offset = progress & ((1 << segmentBits) - 1);
+  const uint16_t from = pgm_read_word(&table[segment]);
+  const uint16_t to = pgm_read_word(&table[segment + 1]);
+
+  return from + ((static_cast<uint32_t>(to - from) * offset) >> segmentBits);
+}
+
+int16_t Easing::interpolate(TransitionEasing easing, int16_t start, int16_t end, size_t step, size_t numSteps) {
+  if (step >= numSteps) {
+    return end;
+  }
+
+  const uint16_t progress = (static_cast<uint32_t>(step) * Easing::FULL) / numSteps;
+  const int32_t distance = static_cast<int32_t>(end) - start;
+  const int32_t eased = distance * apply(easing, progress);
+
+  // Round half away from zero
+  return start + (eased + (distance < 0 ? -Easing::FULL / 2 : Easing::FULL / 2)) / static_cast<int32_t>(Easing::FULL);
+}
+
+TransitionEasing Easing::fromName(const char* name) {
+  if (name == nullptr) {
+    return EASING_UNKNOWN;
+  }
+
+  for (size_t i = 0; i < size(EASING_NAMES); i++) {
+    if (0 == strcmp(name, EASING_NAMES[i])) {
+      return static_cast<TransitionEasing>(i);
+    }
+  }
+
+  return EASING_UNKNOWN;
+}
+
+const char* Easing::getName(TransitionEasing easing) {
+  if (easing < size(EASING_NAMES)) {
+    return EASING_NAMES[easing];
+  }
+
+  return EASING_NAMES[EASING_LINEAR];
+}
@@ -0,0 +1,38 @@
+#include <Arduino.h>
+#include <stdint.h>
+
+#pragma once
+
+enum TransitionEasing : uint8_t {
+  EASING_LINEAR,
+  EASING_EASE_IN,
+  EASING_EASE_OUT,
+  EASING_EASE_IN_OUT,
+  // Even steps in perceived lightness (CIE L*) rather than in raw value, for
+  // brightness ramps
+  EASING_PERCEPTUAL,
+  EASING_UNKNOWN = 255
+};
+
+/**
+ * Easing curves in fixed point.  Progress and eased progress both run from 0
+ * to FULL.  Each curve is a lookup table generated at compile time and
+ * interpolated linearly, so stepping a transition needs no float math.
+ */
+class Easing {
+public:
+  static const uint16_t FULL = 1 << 15;
+  // Number of segments each curve's table is split into
+  static const uint16_t SEGMENTS = 32;
+
+  // Maps progress (0 to FULL) through the curve.  0 and FULL map to
+  // themselves exactly, and the result never decreases as progress grows.
+  static uint16_t apply(TransitionEasing easing, uint16_t progress);
+
+  // Value step out of numSteps takes on the way from start to end.  Lands
+  // exactly on end at the last step.
+  static int16_t interpolate(TransitionEasing easing, int16_t start, int16_t end, size_t step, size_t numSteps);
+
+  static TransitionEasing fromName(const char* name);
+  static const char* getName(TransitionEasing easing);
+};
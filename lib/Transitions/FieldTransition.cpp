@@ -2,8 +2,9 @@
 #include <cmath>
 #include <algorithm>
 
-FieldTransition::Builder::Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, TransitionFn callback, GroupStateField field, uint16_t start, uint16_t end)
+FieldTransition::Builder::Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, const TransitionFn& callback, GroupStateField field, uint16_t start, uint16_t end)
   : Transition::Builder(
+      FIELD,
       id,
       defaultPeriod,
       bulbId,
@@ -13,60 +14,61 @@ FieldTransition::Builder::Builder(size_t id, uint16_t defaultPeriod, const BulbI
         static_cast<size_t>(std::abs(static_cast<int16_t>(end) - static_cast<uint16_t>(start)))
       )
   )
-  , stepSize(0)
-  , field(field)
-  , start(start)
-  , end(end)
-{ }
+{
+  this->field = field;
+  this->start = start;
+  this->end = end;
+}
 
-std::shared_ptr<Transition> FieldTransition::Builder::_build() const {
-  size_t numPeriods = getOrComputeNumPeriods();
-  size_t period = getOrComputePeriod();
+int16_t FieldTransition::calculateStepSize(const Transition::Builder& builder) {
+  size_t numPeriods = builder.getOrComputeNumPeriods();
 
-  int16_t distance = end - start;
+  int16_t distance = builder.end - builder.start;
   int16_t stepSize = ceil(std::abs(distance / static_cast<float>(numPeriods)));
 
-  if (end < start) {
+  if (builder.end < builder.start) {
     stepSize = -stepSize;
   }
   if (stepSize == 0) {
-    stepSize = end > start ? 1 : -1;
+    stepSize = builder.end > builder.start ? 1 : -1;
   }
 
-  return std::make_shared<FieldTransition>(
-    id,
-    bulbId,
-    field,
-    start,
-    end,
-    stepSize,
-    period,
-    callback
-  );
+  return stepSize;
 }
 
-FieldTransition::FieldTransition(
-  size_t id,
-  const BulbId& bulbId,
-  GroupStateField field,
-  uint16_t startValue,
-  uint16_t endValue,
-  int16_t stepSize,
-  size_t period,
-  TransitionFn callback
-) : Transition(id, bulbId, period, callback)
-  , field(field)
-  , currentValue(startValue)
-  , endValue(endValue)
-  , stepSize(stepSize)
+FieldTransition::FieldTransition(const Transition::Builder& builder)
+  : Transition(builder)
+  , field(builder.field)
+  , startValue(builder.start)
+  , currentValue(builder.start)
+  , endValue(builder.end)
+  , stepSize(calculateStepSize(builder))
   , finished(false)
+  , numSteps(builder.getOrComputeNumPeriods())
+  , stepIndex(0)
 { }
 
 void FieldTransition::step() {
   callback(bulbId, field, currentValue);
+  advance();
+}
+
+bool FieldTransition::skipStep() {
+  if (finished || currentValue == endValue) {
+    return false;
+  }
+
+  advance();
+  return true;
+}
 
+void FieldTransition::advance() {
   if (currentValue != endValue) {
-    Transition::stepValue(currentValue, endValue, stepSize);
+    if (easing == EASING_LINEAR) {
+      Transition::stepValue(currentValue, endValue, stepSize);
+    } else {
+      currentValue = Easing::interpolate(easing, startValue, endValue, ++stepIndex, numSteps);
+    }
   } else {
     finished = true;
   }
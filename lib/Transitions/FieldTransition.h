@@ -12,37 +12,33 @@ public:
 
   class Builder : public Transition::Builder {
   public:
-    Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, TransitionFn callback, GroupStateField field, uint16_t start, uint16_t end);
-
-    virtual std::shared_ptr<Transition> _build() const override;
-
-  private:
-    size_t stepSize;
-    GroupStateField field;
-    uint16_t start;
-    uint16_t end;
+    Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, const TransitionFn& callback, GroupStateField field, uint16_t start, uint16_t end);
   };
 
-  FieldTransition(
-    size_t id,
-    const BulbId& bulbId,
-    GroupStateField field,
-    uint16_t startValue,
-    uint16_t endValue,
-    int16_t stepSize,
-    size_t period,
-    TransitionFn callback
-  );
+  // Expects a builder with its defaults bound
+  FieldTransition(const Transition::Builder& builder);
 
   virtual bool isFinished() override;
+  virtual void step() override;
+  virtual bool skipStep() override;
+  virtual void childSerialize(JsonObject& json) override;
 
-private:
+protected:
   const GroupStateField field;
+  const int16_t startValue;
   int16_t currentValue;
   const int16_t endValue;
   const int16_t stepSize;
   bool finished;
 
-  virtual void step() override;
-  virtual void childSerialize(JsonObject& json) override;
+  // Eased transitions work out each value from how far along they are
+  // rather than adding stepSize
+  const size_t numSteps;
+  size_t stepIndex;
+
+  // Moves currentValue one step towards endValue, or marks the transition
+  // finished if it's already there
+  void advance();
+
+  static int16_t calculateStepSize(const Transition::Builder& builder);
 };
\ No newline at end of file
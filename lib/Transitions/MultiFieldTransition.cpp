@@ -0,0 +1,136 @@
+#include <MultiFieldTransition.h>
+#include <MiLightRemoteConfig.h>
+
+MultiFieldTransition::MultiFieldTransition(const Transition::Builder& builder)
+  : FieldTransition(builder)
+  , numTargets(1)
+  , finishField(builder.finishField)
+  , finishArg(builder.finishArg)
+  , finishSent(false)
+{
+  targets[0] = builder.bulbId;
+}
+
+bool MultiFieldTransition::canJoin(const Transition::Builder& builder) const {
+  return lastSent == 0
+    && builder.field == field
+    && builder.easing == easing
+    && static_cast<int16_t>(builder.start) == currentValue
+    && static_cast<int16_t>(builder.end) == endValue
+    && builder.getOrComputePeriod() == period
+    && calculateStepSize(builder) == stepSize
+    && builder.finishField == finishField
+    && builder.finishArg == finishArg;
+}
+
+bool MultiFieldTransition::addTarget(const BulbId& bulbId) {
+  for (size_t i = 0; i < numTargets; i++) {
+    if (targets[i] == bulbId) {
+      return true;
+    }
+  }
+
+  if (numTargets == MAX_TARGETS) {
+    return false;
+  }
+
+  targets[numTargets++] = bulbId;
+  return true;
+}
+
+void MultiFieldTransition::collapseGroups() {
+  for (size_t i = 0; i < numTargets; i++) {
+    const BulbId& target = targets[i];
+    const MiLightRemoteConfig* remote = MiLightRemoteConfig::fromType(target.deviceType);
+
+    // Remotes without groups have no group 0 to fall back on
+    if (remote == nullptr || remote->numGroups == 0) {
+      continue;
+    }
+
+    // Earlier entries for this device would already have been merged, so
+    // only later ones need looking at
+    uint16_t groups = 0;
+    for (size_t j = i; j < numTargets; j++) {
+      if (targets[j].deviceId == target.deviceId && targets[j].deviceType == target.deviceType) {
+        groups |= 1 << targets[j].groupId;
+      }
+    }
+
+    const uint16_t allGroups = ((1 << (remote->numGroups + 1)) - 1) & ~1;
+
+    if ((groups & 1) == 0 && (groups & allGroups) != allGroups) {
+      continue;
+    }
+
+    targets[i] = BulbId(target.deviceId, 0, target.deviceType);
+
+    size_t kept = i + 1;
+    for (size_t j = i + 1; j < numTargets; j++) {
+      if (targets[j].deviceId != targets[i].deviceId || targets[j].deviceType != targets[i].deviceType) {
+        targets[kept++] = targets[j];
+      }
+    }
+    numTargets = kept;
+  }
+}
+
+size_t MultiFieldTransition::getNumTargets() const {
+  return numTargets;
+}
+
+const BulbId& MultiFieldTransition::getTarget(size_t index) const {
+  return targets[index];
+}
+
+void MultiFieldTransition::send(GroupStateField field, uint16_t value) {
+  for (size_t i = 0; i < numTargets; i++) {
+    callback(targets[i], field, value);
+  }
+}
+
+void MultiFieldTransition::step() {
+  if (! FieldTransition::isFinished()) {
+    send(field, currentValue);
+    advance();
+  } else {
+    send(finishField, finishArg);
+    finishSent = true;
+  }
+}
+
+bool MultiFieldTransition::isFinished() {
+  return FieldTransition::isFinished()
+    && (finishField == GroupStateField::UNKNOWN || finishSent);
+}
+
+// With one target, this looks the same as the transition it was built from
+void MultiFieldTransition::childSerialize(JsonObject& json) {
+  if (numTargets == 1) {
+    if (finishField == GroupStateField::UNKNOWN) {
+      FieldTransition::childSerialize(json);
+    } else {
+      json[F("type")] = F("change_on_finish");
+      json[F("field")] = GroupStateFieldHelpers::getFieldName(finishField);
+      json[F("value")] = finishArg;
+
+      JsonObject child = json.createNestedObject(F("child"));
+      FieldTransition::childSerialize(child);
+    }
+    return;
+  }
+
+  FieldTransition::childSerialize(json);
+  json[F("type")] = F("multi_field");
+
+  if (finishField != GroupStateField::UNKNOWN) {
+    json[F("finish_field")] = GroupStateFieldHelpers::getFieldName(finishField);
+    json[F("finish_value")] = finishArg;
+  }
+
+  JsonArray bulbs = json.createNestedArray(F("bulbs"));
+  for (size_t i = 0; i < numTargets; i++) {
+    JsonObject bulb = bulbs.createNestedObject();
+    targets[i].serialize(bulb);
+  }
+}
@@ -0,0 +1,53 @@
+#include <FieldTransition.h>
+#include <BulbId.h>
+
+#pragma once
+
+// Most bulbs one MultiFieldTransition can step.  Enough for two 8-zone remotes.
+#ifndef MILIGHT_MAX_TRANSITION_TARGETS
+#define MILIGHT_MAX_TRANSITION_TARGETS 16
+#endif
+
+/**
+ * A field transition that steps several bulbs on one timeline.  Every target
+ * gets the same value on the same tick, so the radio sends them back to back
+ * instead of at unrelated times.
+ *
+ * Built from a field transition (or a change-on-finish wrapping one) for the
+ * first target; others that start with exactly the same timing are added
+ * with addTarget().
+ */
+class MultiFieldTransition : public FieldTransition {
+public:
+  static const size_t MAX_TARGETS = MILIGHT_MAX_TRANSITION_TARGETS;
+
+  // Expects a builder with its defaults bound
+  MultiFieldTransition(const Transition::Builder& builder);
+
+  // True if the builder describes the same steps this transition will take,
+  // and this transition hasn't started yet
+  bool canJoin(const Transition::Builder& builder) const;
+  // Returns false if there's no room for another target
+  bool addTarget(const BulbId& bulbId);
+  // Replaces the targets that cover every group of a device with group 0 of
+  // that device, so each step is one command rather than one per group.
+  void collapseGroups();
+
+  size_t getNumTargets() const;
+  const BulbId& getTarget(size_t index) const;
+
+  virtual bool isFinished() override;
+  virtual void step() override;
+  virtual void childSerialize(JsonObject& json) override;
+
+private:
+  BulbId targets[MAX_TARGETS];
+  size_t numTargets;
+
+  // Sent to every target once the fade is done, if finishField is set
+  const GroupStateField finishField;
+  const uint16_t finishArg;
+  bool finishSent;
+
+  void send(GroupStateField field, uint16_t value);
+};
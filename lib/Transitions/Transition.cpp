@@ -2,11 +2,20 @@
 #include <Arduino.h>
 #include <cmath>
 
-Transition::Builder::Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, TransitionFn callback, size_t maxSteps)
-  : id(id)
+Transition::Builder::Builder(Type type, size_t id, uint16_t defaultPeriod, const BulbId& bulbId, const TransitionFn& callback, size_t maxSteps)
+  : type(type)
+  , id(id)
   , defaultPeriod(defaultPeriod)
   , bulbId(bulbId)
   , callback(callback)
+  , easing(EASING_LINEAR)
+  , field(GroupStateField::UNKNOWN)
+  , start(0)
+  , end(0)
+  , startColor(ParsedColor{ })
+  , endColor(ParsedColor{ })
+  , finishField(GroupStateField::UNKNOWN)
+  , finishArg(0)
   , duration(0)
   , period(0)
   , numPeriods(0)
@@ -27,6 +36,11 @@ Transition::Builder& Transition::Builder::setPeriod(size_t period) {
   return *this;
 }
 
+Transition::Builder& Transition::Builder::setEasing(TransitionEasing easing) {
+  this->easing = easing;
+  return *this;
+}
+
 Transition::Builder& Transition::Builder::setDurationAwarePeriod(size_t period, size_t duration, size_t maxSteps) {
   if ((period * maxSteps) < duration) {
     setPeriod(std::ceil(duration / static_cast<float>(maxSteps)));
@@ -106,7 +120,7 @@ size_t Transition::Builder::getOrComputeNumPeriods() const {
   }
 }
 
-std::shared_ptr<Transition> Transition::Builder::build() {
+void Transition::Builder::bindDefaults() {
   // Set defaults for underspecified transitions
   size_t numSet = numSetParams();
 
@@ -122,33 +136,40 @@ std::shared_ptr<Transition> Transition::Builder::build() {
       setDurationAwarePeriod(defaultPeriod, duration, maxSteps);
     }
   }
-
-  return _build();
 }
 
-Transition::Transition(
-  size_t id,
-  const BulbId& bulbId,
-  size_t period,
-  TransitionFn callback
-) : id(id)
-  , bulbId(bulbId)
-  , callback(callback)
-  , period(period)
+Transition::Transition(const Builder& builder)
+  : id(builder.id)
+  , bulbId(builder.bulbId)
+  , callback(builder.callback)
+  , period(builder.getOrComputePeriod())
+  , easing(builder.easing)
   , lastSent(0)
 { }
 
-void Transition::tick() {
+void Transition::tick(bool skipIntermediate) {
   unsigned long now = millis();
 
-  if ((lastSent + period) <= now
+  // Compared as the time since the last step, so this holds up when millis()
+  // wraps.  The first step is taken straight away.
+  if ((lastSent == 0 || now - lastSent >= period)
     && ((!isFinished() || lastSent == 0))) { // always send at least once
 
-    step();
+    if (! skipIntermediate || ! skipStep()) {
+      step();
+    }
     lastSent = now;
   }
 }
 
+bool Transition::skipStep() {
+  return false;
+}
+
+unsigned long Transition::nextTickAt() const {
+  return lastSent == 0 ? millis() : lastSent + period;
+}
+
 size_t Transition::calculatePeriod(int16_t distance, size_t stepSize, size_t duration) {
   float fPeriod =
     distance != 0
@@ -170,6 +191,7 @@ void Transition::stepValue(int16_t& current, int16_t end, int16_t stepSize) {
 void Transition::serialize(JsonObject& json) {
   json[F("id")] = id;
   json[F("period")] = period;
+  json[F("easing")] = Easing::getName(easing);
   json[F("last_sent")] = lastSent;
 
   JsonObject bulbParams = json.createNestedObject("bulb");
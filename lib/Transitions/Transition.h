@@ -1,10 +1,11 @@
 #include <BulbId.h>
 #include <ArduinoJson.h>
 #include <GroupStateField.h>
+#include <ParsedColor.h>
+#include <Easing.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <functional>
-#include <memory>
 
 #pragma once
 
@@ -15,13 +16,28 @@ public:
   // transition commands are in seconds, convert to ms.
   static const uint16_t DURATION_UNIT_MULTIPLIER = 1000;
 
+  enum Type : uint8_t {
+    FIELD,
+    COLOR,
+    CHANGE_FIELD_ON_FINISH
+  };
 
+  /**
+   * Describes a transition to start.  Builders are plain values, so they can
+   * live on the stack: create one through TransitionController, adjust its
+   * timing, and hand it to TransitionController::addTransition, which
+   * constructs the transition in a pre-allocated slot.
+   *
+   * Subclasses only differ in how they fill in the fields below, so slicing
+   * one down to a Transition::Builder loses nothing.
+   */
   class Builder {
   public:
-    Builder(size_t id, uint16_t defaultPeriod, const BulbId& bulbId, TransitionFn callback, size_t maxSteps);
+    Builder(Type type, size_t id, uint16_t defaultPeriod, const BulbId& bulbId, const TransitionFn& callback, size_t maxSteps);
 
     Builder& setDuration(float duration);
     Builder& setPeriod(size_t period);
+    Builder& setEasing(TransitionEasing easing);
 
     /**
      * Users are typically defining transitions using:
@@ -38,6 +54,10 @@ public:
 
     void setDurationRaw(size_t duration);
 
+    // Sets defaults for whichever of duration, period and number of periods
+    // weren't specified.  Called before the transition is constructed.
+    void bindDefaults();
+
     bool isSetDuration() const;
     bool isSetPeriod() const;
     bool isSetNumPeriods() const;
@@ -51,12 +71,25 @@ public:
     size_t getNumPeriods() const;
     size_t getMaxSteps() const;
 
-    std::shared_ptr<Transition> build();
-
+    Type type;
     const size_t id;
     const uint16_t defaultPeriod;
-    const BulbId& bulbId;
-    const TransitionFn callback;
+    const BulbId bulbId;
+    const TransitionFn& callback;
+    TransitionEasing easing;
+
+    // FIELD, and the field transition CHANGE_FIELD_ON_FINISH runs first
+    GroupStateField field;
+    uint16_t start;
+    uint16_t end;
+
+    // COLOR
+    ParsedColor startColor;
+    ParsedColor endColor;
+
+    // CHANGE_FIELD_ON_FINISH
+    GroupStateField finishField;
+    uint16_t finishArg;
 
   private:
     size_t duration;
@@ -64,7 +97,6 @@ public:
     size_t numPeriods;
     size_t maxSteps;
 
-    virtual std::shared_ptr<Transition> _build() const = 0;
     size_t numSetParams() const;
   };
 
@@ -74,25 +106,31 @@ public:
 
   const size_t id;
   const BulbId bulbId;
-  const TransitionFn callback;
+  const TransitionFn& callback;
 
-  Transition(
-    size_t id,
-    const BulbId& bulbId,
-    size_t period,
-    TransitionFn callback
-  );
+  Transition(const Builder& builder);
+  virtual ~Transition() { }
 
-  void tick();
+  // Takes the step that's due.  With skipIntermediate set, a step that
+  // doesn't send the final value advances without sending anything.
+  void tick(bool skipIntermediate = false);
   virtual bool isFinished() = 0;
+  // millis() at which tick() will next step this transition.  Now, if it
+  // hasn't taken a step yet.
+  unsigned long nextTickAt() const;
   void serialize(JsonObject& doc);
   virtual void step() = 0;
+  // Advances like step() without sending anything.  Returns false, and
+  // leaves the transition alone, if the step is the one that lands on the
+  // end value.
+  virtual bool skipStep();
   virtual void childSerialize(JsonObject& doc) = 0;
 
   static size_t calculatePeriod(int16_t distance, size_t stepSize, size_t duration);
 
 protected:
   const size_t period;
+  const TransitionEasing easing;
   unsigned long lastSent;
 
   static void stepValue(int16_t& current, int16_t end, int16_t stepSize);
@@ -2,12 +2,15 @@
 #include <FieldTransition.h>
 #include <ColorTransition.h>
 #include <ChangeFieldOnFinishTransition.h>
+#include <MultiFieldTransition.h>
 #include <GroupStateField.h>
 #include <MiLightStatus.h>
 
 #include <TransitionController.h>
-#include <LinkedList.h>
+#include <Arduino.h>
+#include <algorithm>
 #include <functional>
+#include <new>
 
 using namespace std::placeholders;
 
@@ -15,12 +18,34 @@ TransitionController::TransitionController()
   : callback(std::bind(&TransitionController::transitionCallback, this, _1, _2, _3))
   , currentId(2) //Don't start at 0
   , defaultPeriod(500)
-{ }
+  , maxBacklog(0)
+  , numActive(0)
+  , numScheduled(0)
+  , batching(false)
+  , numBatchTransitions(0)
+{
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    slotTransitions[i] = nullptr;
+  }
+}
+
+TransitionController::~TransitionController() {
+  clear();
+}
 
 void TransitionController::setDefaultPeriod(uint16_t defaultPeriod) {
   this->defaultPeriod = defaultPeriod;
 }
 
+void TransitionController::setBacklogSource(BacklogFn backlog, size_t maxBacklog) {
+  this->backlog = backlog;
+  this->maxBacklog = maxBacklog;
+}
+
+bool TransitionController::isCongested() const {
+  return backlog && backlog() >= maxBacklog;
+}
+
 void TransitionController::clearListeners() {
   observers.clear();
 }
@@ -29,8 +54,8 @@ void TransitionController::addListener(Transition::TransitionFn fn) {
   observers.push_back(fn);
 }
 
-std::shared_ptr<Transition::Builder> TransitionController::buildColorTransition(const BulbId& bulbId, const ParsedColor& start, const ParsedColor& end) {
-  return std::make_shared<ColorTransition::Builder>(
+Transition::Builder TransitionController::buildColorTransition(const BulbId& bulbId, const ParsedColor& start, const ParsedColor& end) {
+  return ColorTransition::Builder(
     currentId++,
     defaultPeriod,
     bulbId,
@@ -40,8 +65,8 @@ std::shared_ptr<Transition::Builder> TransitionController::buildColorTransition(
   );
 }
 
-std::shared_ptr<Transition::Builder> TransitionController::buildFieldTransition(const BulbId& bulbId, GroupStateField field, uint16_t start, uint16_t end) {
-  return std::make_shared<FieldTransition::Builder>(
+Transition::Builder TransitionController::buildFieldTransition(const BulbId& bulbId, GroupStateField field, uint16_t start, uint16_t end) {
+  return FieldTransition::Builder(
     currentId++,
     defaultPeriod,
     bulbId,
@@ -52,28 +77,108 @@ std::shared_ptr<Transition::Builder> TransitionController::buildFieldTransition(
   );
 }
 
-std::shared_ptr<Transition::Builder> TransitionController::buildStatusTransition(const BulbId& bulbId, MiLightStatus status, uint8_t startLevel) {
-  std::shared_ptr<Transition::Builder> transition;
-
+Transition::Builder TransitionController::buildStatusTransition(const BulbId& bulbId, MiLightStatus status, uint8_t startLevel) {
   if (status == ON) {
     // Make sure bulb is on before transitioning brightness
     callback(bulbId, GroupStateField::STATUS, ON);
 
-    transition = buildFieldTransition(bulbId, GroupStateField::LEVEL, startLevel, 100);
+    return buildFieldTransition(bulbId, GroupStateField::LEVEL, startLevel, 100);
   } else {
-    transition = std::make_shared<ChangeFieldOnFinishTransition::Builder>(
-      currentId++,
+    return ChangeFieldOnFinishTransition::Builder(
       GroupStateField::STATUS,
       OFF,
       buildFieldTransition(bulbId, GroupStateField::LEVEL, startLevel, 0)
     );
   }
+}
+
+Transition* TransitionController::addTransition(Transition::Builder builder) {
+  builder.bindDefaults();
+
+  if (batching && (builder.type == Transition::FIELD || builder.type == Transition::CHANGE_FIELD_ON_FINISH)) {
+    Transition* transition = addToBatch(builder);
+
+    if (transition != nullptr) {
+      return transition;
+    }
+  }
+
+  int slot = findFreeSlot(0, MAX_TRANSITIONS);
+
+  if (slot < 0) {
+    Serial.println(F("Too many active transitions, ignoring new one"));
+    return nullptr;
+  }
+
+  Transition* transition;
+
+  switch (builder.type) {
+    case Transition::COLOR:
+      transition = new (&slots[slot].color) ColorTransition(builder);
+      break;
+    case Transition::CHANGE_FIELD_ON_FINISH:
+      transition = new (&slots[slot].changeFieldOnFinish) ChangeFieldOnFinishTransition(builder);
+      break;
+    default:
+      transition = new (&slots[slot].field) FieldTransition(builder);
+      break;
+  }
+
+  activate(slot, transition);
+  return transition;
+}
+
+Transition* TransitionController::addToBatch(const Transition::Builder& builder) {
+  for (size_t i = 0; i < numBatchTransitions; i++) {
+    MultiFieldTransition* transition = batchTransitions[i];
+
+    if (transition->canJoin(builder) && transition->addTarget(builder.bulbId)) {
+      return transition;
+    }
+  }
+
+  int slot = findFreeSlot(MAX_TRANSITIONS, NUM_SLOTS);
+
+  // Falls back on a transition of its own
+  if (slot < 0) {
+    return nullptr;
+  }
+
+  MultiFieldTransition* transition = new (&multiSlots[slot - MAX_TRANSITIONS].multiField) MultiFieldTransition(builder);
+  batchTransitions[numBatchTransitions++] = transition;
+  activate(slot, transition);
 
   return transition;
 }
 
-void TransitionController::addTransition(std::shared_ptr<Transition> transition) {
-  activeTransitions.add(transition);
+void TransitionController::beginBatch() {
+  batching = true;
+  numBatchTransitions = 0;
+}
+
+void TransitionController::endBatch() {
+  for (size_t i = 0; i < numBatchTransitions; i++) {
+    batchTransitions[i]->collapseGroups();
+  }
+
+  batching = false;
+  numBatchTransitions = 0;
+}
+
+void TransitionController::activate(uint8_t slot, Transition* transition) {
+  slotTransitions[slot] = transition;
+  activeSlots[numActive++] = slot;
+  scheduleStep(slot);
+}
+
+int TransitionController::findFreeSlot(size_t from, size_t to) const {
+  for (size_t slot = from; slot < to; slot++) {
+    if (slotTransitions[slot] == nullptr) {
+      return slot;
+    }
+  }
+
+  return -1;
 }
 
 void TransitionController::transitionCallback(const BulbId& bulbId, GroupStateField field, uint16_t arg) {
@@ -83,60 +188,112 @@ void TransitionController::transitionCallback(const BulbId& bulbId, GroupStateFi
 }
 
 void TransitionController::clear() {
-  activeTransitions.clear();
+  while (numActive > 0) {
+    removeTransition(activeSlots[numActive - 1]);
+  }
 }
 
 void TransitionController::loop() {
-  auto current = activeTransitions.getHead();
+  const uint32_t now = millis();
+  // Transitions rescheduled for right now (a period of 0) wait for the next call
+  size_t remaining = numScheduled;
 
-  while (current != nullptr) {
-    auto next = current->next;
+  while (remaining-- > 0 && static_cast<int32_t>(now - schedule[0].dueAt) >= 0) {
+    std::pop_heap(schedule, schedule + numScheduled, isLater);
+    const uint8_t slot = schedule[--numScheduled].slot;
 
-    Transition& t = *current->data;
-    t.tick();
+    // Checked for every step, since each one can add to the backlog
+    Transition& t = *slotTransitions[slot];
+    t.tick(isCongested());
 
     if (t.isFinished()) {
-      activeTransitions.remove(current);
+      removeTransition(slot);
+    } else {
+      scheduleStep(slot);
     }
+  }
+}
 
-    current = next;
+void TransitionController::scheduleStep(uint8_t slot) {
+  ScheduledStep& step = schedule[numScheduled++];
+  step.dueAt = slotTransitions[slot]->nextTickAt();
+  step.slot = slot;
+
+  std::push_heap(schedule, schedule + numScheduled, isLater);
+}
+
+void TransitionController::removeTransition(uint8_t slot) {
+  for (size_t i = 0; i < numScheduled; i++) {
+    if (schedule[i].slot == slot) {
+      schedule[i] = schedule[--numScheduled];
+      std::make_heap(schedule, schedule + numScheduled, isLater);
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < numActive; i++) {
+    if (activeSlots[i] == slot) {
+      std::copy(activeSlots + i + 1, activeSlots + numActive, activeSlots + i);
+      --numActive;
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < numBatchTransitions; i++) {
+    if (batchTransitions[i] == slotTransitions[slot]) {
+      batchTransitions[i] = batchTransitions[--numBatchTransitions];
+      break;
+    }
   }
+
+  slotTransitions[slot]->~Transition();
+  slotTransitions[slot] = nullptr;
+}
+
+bool TransitionController::isLater(const ScheduledStep& a, const ScheduledStep& b) {
+  // Compare the difference so this holds up when millis() wraps
+  return static_cast<int32_t>(a.dueAt - b.dueAt) > 0;
 }
 
-ListNode<std::shared_ptr<Transition>>* TransitionController::getTransitions() {
-  return activeTransitions.getHead();
+size_t TransitionController::getNumTransitions() const {
+  return numActive;
 }
 
-ListNode<std::shared_ptr<Transition>>* TransitionController::findTransition(size_t id) {
-  auto current = getTransitions();
+Transition* TransitionController::getTransitionAt(size_t index) {
+  if (index >= numActive) {
+    return nullptr;
+  }
+
+  return slotTransitions[activeSlots[index]];
+}
 
-  while (current != nullptr) {
-    if (current->data->id == id) {
-      return current;
+int TransitionController::findSlot(size_t id) const {
+  for (size_t i = 0; i < numActive; i++) {
+    if (slotTransitions[activeSlots[i]]->id == id) {
+      return activeSlots[i];
     }
-    current = current->next;
   }
 
-  return nullptr;
+  return -1;
 }
 
 Transition* TransitionController::getTransition(size_t id) {
-  auto node = findTransition(id);
+  int slot = findSlot(id);
 
-  if (node == nullptr) {
+  if (slot < 0) {
     return nullptr;
   } else {
-    return node->data.get();
+    return slotTransitions[slot];
   }
 }
 
 bool TransitionController::deleteTransition(size_t id) {
-  auto node = findTransition(id);
+  int slot = findSlot(id);
 
-  if (node == nullptr) {
+  if (slot < 0) {
     return false;
   } else {
-    activeTransitions.remove(node);
+    removeTransition(slot);
     return true;
   }
-}
\ No newline at end of file
+}
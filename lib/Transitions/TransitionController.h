@@ -1,39 +1,132 @@
 #include <Transition.h>
-#include <LinkedList.h>
+#include <FieldTransition.h>
+#include <ColorTransition.h>
+#include <ChangeFieldOnFinishTransition.h>
+#include <MultiFieldTransition.h>
 #include <ParsedColor.h>
 #include <GroupStateField.h>
-#include <memory>
+#include <MiLightStatus.h>
 #include <vector>
 
 #pragma once
 
+// Most transitions that can run at once.  Each one reserves a slot of RAM
+// whether it's in use or not (see "Notes on transitions" in the README).
+// Transitions started past this fail.
+#ifndef MILIGHT_MAX_TRANSITIONS
+#define MILIGHT_MAX_TRANSITIONS 32
+#endif
+
+// Most transitions stepping several bulbs that can run at once.  These are
+// larger, so they get a pool of their own.
+#ifndef MILIGHT_MAX_MULTI_TRANSITIONS
+#define MILIGHT_MAX_MULTI_TRANSITIONS 2
+#endif
+
 class TransitionController {
 public:
+  using BacklogFn = std::function<size_t()>;
+
+  static const size_t MAX_TRANSITIONS = MILIGHT_MAX_TRANSITIONS;
+  static const size_t MAX_MULTI_TRANSITIONS = MILIGHT_MAX_MULTI_TRANSITIONS;
+
   TransitionController();
+  ~TransitionController();
 
   void clearListeners();
   void addListener(Transition::TransitionFn fn);
   void setDefaultPeriod(uint16_t period);
 
-  std::shared_ptr<Transition::Builder> buildColorTransition(const BulbId& bulbId, const ParsedColor& start, const ParsedColor& end);
-  std::shared_ptr<Transition::Builder> buildFieldTransition(const BulbId& bulbId, GroupStateField field, uint16_t start, uint16_t end);
-  std::shared_ptr<Transition::Builder> buildStatusTransition(const BulbId& bulbId, MiLightStatus toStatus, uint8_t startLevel);
+  // Tells loop() how many packets are waiting to be sent.  While that's at
+  // least maxBacklog, transitions skip their intermediate steps instead of
+  // sending them, so a radio that can't keep up isn't buried.  Steps that
+  // land on an end value are always sent, so transitions still finish where
+  // and when they were meant to.
+  void setBacklogSource(BacklogFn backlog, size_t maxBacklog);
 
-  void addTransition(std::shared_ptr<Transition> transition);
+  Transition::Builder buildColorTransition(const BulbId& bulbId, const ParsedColor& start, const ParsedColor& end);
+  Transition::Builder buildFieldTransition(const BulbId& bulbId, GroupStateField field, uint16_t start, uint16_t end);
+  Transition::Builder buildStatusTransition(const BulbId& bulbId, MiLightStatus toStatus, uint8_t startLevel);
+
+  // Starts the transition the builder describes.  Returns nullptr if every
+  // slot is taken.
+  Transition* addTransition(Transition::Builder builder);
+
+  // Between these calls, field transitions that would take identical steps
+  // are merged into one MultiFieldTransition, which steps all of their bulbs
+  // together.  Bulbs covering every group of a device are replaced by group 0
+  // when the batch ends.  Don't call loop() in between.
+  void beginBatch();
+  void endBatch();
   void clear();
   void loop();
 
-  ListNode<std::shared_ptr<Transition>>* getTransitions();
+  // Active transitions, oldest first
+  size_t getNumTransitions() const;
+  Transition* getTransitionAt(size_t index);
+
   Transition* getTransition(size_t id);
-  ListNode<std::shared_ptr<Transition>>* findTransition(size_t id);
   bool deleteTransition(size_t id);
 
 private:
+  // Storage for one transition of any type
+  union TransitionSlot {
+    TransitionSlot() { }
+    ~TransitionSlot() { }
+
+    FieldTransition field;
+    ColorTransition color;
+    ChangeFieldOnFinishTransition changeFieldOnFinish;
+  };
+
+  union MultiTransitionSlot {
+    MultiTransitionSlot() { }
+    ~MultiTransitionSlot() { }
+
+    MultiFieldTransition multiField;
+  };
+
+  // Slots 0 to MAX_TRANSITIONS - 1 are in slots, the rest in multiSlots
+  static const size_t NUM_SLOTS = MAX_TRANSITIONS + MAX_MULTI_TRANSITIONS;
+
+  // A transition's next step, kept in a min-heap on dueAt so that loop() only
+  // touches transitions that are due.
+  struct ScheduledStep {
+    // millis() truncated to 32 bits, as on the ESP8266, so that wrapping
+    // behaves the same on the host
+    uint32_t dueAt;
+    uint8_t slot;
+  };
+
   Transition::TransitionFn callback;
-  LinkedList<std::shared_ptr<Transition>> activeTransitions;
   std::vector<Transition::TransitionFn> observers;
   size_t currentId;
   uint16_t defaultPeriod;
+  BacklogFn backlog;
+  size_t maxBacklog;
+
+  TransitionSlot slots[MAX_TRANSITIONS];
+  MultiTransitionSlot multiSlots[MAX_MULTI_TRANSITIONS];
+  // The transition living in each slot, or nullptr if it's free
+  Transition* slotTransitions[NUM_SLOTS];
+  // Slots in use, oldest first
+  uint8_t activeSlots[NUM_SLOTS];
+  size_t numActive;
+  ScheduledStep schedule[NUM_SLOTS];
+  size_t numScheduled;
+
+  bool batching;
+  // Multi-transitions started in the current batch, which can take more bulbs
+  MultiFieldTransition* batchTransitions[MAX_MULTI_TRANSITIONS];
+  size_t numBatchTransitions;
 
   void transitionCallback(const BulbId& bulbId, GroupStateField field, uint16_t arg);
-};
\ No newline at end of file
+  int findSlot(size_t id) const;
+  bool isCongested() const;
+  int findFreeSlot(size_t from, size_t to) const;
+  Transition* addToBatch(const Transition::Builder& builder);
+  void activate(uint8_t slot, Transition* transition);
+  void scheduleStep(uint8_t slot);
+  void removeTransition(uint8_t slot);
+  static bool isLater(const ScheduledStep& a, const ScheduledStep& b);
+};
@@ -0,0 +1,122 @@
+#include <MiLightCommand.h>
+
+MiLightCommand::MiLightCommand()
+  : MiLightCommand(BulbId())
+{ }
+
+MiLightCommand::MiLightCommand(const BulbId& bulbId)
+  : bulbId(bulbId),
+    fields(0),
+    status(OFF),
+    hue(0),
+    saturation(0),
+    kelvin(0),
+    colorTemp(0),
+    mode(0),
+    effect(EFFECT_MODE),
+    effectMode(0),
+    color(ParsedColor{ }),
+    level(0),
+    brightness(0),
+    transition(0)
+{ }
+
+MiLightCommand& MiLightCommand::setStatus(MiLightStatus status) {
+  this->status = status;
+  fields |= STATUS;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setHue(uint16_t hue) {
+  this->hue = hue;
+  fields |= HUE;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setSaturation(uint8_t saturation) {
+  this->saturation = saturation;
+  fields |= SATURATION;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setKelvin(uint8_t kelvin) {
+  this->kelvin = kelvin;
+  fields |= KELVIN;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setColorTemp(uint16_t colorTemp) {
+  this->colorTemp = colorTemp;
+  fields |= COLOR_TEMP;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setMode(uint8_t mode) {
+  this->mode = mode;
+  fields |= MODE;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setEffect(Effect effect, uint8_t mode) {
+  this->effect = effect;
+  this->effectMode = mode;
+  fields |= EFFECT;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setColor(const ParsedColor& color) {
+  this->color = color;
+  fields |= COLOR;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setLevel(uint8_t level) {
+  this->level = level;
+  fields |= LEVEL;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setBrightness(uint8_t brightness) {
+  this->brightness = brightness;
+  fields |= BRIGHTNESS;
+  return *this;
+}
+
+MiLightCommand& MiLightCommand::setTransition(float transition) {
+  this->transition = transition;
+  return *this;
+}
+
+bool MiLightCommand::set(GroupStateField field, uint16_t value) {
+  switch (field) {
+    case GroupStateField::STATUS:
+    case GroupStateField::STATE:
+      setStatus(static_cast<MiLightStatus>(value));
+      break;
+    case GroupStateField::HUE:
+      setHue(value);
+      break;
+    case GroupStateField::SATURATION:
+      setSaturation(value);
+      break;
+    case GroupStateField::KELVIN:
+      setKelvin(value);
+      break;
+    case GroupStateField::COLOR_TEMP:
+      setColorTemp(value);
+      break;
+    case GroupStateField::MODE:
+      setMode(value);
+      break;
+    case GroupStateField::LEVEL:
+      setLevel(value);
+      break;
+    case GroupStateField::BRIGHTNESS:
+      setBrightness(value);
+      break;
+    default:
+      return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,81 @@
+#include <stdint.h>
+#include <BulbId.h>
+#include <GroupStateField.h>
+#include <MiLightStatus.h>
+#include <ParsedColor.h>
+
+#pragma once
+
+/*
+ * A state change for one bulb, with its values already parsed.
+ *
+ * This is what MiLightClient::apply takes.  Internal callers (transitions,
+ * alarms) build these directly, and JSON requests are lowered into one, so
+ * nothing on those paths has to go through ArduinoJson.
+ */
+struct MiLightCommand {
+  // Bits of `fields`.  Fields are applied in this order, except that a status
+  // of ON is applied first and a status of OFF last.
+  enum Field : uint16_t {
+    STATUS     = 1 << 0,
+    HUE        = 1 << 1,
+    SATURATION = 1 << 2,
+    KELVIN     = 1 << 3,
+    COLOR_TEMP = 1 << 4,
+    MODE       = 1 << 5,
+    EFFECT     = 1 << 6,
+    COLOR      = 1 << 7,
+    LEVEL      = 1 << 8,
+    BRIGHTNESS = 1 << 9
+  };
+
+  enum Effect : uint8_t {
+    EFFECT_MODE,
+    EFFECT_NIGHT_MODE,
+    EFFECT_WHITE
+  };
+
+  BulbId bulbId;
+  uint16_t fields;
+
+  MiLightStatus status;
+  uint16_t hue;
+  uint8_t saturation;
+  uint8_t kelvin;
+  // In mireds
+  uint16_t colorTemp;
+  uint8_t mode;
+  Effect effect;
+  // Mode to switch to when effect is EFFECT_MODE
+  uint8_t effectMode;
+  ParsedColor color;
+  // 0-100
+  uint8_t level;
+  // 0-255
+  uint8_t brightness;
+
+  // Length of the transition to the new values in seconds, or 0 to set them
+  // directly
+  float transition;
+
+  MiLightCommand();
+  MiLightCommand(const BulbId& bulbId);
+
+  bool has(Field field) const { return (fields & field) != 0; }
+
+  MiLightCommand& setStatus(MiLightStatus status);
+  MiLightCommand& setHue(uint16_t hue);
+  MiLightCommand& setSaturation(uint8_t saturation);
+  MiLightCommand& setKelvin(uint8_t kelvin);
+  MiLightCommand& setColorTemp(uint16_t colorTemp);
+  MiLightCommand& setMode(uint8_t mode);
+  MiLightCommand& setEffect(Effect effect, uint8_t mode = 0);
+  MiLightCommand& setColor(const ParsedColor& color);
+  MiLightCommand& setLevel(uint8_t level);
+  MiLightCommand& setBrightness(uint8_t brightness);
+  MiLightCommand& setTransition(float transition);
+
+  // Sets a field from a value as transitions report it.  Returns false if
+  // the field can't be set from a single number.
+  bool set(GroupStateField field, uint16_t value);
+};
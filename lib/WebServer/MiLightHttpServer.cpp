@@ -189,6 +189,35 @@ void MiLightHttpServer::handleAbout(RequestContext& request) {
   JsonObject queueStats = request.response.json.createNestedObject("queue_stats");
   queueStats[F("length")] = packetSender->queueLength();
   queueStats[F("dropped_packets")] = packetSender->droppedPackets();
+  queueStats[F("coalesced_packets")] = packetSender->coalescedPackets();
+
+  JsonObject stateStats = request.response.json.createNestedObject("state_stats");
+  stateStats[F("flush_backlog")] = stateStore->flushBacklog();
+
+  JsonObject radioStats = request.response.json.createNestedObject("radio_stats");
+  radioStats[F("reconfigurations")] = radios->getReconfigurationCount();
+  radioStats[F("reconfigurations_per_second")] = radios->getReconfigurationsPerSecond();
+  radioStats[F("receive_overflows")] = radios->getReceiveOverflowCount();
+
+  JsonArray receiveStats = radioStats.createNestedArray(F("receive_stats"));
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[i];
+    RadioReceiveStats stats = radios->getReceiveStats(config);
+    JsonObject configStats = receiveStats.createNestedObject();
+
+    JsonArray remoteTypes = configStats.createNestedArray(F("remote_types"));
+    for (size_t j = 0; j < MiLightRemoteConfig::NUM_REMOTES; j++) {
+      if (&MiLightRemoteConfig::ALL_REMOTES[j]->radioConfig == &config) {
+        remoteTypes.add(MiLightRemoteConfig::ALL_REMOTES[j]->name.c_str());
+      }
+    }
+
+    configStats[F("received")] = stats.received;
+    configStats[F("duplicates")] = stats.duplicates;
+    configStats[F("crc_errors")] = stats.crcErrors;
+    configStats[F("decoded")] = stats.decoded;
+    configStats[F("listen_weight")] = radios->getListenWeight(config);
+  }
 }
 
 void MiLightHttpServer::handleGetRadioConfigs(RequestContext& request) {
@@ -318,7 +347,7 @@ void MiLightHttpServer::handleListenGateway(RequestContext& request) {
   }
 
   if (tmpRemoteConfig != NULL) {
-    radio = radios->switchRadio(tmpRemoteConfig);
+    radio = radios->switchListenRadio(tmpRemoteConfig);
   }
 
   while (remoteConfig == NULL) {
@@ -327,7 +356,7 @@ void MiLightHttpServer::handleListenGateway(RequestContext& request) {
     }
 
     if (listenAll) {
-      radio = radios->switchRadio(configIx++ % radios->getNumRadios());
+      radio = radios->switchListenRadio(configIx++ % radios->getNumRadios());
     } else {
       radio->configure();
     }
@@ -505,6 +534,17 @@ void MiLightHttpServer::handleUpdateGroup(RequestContext& request) {
   BulbId foundBulbId;
   size_t groupCount = 0;
 
+  // Transitions for several bulbs share one timeline where they can, so the
+  // bulbs change together.  A single bulb doesn't need a batch, and shouldn't
+  // take up one of the few multi-bulb transition slots.
+  const bool severalBulbs = _remoteTypes.indexOf(',') >= 0
+    || _deviceIds.indexOf(',') >= 0
+    || _groupIds.indexOf(',') >= 0;
+
+  if (severalBulbs) {
+    transitions.beginBatch();
+  }
+
   while (remoteTypesItr.hasNext()) {
     const char* _remoteType = remoteTypesItr.nextToken();
     const MiLightRemoteConfig* config = MiLightRemoteConfig::fromType(_remoteType);
@@ -514,6 +554,7 @@ void MiLightHttpServer::handleUpdateGroup(RequestContext& request) {
       sprintf_P(buffer, PSTR("Unknown device type: %s"), _remoteType);
       request.response.setCode(400);
       request.response.json["error"] = buffer;
+      transitions.endBatch();
       return;
     }
 
@@ -533,6 +574,8 @@ void MiLightHttpServer::handleUpdateGroup(RequestContext& request) {
     }
   }
 
+  transitions.endBatch();
+
   if (groupCount == 1) {
     sendGroupState(false, foundBulbId, request.response);
   } else {
@@ -661,13 +704,11 @@ void MiLightHttpServer::handleDeleteTransition(RequestContext& request) {
 void MiLightHttpServer::handleListTransitions(RequestContext& request) {
   alarms->stopAutoTurnOff();
 
-  auto current = transitions.getTransitions();
-  JsonArray transitions = request.response.json.to<JsonObject>().createNestedArray(F("transitions"));
+  JsonArray transitionsJson = request.response.json.to<JsonObject>().createNestedArray(F("transitions"));
 
-  while (current != nullptr) {
-    JsonObject json = transitions.createNestedObject();
-    current->data->serialize(json);
-    current = current->next;
+  for (size_t i = 0; i < transitions.getNumTransitions(); i++) {
+    JsonObject json = transitionsJson.createNestedObject();
+    transitions.getTransitionAt(i)->serialize(json);
   }
 }
 
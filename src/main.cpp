@@ -56,7 +56,6 @@ std::shared_ptr<MiLightRadioFactory> radioFactory;
 MiLightHttpServer *httpServer = NULL;
 MqttClient* mqttClient = NULL;
 MiLightDiscoveryServer* discoveryServer = NULL;
-uint8_t currentRadioType = 0;
 
 //Alarms
 AlarmController* alarmController;
@@ -149,40 +148,79 @@ void onPacketSentHandler(uint8_t* packet, const MiLightRemoteConfig& config) {
 }
 
 /**
- * Listen for packets on one radio config.  Cycles through all configs as its
- * called.
+ * Decodes a packet received with the given radio config and updates state
+ */
+void handleReceivedPacket(const MiLightRadioConfig& radioConfig, uint8_t* packet, size_t packetLen) {
+  const MiLightRemoteConfig* remoteConfig = radios->identifyRemote(
+    radioConfig,
+    packet,
+    packetLen
+  );
+
+  if (remoteConfig == NULL) {
+    // This can happen under normal circumstances, so not an error condition
+#ifdef DEBUG_PRINTF
+    Serial.println(F("WARNING: Couldn't find remote for received packet"));
+#endif
+    return;
+  }
+
+  // update state to reflect this packet
+  onPacketSentHandler(packet, *remoteConfig);
+}
+
+/**
+ * Decodes packets the radio interrupt handler received since the last loop,
+ * and keeps the radio listening.  Moves on to the next radio config unless
+ * the listen radio is busy sending packets or hasn't settled yet.  Busier
+ * configs are listened with more often (see ListenScheduler).
+ */
+void handleInterruptListen() {
+  ReceivedPacket received;
+
+  while (radios->readReceived(received)) {
+    handleReceivedPacket(*received.config, received.packet, received.length);
+  }
+
+  if (radios->hasListenRadio() || ! packetSender->isSending()) {
+    radios->switchToNextListenConfig();
+  }
+
+  // Without a listen radio, this listens between repeats with whatever config
+  // was last sent with
+  radios->listen();
+}
+
+/**
+ * Listen for packets on one radio config.  Cycles through the configs as its
+ * called, favoring those remotes have been heard on.
  */
 void handleListen() {
+  if (! settings.listenRepeats) {
+    return;
+  }
+
+  if (radios->isInterruptDriven()) {
+    handleInterruptListen();
+    return;
+  }
+
   // Do not handle listens while there are packets enqueued to be sent
   // Doing so causes the radio module to need to be reinitialized inbetween
-  // repeats, which slows things down.
-  if (! settings.listenRepeats || packetSender->isSending()) {
+  // repeats, which slows things down.  A dedicated listen radio doesn't
+  // have that problem.
+  if (packetSender->isSending() && ! radios->hasListenRadio()) {
     return;
   }
 
-  std::shared_ptr<MiLightRadio> radio = radios->switchRadio(currentRadioType++ % radios->getNumRadios());
+  std::shared_ptr<MiLightRadio> radio = radios->switchToNextListenConfig();
 
   for (size_t i = 0; i < settings.listenRepeats; i++) {
     if (radios->available()) {
       uint8_t readPacket[MILIGHT_MAX_PACKET_LENGTH];
       size_t packetLen = radios->read(readPacket);
 
-      const MiLightRemoteConfig* remoteConfig = MiLightRemoteConfig::fromReceivedPacket(
-        radio->config(),
-        readPacket,
-        packetLen
-      );
-
-      if (remoteConfig == NULL) {
-        // This can happen under normal circumstances, so not an error condition
-#ifdef DEBUG_PRINTF
-        Serial.println(F("WARNING: Couldn't find remote for received packet"));
-#endif
-        return;
-      }
-
-      // update state to reflect this packet
-      onPacketSentHandler(readPacket, *remoteConfig);
+      handleReceivedPacket(radio->config(), readPacket, packetLen);
     }
   }
 }
@@ -239,7 +277,12 @@ void applySettings() {
     Serial.println(F("ERROR: unable to construct radio factory"));
   }
 
-  stateStore = new GroupStateStore(MILIGHT_MAX_STATE_ITEMS, settings.stateFlushInterval);
+  stateStore = new GroupStateStore(
+    MILIGHT_MAX_STATE_ITEMS,
+    settings.stateFlushInterval,
+    settings.stateFlushBudgetBytes,
+    settings.stateFlushBudgetMicros
+  );
 
   radios = new RadioSwitchboard(radioFactory, stateStore, settings);
   packetSender = new PacketSender(*radios, settings, onPacketSentHandler);
@@ -455,14 +498,19 @@ void setup() {
 
   transitions.addListener(
     [](const BulbId& bulbId, GroupStateField field, uint16_t value) {
-      StaticJsonDocument<100> buffer;
+      MiLightCommand command(bulbId);
 
-      const char* fieldName = GroupStateFieldHelpers::getFieldName(field);
-      buffer[fieldName] = value;
-      milightClient->prepare(bulbId.deviceType, bulbId.deviceId, bulbId.groupId);
-      milightClient->update(buffer.as<JsonObject>());
+      if (command.set(field, value)) {
+        milightClient->apply(command);
+      }
     }
   );
+  // Thin out transition steps once the packet queue is half full, rather than
+  // letting it overflow
+  transitions.setBacklogSource(
+    []() { return packetSender->queueLength(); },
+    MILIGHT_MAX_QUEUED_PACKETS / 2
+  );
 
   Serial.printf_P(PSTR("Setup complete (version %s)\n"), QUOTE(MILIGHT_HUB_VERSION));
 }
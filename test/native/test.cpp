@@ -0,0 +1,2336 @@
+#include <FS.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <GroupStateCache.h>
+#include <GroupStateStore.h>
+#include <GroupStatePersistence.h>
+#include <MiLightClient.h>
+#include <MiLightRemoteConfig.h>
+#include <NRF24MiLightRadio.h>
+#include <LT8900MiLightRadio.h>
+#include <RadioUtils.h>
+#include <DuplicatePacketFilter.h>
+#include <ListenScheduler.h>
+#include <PacketQueue.h>
+#include <PacketSender.h>
+#include <RadioSwitchboard.h>
+#include <TransitionController.h>
+#include <V2RFEncoding.h>
+#include <SimulatedMiLightRadio.h>
+#include <SimulatedLT8900.h>
+#include <SPI.h>
+#include <SpscRing.h>
+#include <NativeHeap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <string>
+
+#include "unity.h"
+
+//================================================================================
+// Fixtures
+//================================================================================
+
+// Wires up the same pipeline as src/main.cpp, but with simulated radios.
+struct SimulatedHub {
+  SimulatedHub()
+    : stateStore(10, 0)
+    , radioFactory(std::make_shared<SimulatedRadioFactory>())
+    , radios(radioFactory, &stateStore, settings)
+    , packetSender(radios, settings, [this](uint8_t* packet, const MiLightRemoteConfig& config) { onPacketSent(packet, config); })
+    , client(radios, packetSender, &stateStore, settings, transitions)
+    , packetsSent(0)
+  { }
+
+  // Mirrors onPacketSentHandler in src/main.cpp
+  void onPacketSent(uint8_t* packet, const MiLightRemoteConfig& config) {
+    StaticJsonDocument<200> buffer;
+    JsonObject result = buffer.to<JsonObject>();
+
+    ++packetsSent;
+    BulbId bulbId = config.packetFormatter->parsePacket(packet, result);
+
+    if (&bulbId == &DEFAULT_BULB_ID) {
+      return;
+    }
+
+    GroupState* groupState = stateStore.get(bulbId);
+    const GroupState stateUpdates(groupState, result);
+
+    if (groupState != NULL) {
+      groupState->patch(stateUpdates);
+      stateStore.set(bulbId, stateUpdates);
+    }
+  }
+
+  // Run the packet sender until its queue drains.  Returns number of iterations.
+  size_t drain(size_t maxIterations = 1000) {
+    size_t iterations = 0;
+    while (packetSender.isSending() && iterations++ < maxIterations) {
+      packetSender.loop();
+    }
+    return iterations;
+  }
+
+  Settings settings;
+  GroupStateStore stateStore;
+  std::shared_ptr<SimulatedRadioFactory> radioFactory;
+  RadioSwitchboard radios;
+  PacketSender packetSender;
+  TransitionController transitions;
+  MiLightClient client;
+  size_t packetsSent;
+};
+
+//================================================================================
+// Simulated radio
+//================================================================================
+
+void test_simulated_radio_records_frames() {
+  NativeClock::reset();
+
+  SimulatedRadioFactory factory(100);
+  std::shared_ptr<MiLightRadio> radio = factory.create(MiLightRadioConfig::ALL_CONFIGS[0]);
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x00};
+  radio->write(packet, sizeof(packet));
+  radio->resend();
+
+  const SimulatedAirLog& log = factory.getAirLog();
+  TEST_ASSERT_EQUAL_INT_MESSAGE(2, log.size(), "Should record a frame for write and resend");
+  TEST_ASSERT_EQUAL_INT_MESSAGE(0, log[0].timestamp, "First frame should start at time 0");
+  TEST_ASSERT_EQUAL_INT_MESSAGE(100, log[1].timestamp, "Each frame should advance the virtual clock");
+  TEST_ASSERT_TRUE_MESSAGE(log[1].config == &MiLightRadioConfig::ALL_CONFIGS[0], "Should record radio config");
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), log[1].length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, log[1].data, sizeof(packet));
+}
+
+void test_simulated_radio_receive() {
+  SimulatedRadioFactory factory;
+  std::shared_ptr<MiLightRadio> radio = factory.create(MiLightRadioConfig::ALL_CONFIGS[0]);
+  std::shared_ptr<SimulatedMiLightRadio> simulated = factory.radioFor(MiLightRadioConfig::ALL_CONFIGS[0]);
+
+  TEST_ASSERT_FALSE(radio->available());
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x00};
+  simulated->inject(packet, sizeof(packet));
+  TEST_ASSERT_TRUE_MESSAGE(radio->available(), "Injected frame should be available");
+
+  uint8_t frame[MILIGHT_MAX_PACKET_LENGTH];
+  size_t length = sizeof(frame);
+  radio->read(frame, length);
+
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, frame, sizeof(packet));
+  TEST_ASSERT_FALSE(radio->available());
+}
+
+//================================================================================
+// nRF24 radio
+//================================================================================
+
+void test_nrf24_receive_keeps_radio_configured() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  std::vector<RF24Channel> channels = { RF24Channel::RF24_LOW };
+  RF24 rf24(0, 0);
+  NRF24MiLightRadio radio(rf24, 0, config, channels, RF24Channel::RF24_LOW);
+  radio.begin();
+
+  TEST_ASSERT_FALSE(radio.available());
+  size_t begins = rf24.begins;
+
+  for (uint8_t i = 0; i < 5; i++) {
+    uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, i};
+
+    // What goes out on air is what the receive path expects to come in
+    radio.write(packet, sizeof(packet));
+    const std::vector<uint8_t> frame = rf24.txFrames.back();
+    TEST_ASSERT_FALSE(radio.available());
+    rf24.inject(frame.data(), frame.size());
+
+    TEST_ASSERT_TRUE_MESSAGE(radio.available(), "Injected frame should be available");
+
+    uint8_t received[MILIGHT_MAX_PACKET_LENGTH];
+    size_t length = sizeof(received);
+    radio.read(received, length);
+
+    TEST_ASSERT_EQUAL_INT(sizeof(packet), length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, received, sizeof(packet));
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(begins, rf24.begins, "Radio should not be reset between packets");
+}
+
+void test_nrf24_recovers_from_reset() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  std::vector<RF24Channel> channels = { RF24Channel::RF24_LOW };
+  RF24 rf24(0, 0);
+  NRF24MiLightRadio radio(rf24, 0, config, channels, RF24Channel::RF24_LOW);
+  radio.begin();
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  radio.write(packet, sizeof(packet));
+  const std::vector<uint8_t> frame = rf24.txFrames.back();
+
+  TEST_ASSERT_FALSE(radio.available());
+  rf24.powerCycle();
+  size_t begins = rf24.begins;
+
+  // Nothing gets through until the radio is noticed to be misconfigured
+  rf24.inject(frame.data(), frame.size());
+  TEST_ASSERT_FALSE(radio.available());
+  TEST_ASSERT_EQUAL_INT(begins, rf24.begins);
+
+  NativeClock::advanceMillis(PL1167_NRF24_HEALTH_CHECK_INTERVAL);
+  TEST_ASSERT_FALSE(radio.available());
+  TEST_ASSERT_EQUAL_INT_MESSAGE(begins + 1, rf24.begins, "Radio should be reset once it stops responding");
+
+  TEST_ASSERT_FALSE(radio.available());
+  rf24.inject(frame.data(), frame.size());
+  TEST_ASSERT_TRUE(radio.available());
+}
+
+void test_nrf24_read_pending() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  std::vector<RF24Channel> channels = { RF24Channel::RF24_LOW };
+  RF24 rf24(0, 0);
+  NRF24MiLightRadio radio(rf24, 0, config, channels, RF24Channel::RF24_LOW);
+  radio.begin();
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  radio.write(packet, sizeof(packet));
+  const std::vector<uint8_t> frame = rf24.txFrames.back();
+
+  uint8_t received[MILIGHT_MAX_PACKET_LENGTH];
+  size_t length = sizeof(received);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(-1, radio.readPending(received, length), "Nothing to read yet");
+
+  radio.listen();
+  rf24.inject(frame.data(), frame.size());
+  rf24.inject(frame.data(), frame.size());
+
+  // Talks to the radio over SPI itself rather than through the driver, so it
+  // can run in an interrupt handler: STATUS, the payload, FLUSH_RX and
+  // clearing the interrupt
+  const size_t spiCalls = SPI.calls;
+  length = sizeof(received);
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), radio.readPending(received, length));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, received, sizeof(packet));
+  TEST_ASSERT_EQUAL_INT(4, SPI.calls - spiCalls);
+  TEST_ASSERT_FALSE_MESSAGE(rf24.available(), "Repeats behind the packet should be flushed");
+
+  length = sizeof(received);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(-1, radio.readPending(received, length), "Packet should only be read once");
+}
+
+// Frame the PL1167 sends for a packet, computed a bit at a time
+static std::vector<uint8_t> referencePl1167Frame(const uint8_t* packet, size_t length) {
+  std::vector<uint8_t> payload(1, length);
+  payload.insert(payload.end(), packet, packet + length);
+
+  uint16_t crc = 0;
+  for (uint8_t byte : payload) {
+    for (int j = 0; j < 8; j++) {
+      crc = ((byte ^ crc) & 0x01) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+      byte >>= 1;
+    }
+  }
+  payload.push_back(crc & 0xFF);
+  payload.push_back(crc >> 8);
+
+  std::vector<uint8_t> frame;
+  for (uint8_t byte : payload) {
+    uint8_t reversed = 0;
+    for (int j = 0; j < 8; j++) {
+      reversed |= ((byte >> j) & 0x01) << (7 - j);
+    }
+    frame.push_back(reversed);
+  }
+
+  return frame;
+}
+
+void test_nrf24_frames_match_reference() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  std::vector<RF24Channel> channels = { RF24Channel::RF24_LOW, RF24Channel::RF24_MID, RF24Channel::RF24_HIGH };
+  RF24 rf24(0, 0);
+  NRF24MiLightRadio radio(rf24, 0, config, channels, RF24Channel::RF24_LOW);
+  radio.begin();
+
+  for (size_t i = 0; i < 256; i++) {
+    uint8_t byte = i;
+    TEST_ASSERT_EQUAL_HEX8(referencePl1167Frame(&byte, 1)[1], reverseBits(i));
+  }
+
+  for (uint8_t i = 0; i < 20; i++) {
+    uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, static_cast<uint8_t>(i * 13), 0x00, i};
+    const std::vector<uint8_t> expected = referencePl1167Frame(packet, sizeof(packet));
+
+    rf24.txFrames.clear();
+    radio.write(packet, sizeof(packet));
+    radio.write(packet, sizeof(packet));
+
+    // A packet received between repeats doesn't disturb the one being sent
+    std::vector<uint8_t> frame = rf24.txFrames.back();
+    radio.listen();
+    rf24.inject(frame.data(), frame.size());
+    TEST_ASSERT_TRUE(radio.available());
+    radio.resend();
+
+    TEST_ASSERT_EQUAL_INT(3 * channels.size(), rf24.txFrames.size());
+    for (size_t j = 0; j < rf24.txFrames.size(); j++) {
+      TEST_ASSERT_EQUAL_INT(expected.size(), rf24.txFrames[j].size());
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), rf24.txFrames[j].data(), expected.size());
+    }
+  }
+}
+
+//================================================================================
+// LT8900 radio
+//================================================================================
+
+static const uint8_t LT8900_CS_PIN = 15;
+static const uint8_t LT8900_PKT_FLAG_PIN = 4;
+
+void test_lt8900_sends_repeats_from_loop() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  SimulatedLT8900 chip(LT8900_CS_PIN, LT8900_PKT_FLAG_PIN);
+  LT8900Registers registers;
+  LT8900MiLightRadio radio(LT8900_CS_PIN, 0, LT8900_PKT_FLAG_PIN, config, registers);
+  radio.begin();
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  const size_t repeats = 10;
+
+  unsigned long start = micros();
+  for (size_t i = 0; i < repeats; i++) {
+    radio.write(packet, sizeof(packet));
+  }
+  TEST_ASSERT_LESS_THAN_MESSAGE(200, micros() - start, "write() shouldn't wait for the radio");
+  TEST_ASSERT_TRUE(radio.isTransmitting());
+
+  unsigned long longestStall = 0;
+  while (radio.isTransmitting()) {
+    NativeClock::advanceMicros(100);
+
+    start = micros();
+    radio.loop();
+    longestStall = std::max(longestStall, micros() - start);
+  }
+  TEST_ASSERT_LESS_THAN_MESSAGE(200, longestStall, "loop() shouldn't wait for the radio");
+
+  TEST_ASSERT_EQUAL_INT(repeats * MiLightRadioConfig::NUM_CHANNELS, chip.txFrames.size());
+  for (size_t i = 0; i < chip.txFrames.size(); i++) {
+    const SimulatedLT8900Frame& frame = chip.txFrames[i];
+
+    TEST_ASSERT_EQUAL_INT(config.channels[i % MiLightRadioConfig::NUM_CHANNELS], frame.channel);
+    TEST_ASSERT_EQUAL_INT(sizeof(packet), frame.data.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(packet, frame.data.data(), sizeof(packet));
+
+    if (i > 0) {
+      TEST_ASSERT_TRUE_MESSAGE(
+        frame.timestamp - chip.txFrames[i - 1].timestamp >= SIMULATED_LT8900_TX_MICROS + DEFAULT_TIME_BETWEEN_RETRANSMISSIONS_uS,
+        "Transmissions should be spaced out"
+      );
+    }
+  }
+}
+
+void test_lt8900_receives_after_sending() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  SimulatedLT8900 chip(LT8900_CS_PIN, LT8900_PKT_FLAG_PIN);
+  LT8900Registers registers;
+  LT8900MiLightRadio radio(LT8900_CS_PIN, 0, LT8900_PKT_FLAG_PIN, config, registers);
+  radio.begin();
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  radio.write(packet, sizeof(packet));
+
+  // Not listening until the radio has settled after sending
+  TEST_ASSERT_FALSE(radio.available());
+  TEST_ASSERT_FALSE(chip.inject(packet, sizeof(packet)));
+
+  while (!chip.isListening()) {
+    NativeClock::advanceMicros(100);
+    TEST_ASSERT_FALSE(radio.available());
+  }
+  TEST_ASSERT_FALSE(radio.isTransmitting());
+
+  TEST_ASSERT_TRUE(chip.inject(packet, sizeof(packet)));
+  TEST_ASSERT_TRUE(radio.available());
+
+  uint8_t received[MILIGHT_MAX_PACKET_LENGTH];
+  size_t length = sizeof(received);
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), radio.read(received, length));
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, received, sizeof(packet));
+  TEST_ASSERT_FALSE(radio.available());
+}
+
+// Rotates through the configs the way handleListen() does, with a
+// millisecond between loops
+void test_lt8900_receives_while_rotating_configs() {
+  NativeClock::reset();
+  SimulatedLT8900 chip(LT8900_CS_PIN, LT8900_PKT_FLAG_PIN);
+  Settings settings;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<LT8900Factory> factory = std::make_shared<LT8900Factory>(LT8900_CS_PIN, 0, LT8900_PKT_FLAG_PIN);
+  RadioSwitchboard radios(factory, &stateStore, settings);
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  std::vector<const MiLightRadioConfig*> heardWith;
+
+  for (size_t loop = 0; loop < 200; loop++) {
+    std::shared_ptr<MiLightRadio> radio = radios.switchToNextListenConfig();
+
+    packet[5] = loop;
+    chip.inject(packet, sizeof(packet));
+
+    for (size_t i = 0; i < settings.listenRepeats; i++) {
+      if (radios.available()) {
+        uint8_t received[MILIGHT_MAX_PACKET_LENGTH];
+        TEST_ASSERT_EQUAL_INT(sizeof(packet), radios.read(received));
+        TEST_ASSERT_EQUAL_HEX8(loop, received[5]);
+        heardWith.push_back(&radio->config());
+      }
+    }
+
+    NativeClock::advanceMicros(1000);
+  }
+
+  // Each config settles (8ms) before the next one is tried
+  TEST_ASSERT_TRUE(heardWith.size() >= 2 * MiLightRadioConfig::NUM_CONFIGS);
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    TEST_ASSERT_TRUE(heardWith[i] == &MiLightRadioConfig::ALL_CONFIGS[i]);
+  }
+}
+
+void test_lt8900_skips_unchanged_registers() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  const MiLightRadioConfig& otherConfig = MiLightRadioConfig::ALL_CONFIGS[1];
+  SimulatedLT8900 chip(LT8900_CS_PIN, LT8900_PKT_FLAG_PIN);
+  LT8900Registers registers;
+
+  // Nothing's known about the registers yet, so they're all written
+  size_t transactions = chip.transactions;
+  LT8900MiLightRadio radio(LT8900_CS_PIN, 0, LT8900_PKT_FLAG_PIN, config, registers);
+  const size_t fullInit = chip.transactions - transactions;
+
+  LT8900MiLightRadio otherRadio(LT8900_CS_PIN, 0, LT8900_PKT_FLAG_PIN, otherConfig, registers);
+  radio.begin();
+  otherRadio.configure();
+  TEST_ASSERT_EQUAL_HEX16(otherConfig.syncword0, chip.getRegister(R_SYNCWORD1));
+  TEST_ASSERT_EQUAL_HEX16(otherConfig.syncword3, chip.getRegister(R_SYNCWORD4));
+
+  // Switching back only rewrites the registers that differ between configs
+  transactions = chip.transactions;
+  radio.configure();
+  TEST_ASSERT_LESS_THAN(fullInit / 4, chip.transactions - transactions);
+  TEST_ASSERT_EQUAL_HEX16(config.syncword0, chip.getRegister(R_SYNCWORD1));
+  TEST_ASSERT_EQUAL_HEX16(config.syncword3, chip.getRegister(R_SYNCWORD4));
+  TEST_ASSERT_EQUAL_HEX16(0x5681, chip.getRegister(1));
+
+  // Each frame is: stop RX, flush the FIFOs, load the FIFO, start TX.  Each
+  // of those is one transaction and one call onto the SPI bus.
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  transactions = chip.transactions;
+  const size_t spiCalls = SPI.calls;
+
+  radio.write(packet, sizeof(packet));
+  radio.resend();
+  while (radio.isTransmitting()) {
+    NativeClock::advanceMicros(100);
+    radio.loop();
+  }
+
+  TEST_ASSERT_EQUAL_INT(2 * MiLightRadioConfig::NUM_CHANNELS, chip.txFrames.size());
+  TEST_ASSERT_EQUAL_INT(4 * chip.txFrames.size(), chip.transactions - transactions);
+  TEST_ASSERT_EQUAL_INT(4 * chip.txFrames.size(), SPI.calls - spiCalls);
+
+  // Every access switches the bus to the LT8900's mode and back, since other
+  // devices may share it
+  TEST_ASSERT_EQUAL_INT(0, chip.wrongModeTransfers);
+  TEST_ASSERT_EQUAL_INT(SPI_MODE0, SPI.dataMode);
+}
+
+//================================================================================
+// Receiving
+//================================================================================
+
+void test_duplicate_filter_window() {
+  NativeClock::reset();
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  const MiLightRadioConfig& otherConfig = MiLightRadioConfig::ALL_CONFIGS[1];
+  DuplicatePacketFilter filter(100);
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  uint8_t nextPacket[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x02};
+
+  TEST_ASSERT_FALSE(filter.isDuplicate(config, packet, sizeof(packet)));
+  TEST_ASSERT_TRUE_MESSAGE(filter.isDuplicate(config, packet, sizeof(packet)), "Repeat should be a duplicate");
+  TEST_ASSERT_FALSE_MESSAGE(filter.isDuplicate(otherConfig, packet, sizeof(packet)), "Other configs are tracked separately");
+  TEST_ASSERT_FALSE(filter.isDuplicate(config, nextPacket, sizeof(nextPacket)));
+
+  // Repeats keep the window open
+  for (size_t i = 0; i < 5; i++) {
+    NativeClock::advanceMillis(60);
+    TEST_ASSERT_TRUE(filter.isDuplicate(config, packet, sizeof(packet)));
+  }
+
+  NativeClock::advanceMillis(100);
+  TEST_ASSERT_FALSE_MESSAGE(filter.isDuplicate(config, packet, sizeof(packet)), "Should expire after the window");
+
+  // The oldest packets are forgotten first
+  for (uint8_t i = 0; i < DUPLICATE_PACKET_FILTER_SIZE; i++) {
+    uint8_t filler[] = {0xB0, 0xF2, 0xEA, 0x04, 0x02, i, 0x00};
+    TEST_ASSERT_FALSE(filter.isDuplicate(config, filler, sizeof(filler)));
+  }
+  TEST_ASSERT_FALSE(filter.isDuplicate(config, nextPacket, sizeof(nextPacket)));
+}
+
+void test_listen_scheduler_favors_decoded_configs() {
+  NativeClock::reset();
+  ListenScheduler scheduler(std::vector<MiLightRemoteType>{});
+  const size_t busyConfig = &FUT092Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+  size_t picks[MiLightRadioConfig::NUM_CONFIGS] = {0};
+
+  // Nothing heard yet, so every config gets the same share
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    picks[scheduler.next()]++;
+  }
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    TEST_ASSERT_EQUAL_MESSAGE(1, picks[i], "Configs should start out evenly weighted");
+  }
+
+  for (size_t i = 0; i < 100; i++) {
+    scheduler.recordDecoded(busyConfig);
+  }
+  TEST_ASSERT_EQUAL(LISTEN_SCHEDULER_MIN_WEIGHT + LISTEN_SCHEDULER_MAX_WEIGHT, scheduler.getWeight(busyConfig));
+
+  // Every config is still listened with at least once per round of weights
+  const size_t round = LISTEN_SCHEDULER_MAX_WEIGHT + MiLightRadioConfig::NUM_CONFIGS * LISTEN_SCHEDULER_MIN_WEIGHT;
+  memset(picks, 0, sizeof(picks));
+  for (size_t i = 0; i < round; i++) {
+    picks[scheduler.next()]++;
+  }
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    TEST_ASSERT_EQUAL(scheduler.getWeight(i), picks[i]);
+  }
+
+  // Learned weight fades once the remote goes quiet
+  NativeClock::advanceMillis(LISTEN_SCHEDULER_DECAY_INTERVAL);
+  scheduler.next();
+  TEST_ASSERT_EQUAL(LISTEN_SCHEDULER_MIN_WEIGHT + LISTEN_SCHEDULER_MAX_WEIGHT/2, scheduler.getWeight(busyConfig));
+}
+
+void test_listen_scheduler_pinned_remote_types() {
+  ListenScheduler scheduler(std::vector<MiLightRemoteType>{REMOTE_TYPE_RGB_CCT, REMOTE_TYPE_RGBW});
+  const size_t rgbCctConfig = &FUT092Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+  const size_t rgbwConfig = &FUT096Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+
+  for (size_t i = 0; i < 20; i++) {
+    size_t configIx = scheduler.next();
+    TEST_ASSERT_TRUE_MESSAGE(configIx == rgbCctConfig || configIx == rgbwConfig, "Should only listen for pinned remote types");
+  }
+  TEST_ASSERT_EQUAL(0, scheduler.getWeight(&FUT007Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS));
+
+  // Falls back to every config rather than never listening
+  ListenScheduler invalid(std::vector<MiLightRemoteType>{REMOTE_TYPE_UNKNOWN});
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CONFIGS; i++) {
+    TEST_ASSERT_TRUE(invalid.isEnabled(i));
+  }
+}
+
+void test_switchboard_counts_received_packets() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  const MiLightRadioConfig& config = FUT092Config.radioConfig;
+
+  StaticJsonDocument<100> doc;
+  doc["status"] = "ON";
+
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.update(doc.as<JsonObject>());
+  hub.drain();
+
+  // Heard back on all three channels
+  const SimulatedFrame frame = hub.radioFactory->getAirLog().back();
+  std::shared_ptr<SimulatedMiLightRadio> radio = hub.radioFactory->radioFor(config);
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CHANNELS; i++) {
+    radio->inject(frame.data, frame.length);
+  }
+
+  size_t handled = 0;
+  hub.radios.switchListenRadio(&FUT092Config);
+
+  for (size_t i = 0; i < MiLightRadioConfig::NUM_CHANNELS; i++) {
+    if (hub.radios.available()) {
+      uint8_t received[MILIGHT_MAX_PACKET_LENGTH];
+      size_t length = hub.radios.read(received);
+
+      TEST_ASSERT_TRUE(hub.radios.identifyRemote(config, received, length) == &FUT092Config);
+      ++handled;
+    }
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, handled, "Press should only be handled once");
+
+  RadioReceiveStats stats = hub.radios.getReceiveStats(config);
+  TEST_ASSERT_EQUAL_INT(3, stats.received);
+  TEST_ASSERT_EQUAL_INT(2, stats.duplicates);
+  TEST_ASSERT_EQUAL_INT(0, stats.crcErrors);
+  TEST_ASSERT_EQUAL_INT(1, stats.decoded);
+}
+
+void test_spsc_ring_simulated_producer() {
+  SpscRing<uint16_t, 8> ring;
+  uint16_t produced = 0;
+  uint16_t next = 0;
+  size_t consumed = 0;
+  size_t dropped = 0;
+  uint16_t value;
+
+  TEST_ASSERT_FALSE(ring.pop(value));
+
+  // The producer delivers bursts of varying size between consumer runs, like
+  // an interrupt firing several times during a slow loop iteration
+  srand(11);
+  for (size_t round = 0; round < 1000; round++) {
+    size_t burst = rand() % 12;
+    for (size_t i = 0; i < burst; i++) {
+      if (!ring.push(produced)) {
+        ++dropped;
+      }
+      ++produced;
+    }
+
+    size_t budget = rand() % 10;
+    while (budget-- > 0 && ring.pop(value)) {
+      // Nothing is reordered or read twice
+      TEST_ASSERT_TRUE(value >= next);
+      next = value + 1;
+      ++consumed;
+    }
+
+    TEST_ASSERT_TRUE(ring.size() <= 8);
+  }
+
+  while (ring.pop(value)) {
+    ++consumed;
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(dropped > 0, "Test should overflow the ring at some point");
+  TEST_ASSERT_EQUAL_INT(dropped, ring.getOverflowCount());
+  TEST_ASSERT_EQUAL_INT_MESSAGE(produced, consumed + dropped, "Everything not dropped should be consumed");
+  TEST_ASSERT_TRUE(ring.isEmpty());
+}
+
+void test_switchboard_receives_from_interrupt() {
+  NativeClock::reset();
+  const uint8_t pin = 5;
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[1];
+  Settings settings;
+  settings.radioInterruptPin = pin;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> factory = std::make_shared<SimulatedRadioFactory>();
+  RadioSwitchboard radios(factory, &stateStore, settings);
+  std::shared_ptr<SimulatedMiLightRadio> radio = factory->radioFor(config);
+
+  TEST_ASSERT_TRUE(radios.isInterruptDriven());
+  radios.switchRadio(1);
+  radios.listen();
+
+  ReceivedPacket received;
+  TEST_ASSERT_FALSE(radios.readReceived(received));
+
+  // The interrupt handler takes the packet off the radio straight away
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  radio->inject(packet, sizeof(packet));
+  NativeInterrupts::trigger(pin);
+  TEST_ASSERT_FALSE(radio->available());
+
+  TEST_ASSERT_TRUE(radios.readReceived(received));
+  TEST_ASSERT_TRUE(received.config == &config);
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), received.length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, received.packet, sizeof(packet));
+  TEST_ASSERT_FALSE(radios.readReceived(received));
+
+  // Once the main loop uses the radio, the interrupt leaves it alone
+  radios.write(packet, sizeof(packet));
+  packet[5] = 0x01;
+  radio->inject(packet, sizeof(packet));
+  NativeInterrupts::trigger(pin);
+  TEST_ASSERT_FALSE(radios.readReceived(received));
+
+  // ...until it listens again, which picks up what arrived in the meantime
+  radios.listen();
+  TEST_ASSERT_TRUE(radios.readReceived(received));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, received.packet, sizeof(packet));
+  TEST_ASSERT_FALSE(radios.readReceived(received));
+
+  // Packets keep arriving while the main loop is busy.  Once the ring is full
+  // the newest are dropped and counted.
+  for (uint8_t i = 0; i < RADIO_RECEIVE_RING_SIZE + 2; i++) {
+    packet[5] = 0x10 + i;
+    radio->inject(packet, sizeof(packet));
+    NativeInterrupts::trigger(pin);
+  }
+  TEST_ASSERT_EQUAL_INT(2, radios.getReceiveOverflowCount());
+
+  for (uint8_t i = 0; i < RADIO_RECEIVE_RING_SIZE; i++) {
+    TEST_ASSERT_TRUE(radios.readReceived(received));
+    TEST_ASSERT_EQUAL_HEX8(0x10 + i, received.packet[5]);
+  }
+  TEST_ASSERT_FALSE(radios.readReceived(received));
+}
+
+void test_switchboard_routes_to_listen_radio() {
+  const MiLightRadioConfig& sendConfig = MiLightRadioConfig::ALL_CONFIGS[1];
+  const MiLightRadioConfig& listenConfig = MiLightRadioConfig::ALL_CONFIGS[2];
+  Settings settings;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> factory = std::make_shared<SimulatedRadioFactory>(SIMULATED_RADIO_TX_MICROS, true);
+  RadioSwitchboard radios(factory, &stateStore, settings);
+  std::shared_ptr<SimulatedMiLightRadio> listenRadio = factory->listenRadioFor(listenConfig);
+
+  TEST_ASSERT_TRUE(radios.hasListenRadio());
+  radios.switchListenRadio(2);
+  size_t listenConfigures = listenRadio->getConfigureCount();
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  radios.switchRadio(1);
+  radios.write(packet, sizeof(packet));
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, factory->radioFor(sendConfig)->getWriteCount(), "Should send with the send radio");
+  TEST_ASSERT_EQUAL_INT(0, listenRadio->getWriteCount());
+  TEST_ASSERT_EQUAL_INT_MESSAGE(listenConfigures, listenRadio->getConfigureCount(), "Sending should leave the listen radio alone");
+
+  // Only what the listen radio hears is read
+  factory->radioFor(listenConfig)->inject(packet, sizeof(packet));
+  TEST_ASSERT_FALSE(radios.available());
+
+  listenRadio->inject(packet, sizeof(packet));
+  TEST_ASSERT_TRUE(radios.available());
+
+  uint8_t received[MILIGHT_MAX_PACKET_LENGTH];
+  TEST_ASSERT_EQUAL_INT(sizeof(packet), radios.read(received));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, received, sizeof(packet));
+  TEST_ASSERT_TRUE(radios.currentConfig() == &sendConfig);
+}
+
+void test_switchboard_shares_radio_without_listener() {
+  Settings settings;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> factory = std::make_shared<SimulatedRadioFactory>();
+  RadioSwitchboard radios(factory, &stateStore, settings);
+
+  TEST_ASSERT_FALSE(radios.hasListenRadio());
+  radios.switchListenRadio(2);
+  TEST_ASSERT_TRUE_MESSAGE(radios.currentConfig() == &MiLightRadioConfig::ALL_CONFIGS[2], "Listening should switch the only radio");
+
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  factory->radioFor(MiLightRadioConfig::ALL_CONFIGS[2])->inject(packet, sizeof(packet));
+  TEST_ASSERT_TRUE(radios.available());
+}
+
+//================================================================================
+// State cache
+//================================================================================
+
+void test_cache_lru_order() {
+  GroupStateCache cache(3);
+  GroupState s = GroupState::defaultState(REMOTE_TYPE_FUT089);
+
+  for (uint8_t group = 1; group <= 3; group++) {
+    cache.set(BulbId(1, group, REMOTE_TYPE_FUT089), s);
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(cache.isFull(), "Cache should be full");
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, cache.getLru().groupId, "First inserted entry should be LRU");
+
+  // Touching the LRU entry should move it to the front
+  TEST_ASSERT_NOT_NULL(cache.get(BulbId(1, 1, REMOTE_TYPE_FUT089)));
+  TEST_ASSERT_EQUAL_INT_MESSAGE(2, cache.getLru().groupId, "LRU should advance after get");
+  TEST_ASSERT_EQUAL_INT(1, cache.getHead()->id.groupId);
+
+  cache.set(BulbId(1, 4, REMOTE_TYPE_FUT089), s);
+
+  TEST_ASSERT_NULL_MESSAGE(cache.get(BulbId(1, 2, REMOTE_TYPE_FUT089)), "Should evict LRU entry");
+  TEST_ASSERT_NOT_NULL(cache.get(BulbId(1, 1, REMOTE_TYPE_FUT089)));
+  TEST_ASSERT_NOT_NULL(cache.get(BulbId(1, 3, REMOTE_TYPE_FUT089)));
+  TEST_ASSERT_NOT_NULL(cache.get(BulbId(1, 4, REMOTE_TYPE_FUT089)));
+}
+
+// Compare against a plain list under random churn.  Device IDs are chosen so
+// that many of them share a compact ID, which exercises collision handling.
+void test_cache_matches_reference() {
+  const size_t cacheSize = 20;
+  GroupStateCache cache(cacheSize);
+  std::list<uint32_t> reference;
+  GroupState s = GroupState::defaultState(REMOTE_TYPE_RGB_CCT);
+
+  srand(1);
+
+  for (size_t i = 0; i < 5000; i++) {
+    uint16_t deviceId = (rand() % 4) << 8 | (rand() % 4);
+    uint8_t groupId = rand() % 5;
+    BulbId id(deviceId, groupId, REMOTE_TYPE_RGB_CCT);
+    uint32_t key = (deviceId << 8) | groupId;
+
+    std::list<uint32_t>::iterator it = std::find(reference.begin(), reference.end(), key);
+    bool expectPresent = it != reference.end();
+
+    if (rand() % 2) {
+      GroupState* state = cache.get(id);
+      TEST_ASSERT_EQUAL_INT_MESSAGE(expectPresent, state != NULL, "get() should agree with reference");
+
+      if (expectPresent) {
+        reference.erase(it);
+        reference.push_front(key);
+      }
+    } else {
+      s.setBrightness(i % 100);
+      GroupState* state = cache.set(id, s);
+      TEST_ASSERT_EQUAL_INT(i % 100, state->getBrightness());
+
+      if (expectPresent) {
+        reference.erase(it);
+      } else if (reference.size() >= cacheSize) {
+        reference.pop_back();
+      }
+      reference.push_front(key);
+    }
+
+    if (!reference.empty()) {
+      BulbId lru = cache.getLru();
+      TEST_ASSERT_EQUAL_INT_MESSAGE(reference.back(), (lru.deviceId << 8) | lru.groupId, "LRU should agree with reference");
+    }
+  }
+}
+
+// Once every slot has been used, inserting new bulbs should only recycle nodes
+void test_cache_churn_does_not_allocate() {
+  GroupStateCache cache(10);
+  GroupState s = GroupState::defaultState(REMOTE_TYPE_RGB_CCT);
+
+  for (uint8_t group = 0; group < 10; group++) {
+    cache.set(BulbId(1, group, REMOTE_TYPE_RGB_CCT), s);
+  }
+
+  size_t allocations = NativeHeap::allocationCount();
+
+  for (size_t i = 0; i < 1000; i++) {
+    BulbId id(i % 3, i % 17, REMOTE_TYPE_RGB_CCT);
+
+    if (cache.get(id) == NULL) {
+      cache.set(id, s);
+    }
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(allocations, NativeHeap::allocationCount(), "Cache churn should not allocate");
+}
+
+void test_store_cached_updates_do_not_allocate() {
+  GroupStateStore store(10, 0);
+  GroupState s = GroupState::defaultState(REMOTE_TYPE_FUT089);
+
+  // Group 0 fans out to all 8 groups, so this warms up all 9 entries
+  store.set(BulbId(1, 0, REMOTE_TYPE_FUT089), s);
+
+  size_t allocations = NativeHeap::allocationCount();
+
+  for (size_t i = 0; i < 1000; i++) {
+    BulbId id(1, i % 9, REMOTE_TYPE_FUT089);
+
+    s.setBrightness(i % 100);
+    store.set(id, s);
+    TEST_ASSERT_EQUAL_INT(i % 100, store.get(id)->getBrightness());
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(allocations, NativeHeap::allocationCount(), "Updates to cached bulbs should not allocate");
+}
+
+//================================================================================
+// State persistence
+//================================================================================
+
+static GroupState stateWithBrightness(uint8_t brightness) {
+  GroupState state = GroupState::defaultState(REMOTE_TYPE_FUT089);
+  state.setBrightness(brightness);
+  return state;
+}
+
+void test_journal_round_trip() {
+  SPIFFS.format();
+
+  {
+    GroupStatePersistence persistence;
+
+    for (uint8_t group = 1; group <= 8; group++) {
+      persistence.set(BulbId(1, group, REMOTE_TYPE_FUT089), stateWithBrightness(group * 10));
+    }
+    persistence.clear(BulbId(1, 8, REMOTE_TYPE_FUT089));
+
+    // Buffered records should be readable before they're committed
+    GroupState state;
+    persistence.get(BulbId(1, 3, REMOTE_TYPE_FUT089), state);
+    TEST_ASSERT_EQUAL_INT(30, state.getBrightness());
+
+    TEST_ASSERT_TRUE(persistence.commit());
+  }
+
+  GroupStatePersistence reloaded;
+  TEST_ASSERT_EQUAL_INT_MESSAGE(7, reloaded.getLiveCount(), "Index should be rebuilt from the journal");
+
+  for (uint8_t group = 1; group <= 7; group++) {
+    GroupState state;
+    reloaded.get(BulbId(1, group, REMOTE_TYPE_FUT089), state);
+    TEST_ASSERT_EQUAL_INT(group * 10, state.getBrightness());
+  }
+
+  GroupState cleared = stateWithBrightness(1);
+  reloaded.get(BulbId(1, 8, REMOTE_TYPE_FUT089), cleared);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, cleared.getBrightness(), "Cleared state should not be loaded");
+}
+
+void test_journal_compaction() {
+  SPIFFS.format();
+  GroupStatePersistence persistence;
+  BulbId ids[] = { BulbId(1, 1, REMOTE_TYPE_FUT089), BulbId(2, 1, REMOTE_TYPE_FUT089) };
+
+  for (size_t i = 0; i < 1000; i++) {
+    persistence.set(ids[i % 2], stateWithBrightness(i % 100));
+    persistence.commit();
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(
+    persistence.getRecordCount() <= 2 * 2 + STATE_JOURNAL_COMPACT_SLACK,
+    "Journal should be compacted"
+  );
+  TEST_ASSERT_FALSE(SPIFFS.exists("group_states.tmp"));
+
+  GroupStatePersistence reloaded;
+  GroupState state;
+
+  reloaded.get(ids[0], state);
+  TEST_ASSERT_EQUAL_INT(98, state.getBrightness());
+  reloaded.get(ids[1], state);
+  TEST_ASSERT_EQUAL_INT(99, state.getBrightness());
+}
+
+void test_journal_ignores_torn_record() {
+  SPIFFS.format();
+
+  {
+    GroupStatePersistence persistence;
+    persistence.set(BulbId(1, 1, REMOTE_TYPE_FUT089), stateWithBrightness(42));
+    persistence.commit();
+  }
+
+  // Simulate losing power halfway through an append
+  File f = SPIFFS.open("group_states.log", "a");
+  f.write(reinterpret_cast<const uint8_t*>("\x01\x02\x03\x04\x05"), 5);
+  f.close();
+
+  {
+    GroupStatePersistence persistence;
+    GroupState state;
+
+    persistence.get(BulbId(1, 1, REMOTE_TYPE_FUT089), state);
+    TEST_ASSERT_EQUAL_INT(42, state.getBrightness());
+
+    persistence.set(BulbId(1, 2, REMOTE_TYPE_FUT089), stateWithBrightness(43));
+    persistence.commit();
+  }
+
+  GroupStatePersistence reloaded;
+  GroupState state;
+  TEST_ASSERT_EQUAL_INT(2, reloaded.getLiveCount());
+  reloaded.get(BulbId(1, 2, REMOTE_TYPE_FUT089), state);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(43, state.getBrightness(), "Appends after a torn record should survive reload");
+}
+
+void test_journal_compaction_needs_room_for_new_journal() {
+  SPIFFS.format();
+  GroupStatePersistence persistence;
+
+  for (uint8_t group = 1; group <= 8; group++) {
+    persistence.set(BulbId(1, group, REMOTE_TYPE_FUT089), stateWithBrightness(group));
+  }
+  persistence.commit();
+
+  // Compaction starts at 2 * 8 + SLACK records, and needs room for the 8 live
+  // ones alongside the old journal.  Leave a little less than that.
+  const size_t threshold = 2 * 8 + STATE_JOURNAL_COMPACT_SLACK;
+  const size_t fullJournal = 4 + threshold * sizeof(JournalRecord);
+  SPIFFS.setCapacity(fullJournal + 4 + 8 * sizeof(JournalRecord) - 1);
+
+  for (size_t i = 8; i < threshold; i++) {
+    persistence.set(BulbId(1, 1 + i % 8, REMOTE_TYPE_FUT089), stateWithBrightness(i));
+    TEST_ASSERT_TRUE(persistence.commit());
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(threshold, persistence.getRecordCount(), "Compaction should have failed");
+  TEST_ASSERT_FALSE_MESSAGE(SPIFFS.exists("group_states.tmp"), "Partial journal should be removed");
+
+  {
+    GroupStatePersistence reloaded;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(8, reloaded.getLiveCount(), "Old journal should be kept");
+
+    for (size_t i = threshold - 8; i < threshold; i++) {
+      GroupState state;
+      reloaded.get(BulbId(1, 1 + i % 8, REMOTE_TYPE_FUT089), state);
+      TEST_ASSERT_EQUAL_INT(i, state.getBrightness());
+    }
+  }
+
+  // With room to spare, the next commit compacts
+  SPIFFS.setCapacity(0);
+  persistence.set(BulbId(1, 1, REMOTE_TYPE_FUT089), stateWithBrightness(99));
+  TEST_ASSERT_TRUE(persistence.commit());
+  TEST_ASSERT_EQUAL_INT(8, persistence.getRecordCount());
+}
+
+void test_journal_recovers_from_short_append() {
+  SPIFFS.format();
+  GroupStatePersistence persistence;
+
+  persistence.set(BulbId(1, 1, REMOTE_TYPE_FUT089), stateWithBrightness(41));
+  TEST_ASSERT_TRUE(persistence.commit());
+
+  // Room for only part of the next append
+  SPIFFS.setCapacity(4 + sizeof(JournalRecord) + 8);
+  persistence.set(BulbId(1, 2, REMOTE_TYPE_FUT089), stateWithBrightness(42));
+  persistence.set(BulbId(1, 3, REMOTE_TYPE_FUT089), stateWithBrightness(43));
+  TEST_ASSERT_FALSE(persistence.commit());
+
+  SPIFFS.setCapacity(0);
+  TEST_ASSERT_TRUE(persistence.commit());
+  persistence.set(BulbId(1, 4, REMOTE_TYPE_FUT089), stateWithBrightness(44));
+  TEST_ASSERT_TRUE(persistence.commit());
+
+  GroupState state;
+  persistence.get(BulbId(1, 4, REMOTE_TYPE_FUT089), state);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(44, state.getBrightness(), "Records after a short append should be at the right offset");
+
+  GroupStatePersistence reloaded;
+  TEST_ASSERT_EQUAL_INT(4, reloaded.getLiveCount());
+
+  for (uint8_t group = 1; group <= 4; group++) {
+    reloaded.get(BulbId(1, group, REMOTE_TYPE_FUT089), state);
+    TEST_ASSERT_EQUAL_INT(40 + group, state.getBrightness());
+  }
+}
+
+void test_journal_migrates_legacy_files() {
+  SPIFFS.format();
+  BulbId id(0x10, 3, REMOTE_TYPE_FUT089);
+  char path[30];
+
+  sprintf(path, "group_states/%x", id.getCompactId());
+  File f = SPIFFS.open(path, "w");
+  stateWithBrightness(77).dump(f);
+  f.close();
+
+  GroupStatePersistence persistence;
+  GroupState state;
+
+  persistence.get(id, state);
+  TEST_ASSERT_EQUAL_INT(77, state.getBrightness());
+  TEST_ASSERT_FALSE_MESSAGE(SPIFFS.exists(path), "Legacy file should be removed");
+}
+
+void test_store_flush_is_one_append() {
+  SPIFFS.format();
+  GroupStateStore store(10, 0);
+
+  for (uint8_t group = 1; group <= 8; group++) {
+    store.set(BulbId(1, group, REMOTE_TYPE_FUT089), stateWithBrightness(group));
+  }
+
+  // Warm up (creates the journal)
+  store.flush();
+
+  for (uint8_t group = 1; group <= 8; group++) {
+    store.set(BulbId(1, group, REMOTE_TYPE_FUT089), stateWithBrightness(group + 50));
+  }
+
+  SPIFFS.resetStats();
+  TEST_ASSERT_TRUE(store.flush());
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, SPIFFS.getStats().writeOpens, "Dirty states should be written in one append");
+  TEST_ASSERT_FALSE(store.flush());
+
+  GroupStatePersistence reloaded;
+  GroupState state;
+  reloaded.get(BulbId(1, 5, REMOTE_TYPE_FUT089), state);
+  TEST_ASSERT_EQUAL_INT(55, state.getBrightness());
+}
+
+// An "all off" across many groups should reach flash within a few loop
+// iterations, without any one iteration writing more than the budget.
+void test_store_limited_flush_respects_budget() {
+  SPIFFS.format();
+  NativeClock::reset();
+  GroupStateStore store(40, 1000, 4 * sizeof(JournalRecord));
+
+  for (uint16_t deviceId = 1; deviceId <= 30; deviceId++) {
+    store.set(BulbId(deviceId, 1, REMOTE_TYPE_RGB_CCT), GroupState::defaultState(REMOTE_TYPE_RGB_CCT));
+  }
+  store.flush();
+
+  for (uint16_t deviceId = 1; deviceId <= 30; deviceId++) {
+    GroupState off;
+    off.setState(MiLightStatus::OFF);
+    store.set(BulbId(deviceId, 1, REMOTE_TYPE_RGB_CCT), off);
+  }
+
+  size_t backlog = store.flushBacklog();
+  TEST_ASSERT_TRUE(backlog >= 30);
+
+  // Nothing happens until the flush interval has passed
+  store.limitedFlush();
+  TEST_ASSERT_EQUAL_INT(backlog, store.flushBacklog());
+
+  NativeClock::advanceMillis(1001);
+  size_t iterations = 0;
+
+  while (store.flushBacklog() > 0 && iterations++ < 100) {
+    size_t before = store.flushBacklog();
+    store.limitedFlush();
+    TEST_ASSERT_TRUE_MESSAGE(before - store.flushBacklog() <= 4, "Each loop should stay within the byte budget");
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE((backlog + 3) / 4, iterations, "Backlog should drain on consecutive loops");
+
+  GroupStatePersistence reloaded;
+  GroupState state;
+  reloaded.get(BulbId(30, 1, REMOTE_TYPE_RGB_CCT), state);
+  TEST_ASSERT_EQUAL_INT(MiLightStatus::OFF, state.getState());
+}
+
+//================================================================================
+// V2 encoding
+//================================================================================
+
+// The V2 encoding as it was before the lookup tables, for comparison
+static const uint8_t REFERENCE_V2_OFFSETS[][4] = {
+  { 0x45, 0x1F, 0x14, 0x5C },
+  { 0x2B, 0xC9, 0xE3, 0x11 },
+  { 0x6D, 0x5F, 0x8A, 0x2B },
+  { 0xAF, 0x03, 0x1D, 0xF3 },
+  { 0x1A, 0xE2, 0xF0, 0xD1 },
+  { 0x04, 0xD8, 0x71, 0x42 },
+  { 0xAF, 0x04, 0xDD, 0x07 },
+  { 0x61, 0x13, 0x38, 0x64 }
+};
+
+static uint8_t referenceV2Offset(size_t byte, uint8_t key, uint8_t jumpStart) {
+  return REFERENCE_V2_OFFSETS[byte - 1][key % 4]
+    + ((jumpStart > 0 && key >= jumpStart && key < jumpStart + 0x80) ? 0x80 : 0);
+}
+
+static uint8_t referenceXorKey(uint8_t key) {
+  const uint8_t shift = (key & 0x0F) < 0x04 ? 0 : 1;
+  const uint8_t x = (((key & 0xF0) >> 4) + shift + 6) % 8;
+  const uint8_t msn = (((4 + x) ^ 1) & 0x0F) << 4;
+  const uint8_t lsn = ((((key & 0xF) + 4)^2) & 0x0F);
+
+  return ( msn | lsn );
+}
+
+static void referenceEncodeV2Packet(uint8_t* packet) {
+  uint8_t key = referenceXorKey(packet[0]);
+  uint8_t sum = key;
+
+  for (size_t i = 1; i <= 7; i++) {
+    sum += packet[i];
+    packet[i] = V2RFEncoding::encodeByte(packet[i], 0, key, referenceV2Offset(i, packet[0], V2_OFFSET_JUMP_START));
+  }
+
+  packet[8] = V2RFEncoding::encodeByte(sum, 2, key, referenceV2Offset(8, packet[0], 0));
+}
+
+static void referenceDecodeV2Packet(uint8_t* packet) {
+  uint8_t key = referenceXorKey(packet[0]);
+
+  for (size_t i = 1; i <= 8; i++) {
+    packet[i] = V2RFEncoding::decodeByte(packet[i], 0, key, referenceV2Offset(i, packet[0], V2_OFFSET_JUMP_START));
+  }
+}
+
+void test_v2_encoding_matches_reference() {
+  uint32_t seed = 1;
+
+  for (size_t key = 0; key < 256; key++) {
+    TEST_ASSERT_EQUAL_HEX8(referenceXorKey(key), V2RFEncoding::xorKey(key));
+
+    for (size_t i = 0; i < 64; i++) {
+      uint8_t packet[V2_PACKET_LEN];
+      uint8_t expected[V2_PACKET_LEN];
+
+      packet[0] = key;
+      for (size_t j = 1; j < V2_PACKET_LEN; j++) {
+        seed = seed * 1103515245 + 12345;
+        packet[j] = seed >> 16;
+      }
+      memcpy(expected, packet, V2_PACKET_LEN);
+
+      // Decoding arbitrary bytes, as happens for every received packet
+      referenceDecodeV2Packet(expected);
+      V2RFEncoding::decodeV2Packet(packet);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, packet, V2_PACKET_LEN);
+
+      referenceEncodeV2Packet(expected);
+      V2RFEncoding::encodeV2Packet(packet);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, packet, V2_PACKET_LEN);
+
+      // Round trip, ignoring the checksum
+      V2RFEncoding::decodeV2Packet(packet);
+      referenceDecodeV2Packet(expected);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, packet, V2_PACKET_LEN - 1);
+    }
+  }
+}
+
+void test_v2_encoding_whole_stream() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  PacketFormatter* formatter = FUT092Config.packetFormatter;
+
+  formatter->prepare(0x1234, 2);
+  formatter->updateBrightness(10);
+  formatter->updateHue(20);
+  formatter->updateStatus(ON, 2);
+  PacketStream& stream = formatter->buildPackets();
+
+  TEST_ASSERT_TRUE(stream.numPackets > 1);
+  for (uint8_t sequence = 0; stream.hasNext(); sequence++) {
+    uint8_t* packet = stream.next();
+    V2RFEncoding::decodeV2Packet(packet);
+
+    TEST_ASSERT_EQUAL_HEX8(0x12, packet[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, packet[3]);
+    TEST_ASSERT_EQUAL_HEX8(2, packet[7]);
+    if (sequence > 0) {
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(static_cast<uint8_t>(packet[6 - V2_PACKET_LEN] + 1), packet[6], "Sequence numbers should be consecutive");
+    }
+  }
+
+  formatter->reset();
+}
+
+//================================================================================
+// Packet queue
+//================================================================================
+
+static void pushPacket(PacketQueue& queue, uint8_t marker) {
+  uint8_t packet[MILIGHT_MAX_PACKET_LENGTH] = { marker };
+  queue.push(packet, &FUT092Config, 0);
+}
+
+void test_packet_queue_keeps_popped_slots_until_released() {
+  PacketQueue queue;
+  size_t popped[MILIGHT_MAX_INTERLEAVED_PACKETS];
+
+  TEST_ASSERT_EQUAL_INT(PacketQueue::NO_PACKET, queue.pop());
+
+  for (size_t i = 0; i < MILIGHT_MAX_INTERLEAVED_PACKETS; i++) {
+    pushPacket(queue, 0xA0 + i);
+    popped[i] = queue.pop();
+  }
+  TEST_ASSERT_TRUE(queue.isEmpty());
+
+  // Filling the queue should leave the packets being sent untouched
+  for (size_t i = 0; i < MILIGHT_MAX_QUEUED_PACKETS; i++) {
+    pushPacket(queue, i);
+  }
+
+  TEST_ASSERT_EQUAL_INT(MILIGHT_MAX_QUEUED_PACKETS, queue.size());
+  TEST_ASSERT_EQUAL_INT(0, queue.getDroppedPacketCount());
+
+  // Once full, the newest packet is replaced
+  pushPacket(queue, 0xBB);
+  TEST_ASSERT_EQUAL_INT(MILIGHT_MAX_QUEUED_PACKETS, queue.size());
+  TEST_ASSERT_EQUAL_INT(1, queue.getDroppedPacketCount());
+
+  for (size_t i = 0; i < MILIGHT_MAX_INTERLEAVED_PACKETS; i++) {
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0xA0 + i, queue.get(popped[i]).packet[0], "Popped slot should not be reused");
+    queue.release(popped[i]);
+  }
+
+  // Taking a packet from the middle keeps the rest in order
+  TEST_ASSERT_EQUAL_INT(2, queue.get(queue.popAt(2)).packet[0]);
+
+  for (size_t i = 0; i < MILIGHT_MAX_QUEUED_PACKETS; i++) {
+    if (i == 2) {
+      continue;
+    }
+
+    uint8_t expected = i == MILIGHT_MAX_QUEUED_PACKETS - 1 ? 0xBB : i;
+    size_t slot = queue.pop();
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected, queue.get(slot).packet[0], "Packets should come out in order");
+    queue.release(slot);
+  }
+
+  TEST_ASSERT_TRUE(queue.isEmpty());
+}
+
+// No sent handler here, since parsing sent packets into JSON is a separate cost
+void test_packet_sender_does_not_allocate() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  PacketSender sender(hub.radios, hub.settings, nullptr);
+  uint8_t packet[MILIGHT_MAX_PACKET_LENGTH] = { 0 };
+
+  // Warm up the radio and its air log
+  sender.enqueue(packet, &FUT092Config);
+  while (sender.isSending()) {
+    sender.loop();
+  }
+  hub.radioFactory->clearAirLog();
+
+  size_t allocations = NativeHeap::allocationCount();
+
+  for (size_t i = 0; i < MILIGHT_MAX_QUEUED_PACKETS; i++) {
+    sender.enqueue(packet, &FUT092Config, 1);
+  }
+  while (sender.isSending()) {
+    sender.loop();
+  }
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(allocations, NativeHeap::allocationCount(), "Sending queued packets should not allocate");
+}
+
+void test_packet_formatters_classify_commands() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  hub.settings.packetRepeats = 1;
+
+  struct Case {
+    const MiLightRemoteConfig* config;
+    bool brightness;
+    PacketCommandClass expected;
+    uint8_t expectedGroup;
+  };
+
+  const Case cases[] = {
+    { &FUT092Config, true,  PacketCommandClass::BRIGHTNESS, 1 },
+    { &FUT092Config, false, PacketCommandClass::HUE, 1 },
+    { &FUT089Config, true,  PacketCommandClass::BRIGHTNESS, 1 },
+    { &FUT089Config, false, PacketCommandClass::HUE, 1 },
+    { &FUT091Config, true,  PacketCommandClass::BRIGHTNESS, 1 },
+    { &FUT096Config, true,  PacketCommandClass::BRIGHTNESS, 1 },
+    { &FUT096Config, false, PacketCommandClass::HUE, 1 },
+    { &FUT098Config, false, PacketCommandClass::HUE, 0 },
+    { &FUT020Config, false, PacketCommandClass::HUE, 0 },
+    // Brightness for these is sent as up/down steps, which can't be replaced
+    { &FUT007Config, true,  PacketCommandClass::NONE, 1 },
+    { &FUT098Config, true,  PacketCommandClass::NONE, 0 },
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    const Case& c = cases[i];
+    hub.client.prepare(c.config, 0x1234, 1);
+    hub.radioFactory->clearAirLog();
+
+    if (c.brightness) {
+      hub.client.updateBrightness(50);
+    } else {
+      hub.client.updateHue(120);
+    }
+    hub.drain();
+
+    const SimulatedAirLog& log = hub.radioFactory->getAirLog();
+    TEST_ASSERT_TRUE(log.size() > 0);
+
+    BulbId bulbId;
+    PacketCommandClass commandClass = c.config->packetFormatter->classifyPacket(log.back().data, bulbId);
+
+    TEST_ASSERT_TRUE_MESSAGE(commandClass == c.expected, c.config->name.c_str());
+    TEST_ASSERT_EQUAL_INT(0x1234, bulbId.deviceId);
+    TEST_ASSERT_EQUAL_INT(c.expectedGroup, bulbId.groupId);
+    TEST_ASSERT_TRUE(bulbId.deviceType == c.config->type);
+  }
+}
+
+void test_packet_sender_coalesces_stale_values() {
+  NativeClock::reset();
+  SimulatedHub hub;
+
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.updateBrightness(10);
+  hub.client.updateBrightness(20);
+  hub.client.updateBrightness(30);
+
+  TEST_ASSERT_EQUAL_INT(1, hub.packetSender.queueLength());
+  TEST_ASSERT_EQUAL_INT(2, hub.packetSender.coalescedPackets());
+
+  // Another group doesn't replace anything, and brightness for group 1 can't
+  // jump ahead of it
+  hub.client.prepare(&FUT092Config, 0x1234, 2);
+  hub.client.updateBrightness(40);
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.updateBrightness(50);
+
+  TEST_ASSERT_EQUAL_INT(3, hub.packetSender.queueLength());
+  TEST_ASSERT_EQUAL_INT(2, hub.packetSender.coalescedPackets());
+
+  hub.drain();
+  TEST_ASSERT_EQUAL_INT(50, hub.stateStore.get(BulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT))->getBrightness());
+  TEST_ASSERT_EQUAL_INT(40, hub.stateStore.get(BulbId(0x1234, 2, REMOTE_TYPE_RGB_CCT))->getBrightness());
+}
+
+void test_packet_sender_coalescing_keeps_order() {
+  NativeClock::reset();
+  SimulatedHub hub;
+
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.updateBrightness(10);
+  hub.client.updateHue(100);
+  hub.client.updateBrightness(20);
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(3, hub.packetSender.queueLength(), "Should not replace across a different command");
+  TEST_ASSERT_EQUAL_INT(0, hub.packetSender.coalescedPackets());
+
+  hub.settings.enablePacketCoalescing = false;
+  hub.client.updateBrightness(30);
+  TEST_ASSERT_EQUAL_INT(4, hub.packetSender.queueLength());
+}
+
+// Index of the first frame on air for the given bulb, or the log size if none
+static size_t firstFrameFor(const SimulatedAirLog& log, uint16_t deviceId, uint8_t groupId) {
+  for (size_t i = 0; i < log.size(); i++) {
+    BulbId bulbId;
+    FUT092Config.packetFormatter->classifyPacket(log[i].data, bulbId);
+
+    if (bulbId.deviceId == deviceId && bulbId.groupId == groupId) {
+      return i;
+    }
+  }
+  return log.size();
+}
+
+static size_t lastFrameFor(const SimulatedAirLog& log, uint16_t deviceId, uint8_t groupId) {
+  size_t last = log.size();
+  for (size_t i = 0; i < log.size(); i++) {
+    BulbId bulbId;
+    FUT092Config.packetFormatter->classifyPacket(log[i].data, bulbId);
+
+    if (bulbId.deviceId == deviceId && bulbId.groupId == groupId) {
+      last = i;
+    }
+  }
+  return last;
+}
+
+void test_packet_sender_interleaves_repeats() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  hub.settings.interleavePacketRepeats = true;
+  hub.radioFactory->clearAirLog();
+
+  for (uint16_t deviceId = 0x1001; deviceId <= 0x1004; deviceId++) {
+    hub.client.prepare(&FUT092Config, deviceId, 1);
+    hub.client.updateStatus(ON);
+  }
+  hub.drain();
+
+  const SimulatedAirLog& log = hub.radioFactory->getAirLog();
+  TEST_ASSERT_EQUAL_INT(4 * hub.settings.packetRepeats, log.size());
+
+  // Each command gets its first burst before any command gets a second one
+  for (uint16_t i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT(i * hub.settings.packetRepeatsPerLoop, firstFrameFor(log, 0x1001 + i, 1));
+  }
+
+  TEST_ASSERT_EQUAL_INT(4, hub.packetsSent);
+  TEST_ASSERT_EQUAL_INT(ON, hub.stateStore.get(BulbId(0x1004, 1, REMOTE_TYPE_RGB_CCT))->getState());
+}
+
+void test_packet_sender_interleaving_keeps_bulb_order() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  hub.settings.interleavePacketRepeats = true;
+  hub.radioFactory->clearAirLog();
+
+  // Group 0 overlaps every other group, so nothing for the same remote can be
+  // interleaved with it.  Another remote can.
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.updateStatus(ON);
+  hub.client.prepare(&FUT092Config, 0x1234, 0);
+  hub.client.updateStatus(OFF);
+  hub.client.prepare(&FUT092Config, 0x1234, 2);
+  hub.client.updateStatus(ON);
+  hub.client.prepare(&FUT092Config, 0x5678, 2);
+  hub.client.updateStatus(ON);
+  hub.drain();
+
+  const SimulatedAirLog& log = hub.radioFactory->getAirLog();
+
+  TEST_ASSERT_TRUE(lastFrameFor(log, 0x1234, 1) < firstFrameFor(log, 0x1234, 0));
+  TEST_ASSERT_TRUE(lastFrameFor(log, 0x1234, 0) < firstFrameFor(log, 0x1234, 2));
+  TEST_ASSERT_TRUE_MESSAGE(firstFrameFor(log, 0x5678, 2) < lastFrameFor(log, 0x1234, 2), "Another remote should be interleaved");
+
+  // Packets for other radio configs wait for the active ones to finish
+  hub.radioFactory->clearAirLog();
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.updateStatus(ON);
+  hub.client.prepare(&FUT096Config, 0x1234, 1);
+  hub.client.updateStatus(ON);
+  hub.drain();
+
+  TEST_ASSERT_EQUAL_INT(2 * hub.settings.packetRepeats, log.size());
+  TEST_ASSERT_TRUE(log[hub.settings.packetRepeats - 1].config == &FUT092Config.radioConfig);
+  TEST_ASSERT_TRUE(log[hub.settings.packetRepeats].config == &FUT096Config.radioConfig);
+}
+
+static void queueOn(SimulatedHub& hub, const MiLightRemoteConfig* config, uint16_t deviceId) {
+  hub.client.prepare(config, deviceId, 1);
+  hub.client.updateStatus(ON);
+}
+
+void test_packet_sender_batches_radio_configs() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  hub.settings.packetReorderWindow = 1000;
+  const size_t repeats = hub.settings.packetRepeats;
+
+  hub.radios.switchRadio(&FUT092Config);
+  size_t reconfigurations = hub.radios.getReconfigurationCount();
+
+  queueOn(hub, &FUT096Config, 0x1111);
+  queueOn(hub, &FUT092Config, 0x2222);
+  queueOn(hub, &FUT096Config, 0x3333);
+  queueOn(hub, &FUT092Config, 0x4444);
+  hub.radioFactory->clearAirLog();
+  hub.drain();
+
+  const SimulatedAirLog& log = hub.radioFactory->getAirLog();
+  const MiLightRadioConfig* expected[] = {
+    &FUT092Config.radioConfig, &FUT092Config.radioConfig, &FUT096Config.radioConfig, &FUT096Config.radioConfig
+  };
+
+  TEST_ASSERT_EQUAL_INT(4 * repeats, log.size());
+  for (size_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(log[i * repeats].config == expected[i]);
+  }
+  TEST_ASSERT_EQUAL_INT(1, hub.radios.getReconfigurationCount() - reconfigurations);
+
+  // Without a window, packets go out in the order they were queued
+  hub.settings.packetReorderWindow = 0;
+  hub.radios.switchRadio(&FUT092Config);
+  reconfigurations = hub.radios.getReconfigurationCount();
+
+  queueOn(hub, &FUT096Config, 0x1111);
+  queueOn(hub, &FUT092Config, 0x2222);
+  queueOn(hub, &FUT096Config, 0x3333);
+  queueOn(hub, &FUT092Config, 0x4444);
+  hub.radioFactory->clearAirLog();
+  hub.drain();
+
+  TEST_ASSERT_TRUE(log[0].config == &FUT096Config.radioConfig);
+  TEST_ASSERT_TRUE(log[repeats].config == &FUT092Config.radioConfig);
+  TEST_ASSERT_EQUAL_INT(4, hub.radios.getReconfigurationCount() - reconfigurations);
+}
+
+void test_packet_sender_reorder_window_is_bounded() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  hub.settings.packetReorderWindow = 100;
+  hub.radios.switchRadio(&FUT092Config);
+
+  // Each packet takes about 45ms to send with 50 repeats, so the FUT096 packet
+  // can be held back behind two or three others but no more
+  queueOn(hub, &FUT096Config, 0x1111);
+  for (uint16_t i = 0; i < 6; i++) {
+    queueOn(hub, &FUT092Config, 0x2000 + i);
+  }
+
+  unsigned long start = micros();
+  hub.radioFactory->clearAirLog();
+  hub.drain();
+
+  const SimulatedAirLog& log = hub.radioFactory->getAirLog();
+  size_t first = 0;
+  while (first < log.size() && log[first].config != &FUT096Config.radioConfig) {
+    ++first;
+  }
+
+  TEST_ASSERT_TRUE(first > 0 && first < log.size());
+  TEST_ASSERT_TRUE_MESSAGE(
+    log[first].timestamp - start <= 1000UL * hub.settings.packetReorderWindow + hub.settings.packetRepeats * SIMULATED_RADIO_TX_MICROS,
+    "Packet should not be held back for much longer than the reorder window"
+  );
+
+  // Once it's been sent, the other packets still go out in order
+  for (uint16_t i = 0; i < 6; i++) {
+    BulbId bulbId;
+    size_t frame = i * hub.settings.packetRepeats + (first <= i * hub.settings.packetRepeats ? hub.settings.packetRepeats : 0);
+    FUT092Config.packetFormatter->classifyPacket(log[frame].data, bulbId);
+    TEST_ASSERT_EQUAL_INT(0x2000 + i, bulbId.deviceId);
+  }
+}
+
+//================================================================================
+// Packet pipeline
+//================================================================================
+
+void test_client_update_reaches_radio() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  hub.radioFactory->clearAirLog();
+
+  StaticJsonDocument<100> doc;
+  doc["status"] = "ON";
+
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.update(doc.as<JsonObject>());
+  hub.drain();
+
+  const SimulatedAirLog& log = hub.radioFactory->getAirLog();
+
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, hub.packetsSent, "Should fire sent handler once per packet");
+  TEST_ASSERT_EQUAL_INT_MESSAGE(hub.settings.packetRepeats, log.size(), "Should send every repeat");
+
+  for (size_t i = 0; i < log.size(); i++) {
+    TEST_ASSERT_TRUE_MESSAGE(log[i].config == &FUT092Config.radioConfig, "Should send on the rgb_cct radio");
+    TEST_ASSERT_EQUAL_INT(FUT092Config.packetFormatter->getPacketLength(), log[i].length);
+
+    if (i > 0) {
+      TEST_ASSERT_TRUE_MESSAGE(log[i].timestamp > log[i - 1].timestamp, "Frame timestamps should increase");
+    }
+  }
+}
+
+void test_client_update_updates_state() {
+  SimulatedHub hub;
+
+  StaticJsonDocument<100> doc;
+  doc["status"] = "ON";
+  doc["brightness"] = 255;
+
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  hub.client.update(doc.as<JsonObject>());
+  hub.drain();
+
+  GroupState* state = hub.stateStore.get(BulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT));
+
+  TEST_ASSERT_NOT_NULL(state);
+  TEST_ASSERT_EQUAL_INT(ON, state->getState());
+  TEST_ASSERT_EQUAL_INT(100, state->getBrightness());
+}
+
+// Field each distinct packet on air sets, in the order they were sent
+static std::vector<std::string> fieldsOnAir(const SimulatedAirLog& log) {
+  std::vector<std::string> fields;
+
+  for (size_t i = 0; i < log.size(); i++) {
+    if (i > 0 && memcmp(log[i].data, log[i - 1].data, log[i].length) == 0) {
+      continue;
+    }
+
+    StaticJsonDocument<200> doc;
+    JsonObject result = doc.to<JsonObject>();
+    FUT092Config.packetFormatter->parsePacket(log[i].data, result);
+
+    for (JsonPair kv : result) {
+      const char* key = kv.key().c_str();
+
+      if (strcmp(key, GroupStateFieldNames::DEVICE_ID) != 0
+        && strcmp(key, GroupStateFieldNames::GROUP_ID) != 0
+        && strcmp(key, GroupStateFieldNames::DEVICE_TYPE) != 0) {
+        fields.push_back(key);
+        break;
+      }
+    }
+  }
+
+  return fields;
+}
+
+// update() finds keys with a binary search over them
+void test_update_keys_are_sorted() {
+  TEST_ASSERT_TRUE(MiLightClient::getNumUpdateKeys() > 1);
+
+  for (size_t i = 1; i < MiLightClient::getNumUpdateKeys(); i++) {
+    const char* previous = MiLightClient::getUpdateKey(i - 1);
+    const char* key = MiLightClient::getUpdateKey(i);
+
+    TEST_ASSERT_TRUE_MESSAGE(strcmp(previous, key) < 0, key);
+  }
+}
+
+void test_client_update_applies_fields_in_order() {
+  NativeClock::reset();
+  SimulatedHub hub;
+
+  // Status first and off last, mode before brightness, however the request
+  // orders them.  Unknown keys are ignored.
+  const char* requests[] = {
+    "{\"brightness\":50,\"unknown\":1,\"hue\":120,\"status\":\"ON\"}",
+    "{\"level\":20,\"state\":\"OFF\",\"mode\":3}"
+  };
+  const std::vector<std::vector<std::string>> expected = {
+    {"state", "hue", "brightness"},
+    {"mode", "brightness", "state"}
+  };
+
+  for (size_t i = 0; i < 2; i++) {
+    StaticJsonDocument<200> doc;
+    deserializeJson(doc, requests[i]);
+
+    hub.radioFactory->clearAirLog();
+    hub.client.prepare(&FUT092Config, 0x1234, 1);
+    hub.client.update(doc.as<JsonObject>());
+    hub.drain();
+
+    const std::vector<std::string> fields = fieldsOnAir(hub.radioFactory->getAirLog());
+    TEST_ASSERT_EQUAL_INT(expected[i].size(), fields.size());
+
+    for (size_t j = 0; j < fields.size(); j++) {
+      TEST_ASSERT_EQUAL_STRING(expected[i][j].c_str(), fields[j].c_str());
+    }
+  }
+}
+
+void test_client_apply_matches_update() {
+  const BulbId bulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT);
+  const char* requests[] = {
+    "{\"brightness\":50,\"hue\":120,\"status\":\"ON\"}",
+    "{\"level\":20,\"state\":\"OFF\",\"mode\":3}",
+    "{\"effect\":\"night_mode\"}"
+  };
+  const MiLightCommand commands[] = {
+    MiLightCommand(bulbId).setStatus(ON).setHue(120).setBrightness(50),
+    MiLightCommand(bulbId).setStatus(OFF).setLevel(20).setMode(3),
+    MiLightCommand(bulbId).setEffect(MiLightCommand::EFFECT_NIGHT_MODE)
+  };
+
+  for (size_t i = 0; i < 3; i++) {
+    StaticJsonDocument<200> doc;
+    deserializeJson(doc, requests[i]);
+
+    NativeClock::reset();
+    SimulatedHub fromJson;
+    fromJson.client.prepare(&FUT092Config, bulbId.deviceId, bulbId.groupId);
+    fromJson.client.update(doc.as<JsonObject>());
+    fromJson.drain();
+
+    NativeClock::reset();
+    SimulatedHub typed;
+    typed.client.apply(commands[i]);
+    typed.drain();
+
+    const SimulatedAirLog& expected = fromJson.radioFactory->getAirLog();
+    const SimulatedAirLog& actual = typed.radioFactory->getAirLog();
+    TEST_ASSERT_TRUE(expected.size() > 0);
+    TEST_ASSERT_EQUAL_INT(expected.size(), actual.size());
+
+    // Sequence numbers carry on between hubs, so compare what the packets decode to
+    for (size_t j = 0; j < actual.size(); j++) {
+      StaticJsonDocument<200> expectedDoc;
+      StaticJsonDocument<200> actualDoc;
+      std::string expectedJson;
+      std::string actualJson;
+
+      FUT092Config.packetFormatter->parsePacket(expected[j].data, expectedDoc.to<JsonObject>());
+      FUT092Config.packetFormatter->parsePacket(actual[j].data, actualDoc.to<JsonObject>());
+      serializeJson(expectedDoc, expectedJson);
+      serializeJson(actualDoc, actualJson);
+
+      TEST_ASSERT_EQUAL_STRING(expectedJson.c_str(), actualJson.c_str());
+    }
+  }
+}
+
+void test_transitions_step_when_due() {
+  NativeClock::reset();
+  NativeClock::advanceMillis(1000);
+
+  TransitionController transitions;
+  std::vector<std::pair<uint8_t, uint16_t>> steps;
+  const size_t periods[] = { 300, 200, 500 };
+
+  transitions.addListener([&steps](const BulbId& bulbId, GroupStateField field, uint16_t value) {
+    steps.push_back(std::make_pair(bulbId.groupId, value));
+  });
+
+  // Group n goes from 0 to 100 in steps of 50
+  for (uint8_t i = 0; i < 3; i++) {
+    Transition::Builder builder = transitions.buildFieldTransition(
+      BulbId(0x1234, i + 1, REMOTE_TYPE_RGB_CCT),
+      GroupStateField::LEVEL,
+      0,
+      100
+    );
+    builder.setPeriod(periods[i]);
+    builder.setDurationRaw(periods[i] * 2);
+    transitions.addTransition(builder);
+  }
+
+  // Every transition takes its first step straight away
+  transitions.loop();
+  TEST_ASSERT_EQUAL_INT(3, steps.size());
+
+  // Then only the ones that are due, in the order they're due
+  const uint8_t expectedGroups[] = { 2, 1, 2, 3, 1, 3 };
+  steps.clear();
+
+  for (size_t t = 0; t < 2000; t += 50) {
+    NativeClock::advanceMillis(50);
+    transitions.loop();
+  }
+
+  TEST_ASSERT_EQUAL_INT(sizeof(expectedGroups), steps.size());
+  for (size_t i = 0; i < steps.size(); i++) {
+    TEST_ASSERT_EQUAL_INT(expectedGroups[i], steps[i].first);
+  }
+  TEST_ASSERT_EQUAL_INT(0, transitions.getNumTransitions());
+
+  // Deleted transitions are never stepped again
+  transitions.addTransition(transitions.buildFieldTransition(BulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT), GroupStateField::LEVEL, 0, 100));
+  transitions.loop();
+  steps.clear();
+
+  TEST_ASSERT_TRUE(transitions.deleteTransition(transitions.getTransitionAt(0)->id));
+  NativeClock::advanceMillis(20000);
+  transitions.loop();
+  TEST_ASSERT_EQUAL_INT(0, steps.size());
+}
+
+// On the ESP8266 millis() is 32 bits.  Signed differences of it go negative
+// past 2^31 ms (about 25 days), and it wraps at 2^32.
+void test_transitions_step_when_clock_is_past_2_31() {
+  const uint32_t starts[] = { 0x80000000UL - 200, 0x80000000UL + 1000, 0xFFFFFFFFUL - 200 };
+
+  for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+    NativeClock::reset();
+    NativeClock::advanceMillis(starts[s]);
+
+    TransitionController transitions;
+    std::vector<uint16_t> steps;
+    transitions.addListener([&steps](const BulbId& bulbId, GroupStateField field, uint16_t value) {
+      steps.push_back(value);
+    });
+
+    Transition::Builder builder = transitions.buildFieldTransition(
+      BulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT),
+      GroupStateField::LEVEL,
+      0,
+      100
+    );
+    builder.setPeriod(300);
+    builder.setDurationRaw(600);
+    transitions.addTransition(builder);
+
+    transitions.loop();
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, steps.size(), "First step should be taken straight away");
+
+    for (size_t t = 0; t < 2000; t += 50) {
+      NativeClock::advanceMillis(50);
+      transitions.loop();
+    }
+
+    TEST_ASSERT_EQUAL_INT(3, steps.size());
+    TEST_ASSERT_EQUAL_INT(100, steps.back());
+    TEST_ASSERT_EQUAL_INT(0, transitions.getNumTransitions());
+  }
+}
+
+void test_transition_start_does_not_allocate() {
+  NativeClock::reset();
+  NativeClock::advanceMillis(1000);
+
+  TransitionController transitions;
+  const BulbId bulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT);
+  const ParsedColor red = ParsedColor::fromRgb(255, 0, 0);
+  const ParsedColor blue = ParsedColor::fromRgb(0, 0, 255);
+  size_t steps = 0;
+
+  transitions.addListener([&steps](const BulbId&, GroupStateField, uint16_t) { ++steps; });
+
+  const size_t allocations = NativeHeap::allocationCount();
+
+  for (size_t round = 0; round < 3; round++) {
+    Transition::Builder field = transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100);
+    field.setDuration(1);
+    Transition::Builder color = transitions.buildColorTransition(bulbId, red, blue);
+    color.setDuration(1);
+    Transition::Builder off = transitions.buildStatusTransition(bulbId, OFF, 100);
+    off.setDuration(1);
+
+    TEST_ASSERT_NOT_NULL(transitions.addTransition(field));
+    TEST_ASSERT_NOT_NULL(transitions.addTransition(color));
+    TEST_ASSERT_NOT_NULL(transitions.addTransition(off));
+
+    while (transitions.getNumTransitions() > 0) {
+      NativeClock::advanceMillis(10);
+      transitions.loop();
+    }
+  }
+
+  TEST_ASSERT_TRUE(steps > 0);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(allocations, NativeHeap::allocationCount(), "Starting and running transitions should not allocate");
+
+  // Once every slot is taken, new transitions are turned away
+  for (size_t i = 0; i < TransitionController::MAX_TRANSITIONS; i++) {
+    TEST_ASSERT_NOT_NULL(transitions.addTransition(transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100)));
+  }
+  TEST_ASSERT_NULL(transitions.addTransition(transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100)));
+
+  transitions.deleteTransition(transitions.getTransitionAt(3)->id);
+  TEST_ASSERT_NOT_NULL(transitions.addTransition(transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100)));
+  TEST_ASSERT_EQUAL_INT(TransitionController::MAX_TRANSITIONS, transitions.getNumTransitions());
+}
+
+void test_client_transition_reports_full_pool() {
+  NativeClock::reset();
+  SimulatedHub hub;
+  const BulbId bulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT);
+
+  for (size_t i = 0; i < TransitionController::MAX_TRANSITIONS; i++) {
+    TEST_ASSERT_NOT_NULL(hub.transitions.addTransition(hub.transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100)));
+  }
+
+  StaticJsonDocument<200> args;
+  args["field"] = "level";
+  args["start_value"] = 0;
+  args["end_value"] = 100;
+  StaticJsonDocument<200> response;
+
+  hub.client.prepare(&FUT092Config, 0x1234, 1);
+  TEST_ASSERT_FALSE(hub.client.handleTransition(args.as<JsonObject>(), response));
+  TEST_ASSERT_EQUAL_STRING("Too many active transitions", response["error"].as<const char*>());
+
+  // Unknown fields are reported first, however long the name
+  args["field"] = "a_field_name_long_enough_to_overflow_the_error_message";
+  response.clear();
+  TEST_ASSERT_FALSE(hub.client.handleTransition(args.as<JsonObject>(), response));
+  TEST_ASSERT_EQUAL_STRING_LEN("Unknown transition field: a_field_name", response["error"].as<const char*>(), 38);
+  args["field"] = "level";
+
+  args["field"] = "color";
+  args["start_value"] = "#FF0000";
+  args["end_value"] = "#0000FF";
+  response.clear();
+  TEST_ASSERT_FALSE(hub.client.handleTransition(args.as<JsonObject>(), response));
+  TEST_ASSERT_EQUAL_STRING("Too many active transitions", response["error"].as<const char*>());
+
+  hub.transitions.clear();
+  response.clear();
+  TEST_ASSERT_TRUE(hub.client.handleTransition(args.as<JsonObject>(), response));
+  TEST_ASSERT_EQUAL_INT(1, hub.transitions.getNumTransitions());
+}
+
+void test_batched_transitions_share_a_timeline() {
+  NativeClock::reset();
+  NativeClock::advanceMillis(1000);
+
+  TransitionController transitions;
+  std::vector<std::pair<BulbId, uint16_t>> steps;
+  std::vector<unsigned long> stepTimes;
+
+  transitions.addListener([&steps, &stepTimes](const BulbId& bulbId, GroupStateField field, uint16_t value) {
+    steps.push_back(std::make_pair(bulbId, value));
+    stepTimes.push_back(millis());
+  });
+
+  // Every group of 0x1111, two groups of 0x2222, and one bulb that starts
+  // somewhere else and so can't share the timeline
+  const BulbId bulbIds[] = {
+    BulbId(0x1111, 1, REMOTE_TYPE_RGB_CCT),
+    BulbId(0x2222, 1, REMOTE_TYPE_RGB_CCT),
+    BulbId(0x1111, 2, REMOTE_TYPE_RGB_CCT),
+    BulbId(0x1111, 3, REMOTE_TYPE_RGB_CCT),
+    BulbId(0x2222, 3, REMOTE_TYPE_RGB_CCT),
+    BulbId(0x1111, 4, REMOTE_TYPE_RGB_CCT)
+  };
+  const size_t numBulbs = sizeof(bulbIds) / sizeof(bulbIds[0]);
+
+  transitions.beginBatch();
+  for (size_t i = 0; i < numBulbs; i++) {
+    Transition::Builder builder = transitions.buildFieldTransition(bulbIds[i], GroupStateField::LEVEL, 0, 100);
+    builder.setPeriod(100);
+    builder.setDurationRaw(400);
+    TEST_ASSERT_NOT_NULL(transitions.addTransition(builder));
+  }
+  Transition::Builder other = transitions.buildFieldTransition(BulbId(0x3333, 1, REMOTE_TYPE_RGB_CCT), GroupStateField::LEVEL, 50, 100);
+  other.setPeriod(100);
+  other.setDurationRaw(400);
+  transitions.addTransition(other);
+  transitions.endBatch();
+
+  TEST_ASSERT_EQUAL_INT(2, transitions.getNumTransitions());
+
+  MultiFieldTransition* multi = static_cast<MultiFieldTransition*>(transitions.getTransitionAt(0));
+  TEST_ASSERT_EQUAL_INT_MESSAGE(3, multi->getNumTargets(), "0x1111 should collapse to group 0");
+  TEST_ASSERT_EQUAL_INT(0x1111, multi->getTarget(0).deviceId);
+  TEST_ASSERT_EQUAL_INT(0, multi->getTarget(0).groupId);
+  TEST_ASSERT_EQUAL_INT(1, multi->getTarget(1).groupId);
+  TEST_ASSERT_EQUAL_INT(3, multi->getTarget(2).groupId);
+
+  while (transitions.getNumTransitions() > 0) {
+    NativeClock::advanceMillis(10);
+    transitions.loop();
+  }
+
+  // Every value goes to each target of the shared transition on the same tick
+  std::vector<std::pair<BulbId, uint16_t>> shared;
+  std::vector<unsigned long> sharedTimes;
+  for (size_t i = 0; i < steps.size(); i++) {
+    if (steps[i].first.deviceId != 0x3333) {
+      shared.push_back(steps[i]);
+      sharedTimes.push_back(stepTimes[i]);
+    }
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, shared.size() % 3);
+  TEST_ASSERT_TRUE(shared.size() > 3);
+  for (size_t i = 0; i < shared.size(); i += 3) {
+    TEST_ASSERT_EQUAL_INT(shared[i].second, shared[i + 1].second);
+    TEST_ASSERT_EQUAL_INT(shared[i].second, shared[i + 2].second);
+    TEST_ASSERT_EQUAL_INT(sharedTimes[i], sharedTimes[i + 2]);
+  }
+  TEST_ASSERT_EQUAL_INT(100, shared.back().second);
+
+  // A fade to OFF turns every target off at the end
+  steps.clear();
+  transitions.beginBatch();
+  for (size_t i = 0; i < 2; i++) {
+    Transition::Builder builder = transitions.buildStatusTransition(bulbIds[i], OFF, 100);
+    builder.setDuration(1);
+    transitions.addTransition(builder);
+  }
+  transitions.endBatch();
+  TEST_ASSERT_EQUAL_INT(1, transitions.getNumTransitions());
+
+  while (transitions.getNumTransitions() > 0) {
+    NativeClock::advanceMillis(10);
+    transitions.loop();
+  }
+
+  TEST_ASSERT_EQUAL_INT(OFF, steps[steps.size() - 1].second);
+  TEST_ASSERT_EQUAL_INT(OFF, steps[steps.size() - 2].second);
+  TEST_ASSERT_EQUAL_INT(0, steps[steps.size() - 3].second);
+}
+
+void test_single_target_batched_transitions_serialize_plainly() {
+  NativeClock::reset();
+  TransitionController transitions;
+  const BulbId bulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT);
+
+  transitions.beginBatch();
+  TEST_ASSERT_NOT_NULL(transitions.addTransition(transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100)));
+  TEST_ASSERT_NOT_NULL(transitions.addTransition(transitions.buildStatusTransition(BulbId(0x1234, 2, REMOTE_TYPE_RGB_CCT), OFF, 100)));
+  transitions.endBatch();
+
+  StaticJsonDocument<1024> doc;
+  JsonObject json = doc.to<JsonObject>();
+  transitions.getTransitionAt(0)->serialize(json);
+
+  TEST_ASSERT_EQUAL_STRING("field", json["type"].as<const char*>());
+  TEST_ASSERT_EQUAL_STRING("level", json["field"].as<const char*>());
+  TEST_ASSERT_FALSE(json.containsKey("bulbs"));
+
+  json = doc.to<JsonObject>();
+  transitions.getTransitionAt(1)->serialize(json);
+
+  TEST_ASSERT_EQUAL_STRING("change_on_finish", json["type"].as<const char*>());
+  TEST_ASSERT_EQUAL_STRING("status", json["field"].as<const char*>());
+  TEST_ASSERT_EQUAL_STRING("field", json["child"]["type"].as<const char*>());
+  TEST_ASSERT_FALSE(json.containsKey("bulbs"));
+
+  // Once a second bulb joins, it's listed as one transition for both
+  transitions.clear();
+  transitions.beginBatch();
+  transitions.addTransition(transitions.buildFieldTransition(bulbId, GroupStateField::LEVEL, 0, 100));
+  transitions.addTransition(transitions.buildFieldTransition(BulbId(0x1234, 2, REMOTE_TYPE_RGB_CCT), GroupStateField::LEVEL, 0, 100));
+  transitions.endBatch();
+
+  json = doc.to<JsonObject>();
+  transitions.getTransitionAt(0)->serialize(json);
+  TEST_ASSERT_EQUAL_STRING("multi_field", json["type"].as<const char*>());
+  TEST_ASSERT_EQUAL_INT(2, json["bulbs"].as<JsonArray>().size());
+}
+
+void test_transitions_skip_steps_when_radio_is_backed_up() {
+  // Final steps are never skipped, so this many can't overflow what's left
+  // of the queue when they all land at once
+  const size_t numGroups = 8;
+  const size_t queueCapacity = 20;
+  // About what a packet with 50 repeats takes to send
+  const unsigned long packetMillis = 45;
+  unsigned long finishedAt[2][numGroups];
+  size_t stepsSent[2] = { 0, 0 };
+
+  for (size_t throttled = 0; throttled < 2; throttled++) {
+    NativeClock::reset();
+    NativeClock::advanceMillis(1000);
+
+    TransitionController transitions;
+    std::vector<uint16_t> lastValues(numGroups, 0);
+    size_t queued = 0;
+    size_t dropped = 0;
+    unsigned long sendingUntil = 0;
+    bool monotonic = true;
+
+    // Stands in for PacketSender: one packet per step, drained at radio speed
+    transitions.addListener([&](const BulbId& bulbId, GroupStateField field, uint16_t value) {
+      const size_t group = bulbId.deviceId - 0x1000;
+
+      monotonic = monotonic && value >= lastValues[group];
+      lastValues[group] = value;
+      ++stepsSent[throttled];
+
+      if (value == 100) {
+        finishedAt[throttled][group] = millis();
+      }
+      if (queued == queueCapacity) {
+        ++dropped;
+      } else {
+        ++queued;
+      }
+    });
+
+    if (throttled) {
+      transitions.setBacklogSource([&queued]() { return queued; }, queueCapacity / 2);
+    }
+
+    for (size_t i = 0; i < numGroups; i++) {
+      Transition::Builder builder = transitions.buildFieldTransition(
+        BulbId(0x1000 + i, 1, REMOTE_TYPE_RGB_CCT),
+        GroupStateField::LEVEL,
+        0,
+        100
+      );
+      builder.setPeriod(Transition::MIN_PERIOD);
+      builder.setDuration(3);
+      transitions.addTransition(builder);
+    }
+
+    while (transitions.getNumTransitions() > 0) {
+      transitions.loop();
+      NativeClock::advanceMillis(1);
+
+      if (queued > 0 && millis() >= sendingUntil) {
+        --queued;
+        sendingUntil = millis() + packetMillis;
+      }
+    }
+
+    TEST_ASSERT_TRUE(monotonic);
+    for (size_t i = 0; i < numGroups; i++) {
+      TEST_ASSERT_EQUAL_INT(100, lastValues[i]);
+    }
+
+    if (throttled) {
+      TEST_ASSERT_EQUAL_INT_MESSAGE(0, dropped, "Should hold back steps rather than overflow the queue");
+    } else {
+      TEST_ASSERT_TRUE(dropped > 0);
+    }
+  }
+
+  // Skipping thins out the steps but keeps the timeline
+  TEST_ASSERT_TRUE(stepsSent[1] < stepsSent[0] / 2);
+  for (size_t i = 0; i < numGroups; i++) {
+    TEST_ASSERT_EQUAL_INT(finishedAt[0][i], finishedAt[1][i]);
+  }
+}
+
+// Float versions of the curves in Easing.cpp
+static double referenceEasing(TransitionEasing easing, double t) {
+  switch (easing) {
+    case EASING_EASE_IN:
+      return t * t * t;
+    case EASING_EASE_OUT:
+      return 1 - pow(1 - t, 3);
+    case EASING_EASE_IN_OUT:
+      return t < 0.5 ? 4 * t * t * t : 1 - pow(-2 * t + 2, 3) / 2;
+    case EASING_PERCEPTUAL:
+      return t * 100 > 8 ? pow((t * 100 + 16) / 116, 3) : t * 100 / 903.3;
+    default:
+      return t;
+  }
+}
+
+void test_easing_curves() {
+  const TransitionEasing easings[] = { EASING_LINEAR, EASING_EASE_IN, EASING_EASE_OUT, EASING_EASE_IN_OUT, EASING_PERCEPTUAL };
+
+  for (size_t e = 0; e < sizeof(easings) / sizeof(easings[0]); e++) {
+    const TransitionEasing easing = easings[e];
+    uint16_t last = 0;
+
+    TEST_ASSERT_EQUAL_STRING(Easing::getName(easing), Easing::getName(Easing::fromName(Easing::getName(easing))));
+    TEST_ASSERT_EQUAL_INT(0, Easing::apply(easing, 0));
+    TEST_ASSERT_EQUAL_INT(Easing::FULL, Easing::apply(easing, Easing::FULL));
+
+    for (uint32_t progress = 0; progress <= Easing::FULL; progress++) {
+      const uint16_t eased = Easing::apply(easing, progress);
+      const double expected = referenceEasing(easing, progress / static_cast<double>(Easing::FULL)) * Easing::FULL;
+
+      TEST_ASSERT_TRUE_MESSAGE(eased >= last, "Easing curves should never go backwards");
+      TEST_ASSERT_TRUE_MESSAGE(std::abs(eased - expected) <= Easing::FULL / 200, "Table should follow the curve");
+      last = eased;
+    }
+
+    // Transitions land on both ends exactly, and only ever move towards the end
+    const int16_t ranges[][2] = { { 0, 100 }, { 100, 0 }, { 0, 255 }, { 359, 0 }, { 153, 370 }, { 42, 42 } };
+    const size_t stepCounts[] = { 1, 3, 20, 255, 1000 };
+
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+      const int16_t start = ranges[r][0];
+      const int16_t end = ranges[r][1];
+
+      for (size_t s = 0; s < sizeof(stepCounts) / sizeof(stepCounts[0]); s++) {
+        const size_t numSteps = stepCounts[s];
+        int16_t previous = start;
+
+        TEST_ASSERT_EQUAL_INT(start, Easing::interpolate(easing, start, end, 0, numSteps));
+        TEST_ASSERT_EQUAL_INT(end, Easing::interpolate(easing, start, end, numSteps, numSteps));
+
+        for (size_t step = 1; step <= numSteps; step++) {
+          const int16_t value = Easing::interpolate(easing, start, end, step, numSteps);
+          TEST_ASSERT_TRUE(end >= start ? value >= previous : value <= previous);
+          previous = value;
+        }
+      }
+    }
+  }
+
+  TEST_ASSERT_EQUAL_INT(EASING_UNKNOWN, Easing::fromName("bouncy"));
+  TEST_ASSERT_EQUAL_INT(EASING_UNKNOWN, Easing::fromName(nullptr));
+
+  // Half way through a perceptual fade is well under half brightness
+  TEST_ASSERT_TRUE(Easing::interpolate(EASING_PERCEPTUAL, 0, 100, 1, 2) < 25);
+}
+
+void test_eased_transitions_land_on_end_value() {
+  NativeClock::reset();
+  NativeClock::advanceMillis(1000);
+
+  TransitionController transitions;
+  // Levels sent to groups 1 and 2, and the last status sent to group 2
+  std::vector<uint16_t> levels[2];
+  uint16_t status = ON;
+
+  transitions.addListener([&levels, &status](const BulbId& bulbId, GroupStateField field, uint16_t value) {
+    if (field == GroupStateField::LEVEL) {
+      levels[bulbId.groupId - 1].push_back(value);
+    } else if (field == GroupStateField::STATUS) {
+      status = value;
+    }
+  });
+
+  Transition::Builder up = transitions.buildFieldTransition(BulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT), GroupStateField::LEVEL, 0, 100);
+  up.setEasing(EASING_PERCEPTUAL);
+  up.setDuration(2);
+  up.setPeriod(200);
+  transitions.addTransition(up);
+
+  Transition::Builder off = transitions.buildStatusTransition(BulbId(0x1234, 2, REMOTE_TYPE_RGB_CCT), OFF, 100);
+  off.setEasing(EASING_EASE_OUT);
+  off.setDuration(2);
+  transitions.addTransition(off);
+
+  while (transitions.getNumTransitions() > 0) {
+    NativeClock::advanceMillis(10);
+    transitions.loop();
+  }
+
+  TEST_ASSERT_EQUAL_INT(11, levels[0].size());
+  TEST_ASSERT_EQUAL_INT(0, levels[0].front());
+  TEST_ASSERT_EQUAL_INT(100, levels[0].back());
+  // Most of the raw change happens late, where it's easiest to see
+  TEST_ASSERT_TRUE(levels[0][5] < 25);
+
+  TEST_ASSERT_EQUAL_INT(100, levels[1].front());
+  TEST_ASSERT_EQUAL_INT(0, levels[1].back());
+  TEST_ASSERT_TRUE(levels[1][levels[1].size() / 2] < 50);
+  TEST_ASSERT_EQUAL_INT(OFF, status);
+
+  for (size_t i = 1; i < levels[0].size(); i++) {
+    TEST_ASSERT_TRUE(levels[0][i] >= levels[0][i - 1]);
+  }
+  for (size_t i = 1; i < levels[1].size(); i++) {
+    TEST_ASSERT_TRUE(levels[1][i] <= levels[1][i - 1]);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_simulated_radio_records_frames);
+  RUN_TEST(test_simulated_radio_receive);
+
+  RUN_TEST(test_nrf24_receive_keeps_radio_configured);
+  RUN_TEST(test_nrf24_recovers_from_reset);
+  RUN_TEST(test_nrf24_read_pending);
+  RUN_TEST(test_nrf24_frames_match_reference);
+  RUN_TEST(test_lt8900_sends_repeats_from_loop);
+  RUN_TEST(test_lt8900_receives_after_sending);
+  RUN_TEST(test_lt8900_receives_while_rotating_configs);
+  RUN_TEST(test_lt8900_skips_unchanged_registers);
+
+  RUN_TEST(test_duplicate_filter_window);
+  RUN_TEST(test_listen_scheduler_favors_decoded_configs);
+  RUN_TEST(test_listen_scheduler_pinned_remote_types);
+  RUN_TEST(test_switchboard_counts_received_packets);
+  RUN_TEST(test_spsc_ring_simulated_producer);
+  RUN_TEST(test_switchboard_receives_from_interrupt);
+  RUN_TEST(test_switchboard_routes_to_listen_radio);
+  RUN_TEST(test_switchboard_shares_radio_without_listener);
+
+  RUN_TEST(test_cache_lru_order);
+  RUN_TEST(test_cache_matches_reference);
+  RUN_TEST(test_cache_churn_does_not_allocate);
+  RUN_TEST(test_store_cached_updates_do_not_allocate);
+
+  RUN_TEST(test_journal_round_trip);
+  RUN_TEST(test_journal_compaction);
+  RUN_TEST(test_journal_ignores_torn_record);
+  RUN_TEST(test_journal_compaction_needs_room_for_new_journal);
+  RUN_TEST(test_journal_recovers_from_short_append);
+  RUN_TEST(test_journal_migrates_legacy_files);
+  RUN_TEST(test_store_flush_is_one_append);
+  RUN_TEST(test_store_limited_flush_respects_budget);
+
+  RUN_TEST(test_packet_queue_keeps_popped_slots_until_released);
+  RUN_TEST(test_packet_sender_does_not_allocate);
+  RUN_TEST(test_packet_formatters_classify_commands);
+  RUN_TEST(test_v2_encoding_matches_reference);
+  RUN_TEST(test_v2_encoding_whole_stream);
+  RUN_TEST(test_packet_sender_coalesces_stale_values);
+  RUN_TEST(test_packet_sender_coalescing_keeps_order);
+  RUN_TEST(test_packet_sender_interleaves_repeats);
+  RUN_TEST(test_packet_sender_interleaving_keeps_bulb_order);
+  RUN_TEST(test_packet_sender_batches_radio_configs);
+  RUN_TEST(test_packet_sender_reorder_window_is_bounded);
+
+  RUN_TEST(test_client_update_reaches_radio);
+  RUN_TEST(test_client_update_updates_state);
+  RUN_TEST(test_update_keys_are_sorted);
+  RUN_TEST(test_client_update_applies_fields_in_order);
+  RUN_TEST(test_client_apply_matches_update);
+
+  RUN_TEST(test_transitions_step_when_due);
+  RUN_TEST(test_transitions_step_when_clock_is_past_2_31);
+  RUN_TEST(test_transition_start_does_not_allocate);
+  RUN_TEST(test_client_transition_reports_full_pool);
+  RUN_TEST(test_batched_transitions_share_a_timeline);
+  RUN_TEST(test_single_target_batched_transitions_serialize_plainly);
+  RUN_TEST(test_transitions_skip_steps_when_radio_is_backed_up);
+  RUN_TEST(test_easing_curves);
+  RUN_TEST(test_eased_transitions_land_on_end_value);
+
+  return UNITY_END();
+}
@@ -0,0 +1,1015 @@
+/*
+ * Host micro-benchmarks.  These report timings rather than asserting on them,
+ * since wall-clock numbers depend on the machine running them:
+ *
+ *   pio test -e native -f native_bench -v
+ */
+
+#include <Arduino.h>
+
+#include <FS.h>
+#include <GroupStateCache.h>
+#include <GroupStatePersistence.h>
+#include <ListenScheduler.h>
+#include <MiLightClient.h>
+#include <LT8900MiLightRadio.h>
+#include <NativeHeap.h>
+#include <NRF24MiLightRadio.h>
+#include <PacketSender.h>
+#include <RadioSwitchboard.h>
+#include <SimulatedLT8900.h>
+#include <SimulatedMiLightRadio.h>
+#include <SPI.h>
+#include <V2RFEncoding.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "unity.h"
+
+//================================================================================
+// Helpers
+//================================================================================
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double nanosPerOp(BenchClock::time_point start, size_t ops) {
+  std::chrono::duration<double, std::nano> elapsed = BenchClock::now() - start;
+  return elapsed.count() / ops;
+}
+
+// Keeps the compiler from discarding results of benchmarked calls
+static volatile uintptr_t sink;
+
+//================================================================================
+// GroupStateCache
+//================================================================================
+
+void bench_cache_lookup() {
+  const size_t sizes[] = {10, 25, 50, 100, 200, 400};
+  const size_t lookups = 200000;
+  GroupState state = GroupState::defaultState(REMOTE_TYPE_FUT089);
+  char message[100];
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    const size_t size = sizes[s];
+    GroupStateCache cache(size);
+    std::vector<BulbId> ids;
+
+    for (size_t i = 0; i < size; i++) {
+      BulbId id(0x1000 + i / 8, i % 8 + 1, REMOTE_TYPE_FUT089);
+      ids.push_back(id);
+      cache.set(id, state);
+    }
+
+    // Walk ids in insertion order, which always hits the LRU end of the list
+    // (the worst case for a linear scan).
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < lookups; i++) {
+      sink = reinterpret_cast<uintptr_t>(cache.get(ids[i % size]));
+    }
+    double hitNanos = nanosPerOp(start, lookups);
+
+    start = BenchClock::now();
+    for (size_t i = 0; i < lookups; i++) {
+      sink = reinterpret_cast<uintptr_t>(cache.get(BulbId(0x2000 + i % size, 1, REMOTE_TYPE_FUT089)));
+    }
+    double missNanos = nanosPerOp(start, lookups);
+
+    snprintf(message, sizeof(message), "GroupStateCache size=%3zu: hit %6.1f ns, miss %6.1f ns", size, hitNanos, missNanos);
+    TEST_MESSAGE(message);
+  }
+}
+
+//================================================================================
+// State persistence
+//================================================================================
+
+// The layout GroupStatePersistence used before the journal: one file per bulb,
+// rewritten on every flush.
+static void legacySet(const BulbId& id, const GroupState& state) {
+  char path[30];
+  sprintf(path, "group_states/%x", id.getCompactId());
+
+  File f = SPIFFS.open(path, "w");
+  state.dump(f);
+  f.close();
+}
+
+static void legacyClear(const BulbId& id) {
+  char path[30];
+  sprintf(path, "group_states/%x", id.getCompactId());
+
+  if (SPIFFS.exists(path)) {
+    SPIFFS.remove(path);
+  }
+}
+
+// Rough SPIFFS cost model: every write session programs the data pages it
+// touches plus an object index page, and every create/remove/rename updates
+// one more page of metadata.
+static size_t estimatedPages(const FSStats& stats) {
+  return stats.bytesWritten / 256 + 2 * stats.writeOpens + stats.creates + stats.removes + stats.renames;
+}
+
+static void reportFlush(const char* layout, size_t dirty, const FSStats& stats, size_t flushes, double nanos) {
+  char message[150];
+  snprintf(
+    message,
+    sizeof(message),
+    "%-8s %2zu dirty/flush: %5.1f opens, %6.1f bytes, ~%5.1f pages, %7.0f ns per flush",
+    layout,
+    dirty,
+    static_cast<double>(stats.writeOpens) / flushes,
+    static_cast<double>(stats.bytesWritten) / flushes,
+    static_cast<double>(estimatedPages(stats)) / flushes,
+    nanos
+  );
+  TEST_MESSAGE(message);
+}
+
+void bench_state_flush() {
+  const size_t dirtyCounts[] = {1, 8, 32};
+  const size_t flushes = 2000;
+
+  for (size_t d = 0; d < sizeof(dirtyCounts) / sizeof(dirtyCounts[0]); d++) {
+    const size_t dirty = dirtyCounts[d];
+    std::vector<BulbId> ids;
+
+    for (size_t i = 0; i < dirty; i++) {
+      ids.push_back(BulbId(0x1000 + i / 8, i % 8 + 1, REMOTE_TYPE_FUT089));
+    }
+
+    // Each flush rewrites every dirty bulb, and evicts one bulb every 8 flushes
+    SPIFFS.format();
+    SPIFFS.resetStats();
+    BenchClock::time_point start = BenchClock::now();
+
+    for (size_t i = 0; i < flushes; i++) {
+      GroupState state = GroupState::defaultState(REMOTE_TYPE_FUT089);
+      state.setBrightness(i % 100);
+
+      for (size_t j = 0; j < dirty; j++) {
+        legacySet(ids[j], state);
+      }
+      if (i % 8 == 7) {
+        legacyClear(ids[i % dirty]);
+      }
+    }
+    reportFlush("files", dirty, SPIFFS.getStats(), flushes, nanosPerOp(start, flushes));
+
+    SPIFFS.format();
+    GroupStatePersistence persistence;
+    persistence.getLiveCount();
+    SPIFFS.resetStats();
+    start = BenchClock::now();
+
+    for (size_t i = 0; i < flushes; i++) {
+      GroupState state = GroupState::defaultState(REMOTE_TYPE_FUT089);
+      state.setBrightness(i % 100);
+
+      for (size_t j = 0; j < dirty; j++) {
+        persistence.set(ids[j], state);
+      }
+      if (i % 8 == 7) {
+        persistence.clear(ids[i % dirty]);
+      }
+      persistence.commit();
+    }
+    reportFlush("journal", dirty, SPIFFS.getStats(), flushes, nanosPerOp(start, flushes));
+  }
+}
+
+//================================================================================
+// Packet queue
+//================================================================================
+
+// A CCT brightness change is sent as up to this many packets
+static const size_t PACKETS_PER_COMMAND = 20;
+
+void bench_packet_queue() {
+  const size_t commands = 20000;
+  Settings settings;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> radioFactory = std::make_shared<SimulatedRadioFactory>(0);
+  RadioSwitchboard radios(radioFactory, &stateStore, settings);
+  PacketSender sender(radios, settings, nullptr);
+  uint8_t packet[MILIGHT_MAX_PACKET_LENGTH] = { 0 };
+  char message[100];
+
+  // One repeat per packet, so this mostly measures the queue
+  for (size_t i = 0; i < PACKETS_PER_COMMAND; i++) {
+    sender.enqueue(packet, &FUT091Config, 1);
+  }
+  while (sender.isSending()) {
+    sender.loop();
+  }
+
+  size_t allocations = NativeHeap::allocationCount();
+  BenchClock::time_point start = BenchClock::now();
+
+  for (size_t i = 0; i < commands; i++) {
+    radioFactory->clearAirLog();
+
+    for (size_t j = 0; j < PACKETS_PER_COMMAND; j++) {
+      packet[0] = j;
+      sender.enqueue(packet, &FUT091Config, 1);
+    }
+    while (sender.isSending()) {
+      sender.loop();
+    }
+  }
+
+  double nanos = nanosPerOp(start, commands * PACKETS_PER_COMMAND);
+  double allocationsPerCommand = static_cast<double>(NativeHeap::allocationCount() - allocations) / commands;
+
+  snprintf(message, sizeof(message), "PacketSender enqueue+send: %6.1f ns/packet, %5.1f allocations/command", nanos, allocationsPerCommand);
+  TEST_MESSAGE(message);
+}
+
+//================================================================================
+// Repeat scheduling
+//================================================================================
+
+// A scene that switches on groups 1-4 on two remotes.  Reports how long each
+// command waits for its first frame to hit the air, in simulated time.
+static void reportFirstTransmission(bool interleave) {
+  const uint16_t deviceIds[] = { 0x1111, 0x2222 };
+  const size_t commands = 8;
+  Settings settings;
+  settings.interleavePacketRepeats = interleave;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> radioFactory = std::make_shared<SimulatedRadioFactory>();
+  RadioSwitchboard radios(radioFactory, &stateStore, settings);
+  PacketSender sender(radios, settings, nullptr);
+  PacketFormatter* formatter = FUT092Config.packetFormatter;
+  unsigned long firstFrames[commands];
+  char message[120];
+
+  NativeClock::reset();
+  radioFactory->clearAirLog();
+  unsigned long start = micros();
+
+  for (size_t group = 1; group <= 4; group++) {
+    for (size_t i = 0; i < 2; i++) {
+      formatter->prepare(deviceIds[i], group);
+      formatter->updateStatus(ON, group);
+      PacketStream& stream = formatter->buildPackets();
+
+      while (stream.hasNext()) {
+        sender.enqueue(stream.next(), &FUT092Config);
+      }
+    }
+  }
+  while (sender.isSending()) {
+    sender.loop();
+  }
+
+  const SimulatedAirLog& log = radioFactory->getAirLog();
+  size_t found = 0;
+
+  // Commands are queued in a known order, and their first frames appear in
+  // the same order
+  for (size_t i = 0; i < log.size() && found < commands; i++) {
+    BulbId bulbId;
+    formatter->classifyPacket(log[i].data, bulbId);
+
+    if (bulbId.deviceId == deviceIds[found % 2] && bulbId.groupId == found / 2 + 1) {
+      firstFrames[found++] = log[i].timestamp - start;
+    }
+  }
+
+  double total = 0;
+  for (size_t i = 0; i < found; i++) {
+    total += firstFrames[i];
+  }
+
+  snprintf(message, sizeof(message), "Interleaving %-3s: first frame after %5.1f ms mean, %5.1f ms worst; all sent after %5.1f ms",
+    interleave ? "on" : "off",
+    total / found / 1000.0,
+    firstFrames[found - 1] / 1000.0,
+    (log.back().timestamp - start) / 1000.0);
+  TEST_MESSAGE(message);
+}
+
+void bench_time_to_first_transmission() {
+  reportFirstTransmission(false);
+  reportFirstTransmission(true);
+}
+
+//================================================================================
+// Client updates
+//================================================================================
+
+// Commands as Home Assistant's MQTT light sends them (JSON schema)
+static const char* HOME_ASSISTANT_REQUESTS[] = {
+  "{\"state\":\"ON\"}",
+  "{\"state\":\"OFF\"}",
+  "{\"state\":\"ON\",\"brightness\":128}",
+  "{\"state\":\"ON\",\"color_temp\":300}",
+  "{\"state\":\"ON\",\"brightness\":200,\"color_temp\":250}",
+  "{\"state\":\"ON\",\"color\":{\"r\":255,\"g\":120,\"b\":0}}",
+  "{\"state\":\"ON\",\"color\":{\"h\":240,\"s\":100}}",
+  "{\"state\":\"ON\",\"effect\":\"night_mode\"}",
+  "{\"state\":\"ON\",\"brightness\":60,\"transition\":2}",
+  "{\"state\":\"OFF\",\"transition\":1}"
+};
+
+// CPU time per MiLightClient::update(), including building and queueing the
+// packets.  Sending them isn't included.
+void bench_client_update() {
+  const size_t rounds = 2000;
+  const size_t numRequests = sizeof(HOME_ASSISTANT_REQUESTS) / sizeof(HOME_ASSISTANT_REQUESTS[0]);
+  Settings settings;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> radioFactory = std::make_shared<SimulatedRadioFactory>(0);
+  RadioSwitchboard radios(radioFactory, &stateStore, settings);
+  PacketSender sender(radios, settings, nullptr);
+  TransitionController transitions;
+  MiLightClient client(radios, sender, &stateStore, settings, transitions);
+  std::vector<std::shared_ptr<DynamicJsonDocument>> requests;
+  char message[100];
+
+  for (size_t i = 0; i < numRequests; i++) {
+    std::shared_ptr<DynamicJsonDocument> doc = std::make_shared<DynamicJsonDocument>(256);
+    deserializeJson(*doc, HOME_ASSISTANT_REQUESTS[i]);
+    requests.push_back(doc);
+  }
+
+  NativeClock::reset();
+  client.prepare(&FUT092Config, 0x1234, 1);
+  std::chrono::duration<double, std::nano> elapsed(0);
+
+  for (size_t round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < numRequests; i++) {
+      BenchClock::time_point start = BenchClock::now();
+      client.update(requests[i]->as<JsonObject>());
+      elapsed += BenchClock::now() - start;
+
+      while (sender.isSending()) {
+        sender.loop();
+      }
+    }
+    transitions.clear();
+  }
+
+  snprintf(message, sizeof(message), "Client update: %7.1f ns/request (%u Home Assistant requests)",
+    elapsed.count() / (rounds * numRequests),
+    static_cast<unsigned int>(numRequests));
+  TEST_MESSAGE(message);
+}
+
+// CPU time the transition listener in src/main.cpp spends per transition
+// step, going through a JSON document and update() (what it used to do)
+// against building a MiLightCommand and calling apply().
+void bench_transition_step() {
+  const size_t steps = 20000;
+  const BulbId bulbId(0x1234, 1, REMOTE_TYPE_RGB_CCT);
+  const GroupStateField fields[] = { GroupStateField::LEVEL, GroupStateField::HUE, GroupStateField::KELVIN };
+  const char* labels[] = { "JSON", "typed" };
+  Settings settings;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> radioFactory = std::make_shared<SimulatedRadioFactory>(0);
+  RadioSwitchboard radios(radioFactory, &stateStore, settings);
+  PacketSender sender(radios, settings, nullptr);
+  TransitionController transitions;
+  MiLightClient client(radios, sender, &stateStore, settings, transitions);
+  char message[100];
+
+  NativeClock::reset();
+
+  for (size_t typed = 0; typed < 2; typed++) {
+    std::chrono::duration<double, std::nano> elapsed(0);
+
+    for (size_t i = 0; i < steps; i++) {
+      const GroupStateField field = fields[i % 3];
+      const uint16_t value = i % 100;
+      BenchClock::time_point start = BenchClock::now();
+
+      if (typed) {
+        MiLightCommand command(bulbId);
+        command.set(field, value);
+        client.apply(command);
+      } else {
+        StaticJsonDocument<100> buffer;
+        buffer[GroupStateFieldHelpers::getFieldName(field)] = value;
+        client.prepare(bulbId.deviceType, bulbId.deviceId, bulbId.groupId);
+        client.update(buffer.as<JsonObject>());
+      }
+
+      elapsed += BenchClock::now() - start;
+
+      while (sender.isSending()) {
+        sender.loop();
+      }
+    }
+
+    snprintf(message, sizeof(message), "Transition step (%-5s): %7.1f ns/step",
+      labels[typed], elapsed.count() / steps);
+    TEST_MESSAGE(message);
+  }
+}
+
+//================================================================================
+// Transitions
+//================================================================================
+
+// Sunrise-style fades: 0 to 100 over half an hour, one per group.  Almost no
+// loop() call has a step due.
+static void startSunrises(TransitionController& transitions, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    Transition::Builder builder = transitions.buildFieldTransition(
+      BulbId(0x1000 + i / 8, i % 8 + 1, REMOTE_TYPE_RGB_CCT),
+      GroupStateField::LEVEL,
+      0,
+      100
+    );
+    builder.setDuration(1800);
+    transitions.addTransition(builder);
+  }
+}
+
+// CPU time per TransitionController::loop() against the number of active
+// transitions, calling loop() once per simulated millisecond.  "walk" ticks
+// every transition on every call, which is what loop() used to do.
+void bench_transition_loop() {
+  const size_t counts[] = { 1, 4, 16 };
+  const size_t loops = 120000;
+  char message[120];
+
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    double nanos[2];
+    size_t steps[2] = { 0, 0 };
+
+    for (size_t scheduled = 0; scheduled < 2; scheduled++) {
+      TransitionController transitions;
+      size_t& stepCount = steps[scheduled];
+      transitions.addListener([&stepCount](const BulbId&, GroupStateField, uint16_t) { ++stepCount; });
+
+      NativeClock::reset();
+      NativeClock::advanceMillis(1);
+      startSunrises(transitions, counts[c]);
+
+      BenchClock::time_point start = BenchClock::now();
+      for (size_t i = 0; i < loops; i++) {
+        if (scheduled) {
+          transitions.loop();
+        } else {
+          for (size_t t = 0; t < transitions.getNumTransitions(); t++) {
+            transitions.getTransitionAt(t)->tick();
+          }
+        }
+        NativeClock::advanceMillis(1);
+      }
+      nanos[scheduled] = nanosPerOp(start, loops);
+    }
+
+    snprintf(message, sizeof(message), "Transition loop, %3u active: walk %7.1f ns/loop, scheduled %6.1f ns/loop (%u steps)",
+      static_cast<unsigned int>(counts[c]),
+      nanos[0],
+      nanos[1],
+      static_cast<unsigned int>(steps[1]));
+    TEST_MESSAGE(message);
+  }
+}
+
+// Frames sent to fade 12 groups (every group of three RGB+CCT remotes) from 0
+// to 100, with a transition per group against one batched transition, and the
+// number of distinct milliseconds at which steps went out.
+void bench_batched_transitions() {
+  const char* labels[] = { "separate", "batched" };
+  char message[120];
+
+  for (size_t batched = 0; batched < 2; batched++) {
+    Settings settings;
+    GroupStateStore stateStore(20, 0);
+    std::shared_ptr<SimulatedRadioFactory> radioFactory = std::make_shared<SimulatedRadioFactory>(0);
+    RadioSwitchboard radios(radioFactory, &stateStore, settings);
+    PacketSender sender(radios, settings, nullptr);
+    TransitionController transitions;
+    MiLightClient client(radios, sender, &stateStore, settings, transitions);
+    std::vector<unsigned long> stepTimes;
+
+    // Mirrors the transition listener in src/main.cpp
+    transitions.addListener([&client, &stepTimes](const BulbId& bulbId, GroupStateField field, uint16_t value) {
+      MiLightCommand command(bulbId);
+      if (command.set(field, value)) {
+        client.apply(command);
+      }
+      if (stepTimes.empty() || stepTimes.back() != millis()) {
+        stepTimes.push_back(millis());
+      }
+    });
+
+    NativeClock::reset();
+    NativeClock::advanceMillis(1);
+
+    if (batched) {
+      transitions.beginBatch();
+    }
+    for (size_t i = 0; i < 12; i++) {
+      Transition::Builder builder = transitions.buildFieldTransition(
+        BulbId(0x1000 + i / 4, i % 4 + 1, REMOTE_TYPE_RGB_CCT),
+        GroupStateField::LEVEL,
+        0,
+        100
+      );
+      builder.setDuration(5);
+      transitions.addTransition(builder);
+      // Requests for each group arrive a little apart
+      NativeClock::advanceMillis(7);
+    }
+    if (batched) {
+      transitions.endBatch();
+    }
+
+    radioFactory->clearAirLog();
+
+    while (transitions.getNumTransitions() > 0 || sender.isSending()) {
+      transitions.loop();
+      sender.loop();
+      NativeClock::advanceMillis(1);
+    }
+
+    snprintf(message, sizeof(message), "Fade 12 groups (%-8s): %5u frames on air, steps at %3u distinct times",
+      labels[batched],
+      static_cast<unsigned int>(radioFactory->getAirLog().size()),
+      static_cast<unsigned int>(stepTimes.size()));
+    TEST_MESSAGE(message);
+  }
+}
+
+// The easing curves evaluated in float, the way they'd be computed without
+// the lookup tables
+static int16_t floatEasing(TransitionEasing easing, int16_t start, int16_t end, size_t step, size_t numSteps) {
+  const float t = step / static_cast<float>(numSteps);
+  float eased;
+
+  switch (easing) {
+    case EASING_EASE_IN:
+      eased = t * t * t;
+      break;
+    case EASING_EASE_OUT:
+      eased = 1 - powf(1 - t, 3);
+      break;
+    case EASING_EASE_IN_OUT:
+      eased = t < 0.5f ? 4 * t * t * t : 1 - powf(-2 * t + 2, 3) / 2;
+      break;
+    case EASING_PERCEPTUAL:
+      eased = t * 100 > 8 ? powf((t * 100 + 16) / 116, 3) : t * 100 / 903.3f;
+      break;
+    default:
+      eased = t;
+      break;
+  }
+
+  return start + static_cast<int16_t>(roundf((end - start) * eased));
+}
+
+// CPU time to work out one eased transition value, through the fixed-point
+// tables against float math.  The ESP8266 has no FPU, so the gap is far wider
+// there than on the host.
+void bench_easing() {
+  const TransitionEasing easings[] = { EASING_EASE_IN, EASING_EASE_OUT, EASING_EASE_IN_OUT, EASING_PERCEPTUAL };
+  const size_t numSteps = 1000;
+  const size_t rounds = 500;
+  char message[100];
+
+  for (size_t e = 0; e < sizeof(easings) / sizeof(easings[0]); e++) {
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t r = 0; r < rounds; r++) {
+      for (size_t step = 0; step <= numSteps; step++) {
+        sink = Easing::interpolate(easings[e], 0, 100 + r % 2, step, numSteps);
+      }
+    }
+    double tableNanos = nanosPerOp(start, rounds * (numSteps + 1));
+
+    start = BenchClock::now();
+    for (size_t r = 0; r < rounds; r++) {
+      for (size_t step = 0; step <= numSteps; step++) {
+        sink = floatEasing(easings[e], 0, 100 + r % 2, step, numSteps);
+      }
+    }
+    double floatNanos = nanosPerOp(start, rounds * (numSteps + 1));
+
+    snprintf(message, sizeof(message), "Easing %-11s: table %5.1f ns/value, float %5.1f ns/value",
+      Easing::getName(easings[e]),
+      tableNanos,
+      floatNanos);
+    TEST_MESSAGE(message);
+  }
+}
+
+// RAM a transition costs.  Every transition lives in one of the controller's
+// fixed slots, so starting a full pool should not touch the heap.
+void bench_transition_memory() {
+  char message[120];
+  TransitionController transitions;
+
+  NativeClock::reset();
+  const size_t allocationsBefore = NativeHeap::allocationCount();
+  startSunrises(transitions, TransitionController::MAX_TRANSITIONS);
+  const size_t allocations = NativeHeap::allocationCount() - allocationsBefore;
+
+  snprintf(message, sizeof(message), "Transition sizes: field %u, color %u, change-on-finish %u bytes",
+    static_cast<unsigned int>(sizeof(FieldTransition)),
+    static_cast<unsigned int>(sizeof(ColorTransition)),
+    static_cast<unsigned int>(sizeof(ChangeFieldOnFinishTransition)));
+  TEST_MESSAGE(message);
+
+  snprintf(message, sizeof(message), "Transition pool: %u slots, %u bytes, %u allocations to fill",
+    static_cast<unsigned int>(TransitionController::MAX_TRANSITIONS),
+    static_cast<unsigned int>(sizeof(TransitionController)),
+    static_cast<unsigned int>(allocations));
+  TEST_MESSAGE(message);
+}
+
+//================================================================================
+// Radio reconfiguration
+//================================================================================
+
+// A scene touching RGBW, CCT and RGB+CCT bulbs, queued one bulb at a time
+// (and small enough not to overflow the queue).
+// Reports how often the radio is reconfigured, against simulated time.
+static void reportReconfigurations(size_t reorderWindow) {
+  const MiLightRemoteConfig* remotes[] = { &FUT096Config, &FUT007Config, &FUT092Config };
+  const size_t commands = 18;
+  Settings settings;
+  settings.packetReorderWindow = reorderWindow;
+  GroupStateStore stateStore(10, 0);
+  std::shared_ptr<SimulatedRadioFactory> radioFactory = std::make_shared<SimulatedRadioFactory>();
+  RadioSwitchboard radios(radioFactory, &stateStore, settings);
+  PacketSender sender(radios, settings, nullptr);
+  char message[120];
+
+  NativeClock::reset();
+  radios.switchRadio(&FUT092Config);
+  size_t reconfigurations = radios.getReconfigurationCount();
+  unsigned long start = micros();
+
+  for (size_t i = 0; i < commands; i++) {
+    PacketFormatter* formatter = remotes[i % 3]->packetFormatter;
+    uint8_t groupId = i / 3 % 4 + 1;
+
+    formatter->prepare(0x1000 + i, groupId);
+    formatter->updateStatus(ON, groupId);
+    PacketStream& stream = formatter->buildPackets();
+
+    while (stream.hasNext()) {
+      sender.enqueue(stream.next(), remotes[i % 3]);
+    }
+  }
+  while (sender.isSending()) {
+    sender.loop();
+  }
+
+  reconfigurations = radios.getReconfigurationCount() - reconfigurations;
+  double seconds = (micros() - start) / 1e6;
+
+  snprintf(message, sizeof(message), "Reorder window %3u ms: %2u reconfigurations in %5.1f ms, %5.1f/s",
+    static_cast<unsigned int>(reorderWindow),
+    static_cast<unsigned int>(reconfigurations),
+    seconds * 1000,
+    reconfigurations / seconds);
+  TEST_MESSAGE(message);
+}
+
+void bench_radio_reconfigurations() {
+  reportReconfigurations(0);
+  reportReconfigurations(100);
+}
+
+//================================================================================
+// nRF24 receive
+//================================================================================
+
+// Listens for one second of simulated time while a remote sends a new packet
+// every millisecond on the listen channel.  SPI traffic and radio delays are
+// modelled by the RF24 shim, and the rest of the main loop takes 100us.
+void bench_nrf24_receive_rate() {
+  const unsigned long periodMicros = 1000;
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  std::vector<RF24Channel> channels = { RF24Channel::RF24_LOW };
+  RF24 rf24(0, 0);
+  NRF24MiLightRadio radio(rf24, 0, config, channels, RF24Channel::RF24_LOW);
+  std::vector<std::vector<uint8_t>> frames;
+  uint8_t packet[MILIGHT_MAX_PACKET_LENGTH] = { 0 };
+  char message[120];
+
+  NativeClock::reset();
+  radio.begin();
+
+  // Distinct packets, so none are discarded as duplicates
+  for (size_t i = 0; i < 256; i++) {
+    packet[1] = i;
+    packet[config.packetLength - 1] = i;
+    radio.write(packet, config.packetLength);
+    frames.push_back(rf24.txFrames.back());
+  }
+
+  rf24.setAirTraffic(frames, 2 + config.channels[0], periodMicros);
+  size_t transactions = rf24.spiTransactions;
+  size_t received = 0;
+  unsigned long start = micros();
+
+  while (micros() - start < 1000000UL) {
+    if (radio.available()) {
+      size_t length = sizeof(packet);
+      radio.read(packet, length);
+      ++received;
+    }
+
+    // The rest of the main loop
+    NativeClock::advanceMicros(100);
+  }
+
+  double seconds = (micros() - start) / 1e6;
+
+  snprintf(message, sizeof(message), "nRF24 receive: %6.1f packets/s of %6.1f sent, %6.0f SPI transactions/s",
+    received / seconds,
+    1e6 / periodMicros,
+    (rf24.spiTransactions - transactions) / seconds);
+  TEST_MESSAGE(message);
+}
+
+// Time per write() of one packet on all three channels, repeating the same
+// packet (as PacketSender does) or sending a new one every time.  The RF24
+// shim's own bookkeeping is included in both.
+void bench_nrf24_repeats() {
+  const size_t repeats = 100000;
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  std::vector<RF24Channel> channels = { RF24Channel::RF24_LOW, RF24Channel::RF24_MID, RF24Channel::RF24_HIGH };
+  RF24 rf24(0, 0);
+  NRF24MiLightRadio radio(rf24, 0, config, channels, RF24Channel::RF24_LOW);
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  char message[120];
+
+  NativeClock::reset();
+  radio.begin();
+  rf24.txFrames.reserve(3 * 1000);
+
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < repeats; i++) {
+    if (i % 1000 == 0) {
+      rf24.txFrames.clear();
+    }
+    radio.write(packet, sizeof(packet));
+  }
+  double repeatNanos = nanosPerOp(start, repeats);
+
+  start = BenchClock::now();
+  for (size_t i = 0; i < repeats; i++) {
+    if (i % 1000 == 0) {
+      rf24.txFrames.clear();
+    }
+    packet[sizeof(packet) - 1] = i;
+    radio.write(packet, sizeof(packet));
+  }
+  double newPacketNanos = nanosPerOp(start, repeats);
+
+  snprintf(message, sizeof(message), "nRF24 write: %6.1f ns/repeat, %6.1f ns/new packet (3 channels)",
+    repeatNanos,
+    newPacketNanos);
+  TEST_MESSAGE(message);
+}
+
+// Virtual time the main loop spends inside the LT8900 driver while it sends a
+// burst of repeats, fed in batches the way PacketSender does.  The rest of
+// each loop iteration is taken to last 100us.
+void bench_lt8900_burst() {
+  const size_t bursts = 20;
+  const size_t repeatsPerBurst = 50;
+  const size_t repeatsPerLoop = 10;
+  const MiLightRadioConfig& config = MiLightRadioConfig::ALL_CONFIGS[0];
+  SimulatedLT8900 chip(15, 4);
+  LT8900Registers registers;
+  LT8900MiLightRadio radio(15, 0, 4, config, registers);
+  uint8_t packet[] = {0xB0, 0xF2, 0xEA, 0x04, 0x01, 0x00, 0x01};
+  char message[160];
+
+  NativeClock::reset();
+  radio.begin();
+
+  unsigned long totalStall = 0;
+  unsigned long longestStall = 0;
+  unsigned long totalDuration = 0;
+  size_t transactions = chip.transactions;
+  size_t spiCalls = SPI.calls;
+
+  for (size_t burst = 0; burst < bursts; burst++) {
+    size_t remaining = repeatsPerBurst;
+    unsigned long burstStart = micros();
+    chip.txFrames.clear();
+    packet[sizeof(packet) - 1] = burst;
+
+    while (remaining > 0 || radio.isTransmitting()) {
+      NativeClock::advanceMicros(100);
+      unsigned long start = micros();
+
+      radio.loop();
+      if (!radio.isTransmitting() && remaining > 0) {
+        size_t batch = std::min(remaining, repeatsPerLoop);
+        for (size_t i = 0; i < batch; i++) {
+          radio.write(packet, sizeof(packet));
+        }
+        remaining -= batch;
+      }
+
+      unsigned long stall = micros() - start;
+      totalStall += stall;
+      longestStall = std::max(longestStall, stall);
+    }
+
+    totalDuration += micros() - burstStart;
+    TEST_ASSERT_EQUAL_INT(repeatsPerBurst * MiLightRadioConfig::NUM_CHANNELS, chip.txFrames.size());
+  }
+
+  snprintf(message, sizeof(message), "LT8900 %d-repeat burst: %6lu us in driver, longest call %5lu us, %6lu us to send",
+    static_cast<int>(repeatsPerBurst),
+    totalStall / bursts,
+    longestStall,
+    totalDuration / bursts);
+  TEST_MESSAGE(message);
+
+  const size_t frames = bursts * repeatsPerBurst * MiLightRadioConfig::NUM_CHANNELS;
+  snprintf(message, sizeof(message), "LT8900 per frame sent: %4.2f SPI transactions, %4.2f SPI calls",
+    static_cast<double>(chip.transactions - transactions) / frames,
+    static_cast<double>(SPI.calls - spiCalls) / frames);
+  TEST_MESSAGE(message);
+}
+
+//================================================================================
+// Listen scheduling
+//================================================================================
+
+struct SimulatedPress {
+  unsigned long at;
+  size_t configIx;
+};
+
+// Button presses a few hundred milliseconds to a couple of seconds apart.  Most
+// are from an RGB+CCT remote, some from an RGBW remote and a few from a CCT one.
+static std::vector<SimulatedPress> simulatedPresses(size_t count) {
+  const size_t rgbCct = &FUT092Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+  const size_t rgbw = &FUT096Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+  const size_t cct = &FUT007Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+  std::vector<SimulatedPress> presses;
+  uint32_t seed = 1;
+  unsigned long at = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    seed = seed * 1103515245 + 12345;
+    at += 200 + (seed >> 8) % 2000;
+
+    const size_t remote = (seed >> 16) % 100;
+    presses.push_back({ at, remote < 85 ? rgbCct : (remote < 97 ? rgbw : cct) });
+  }
+
+  return presses;
+}
+
+// Replays the presses against a listen schedule.  Each main loop listens with
+// one config for slotMillis, and a press is heard if its config is listened
+// with while the remote is sending it.  Uses the old round robin if scheduler
+// is NULL.
+static void reportMissedPresses(const char* label, ListenScheduler* scheduler) {
+  const unsigned long slotMillis = 10;
+  const unsigned long pressMillis = 30;
+  const size_t cct = &FUT007Config.radioConfig - MiLightRadioConfig::ALL_CONFIGS;
+  std::vector<SimulatedPress> presses = simulatedPresses(2000);
+  std::vector<bool> heard(presses.size(), false);
+  size_t nextRoundRobin = 0;
+  size_t firstActive = 0;
+  char message[120];
+
+  while (firstActive < presses.size()) {
+    const unsigned long now = millis();
+    const size_t configIx = scheduler != NULL
+      ? scheduler->next()
+      : nextRoundRobin++ % MiLightRadioConfig::NUM_CONFIGS;
+
+    while (firstActive < presses.size() && presses[firstActive].at + pressMillis <= now) {
+      ++firstActive;
+    }
+
+    for (size_t i = firstActive; i < presses.size() && presses[i].at < now + slotMillis; i++) {
+      if (presses[i].configIx == configIx && !heard[i]) {
+        heard[i] = true;
+
+        if (scheduler != NULL) {
+          scheduler->recordDecoded(configIx);
+        }
+      }
+    }
+
+    NativeClock::advanceMillis(slotMillis);
+  }
+
+  size_t missed = 0, cctPresses = 0, cctMissed = 0;
+  for (size_t i = 0; i < presses.size(); i++) {
+    missed += !heard[i];
+
+    if (presses[i].configIx == cct) {
+      ++cctPresses;
+      cctMissed += !heard[i];
+    }
+  }
+
+  snprintf(message, sizeof(message), "Listen %-19s %5.1f%% of presses missed, %5.1f%% of rare CCT presses",
+    label,
+    100.0 * missed / presses.size(),
+    100.0 * cctMissed / cctPresses);
+  TEST_MESSAGE(message);
+}
+
+void bench_listen_missed_presses() {
+  NativeClock::reset();
+  reportMissedPresses("round robin:", NULL);
+
+  NativeClock::reset();
+  ListenScheduler adaptive(std::vector<MiLightRemoteType>{});
+  reportMissedPresses("adaptive:", &adaptive);
+
+  NativeClock::reset();
+  ListenScheduler pinned(std::vector<MiLightRemoteType>{ REMOTE_TYPE_RGB_CCT, REMOTE_TYPE_RGBW, REMOTE_TYPE_CCT });
+  reportMissedPresses("adaptive, pinned:", &pinned);
+}
+
+//================================================================================
+// V2 encoding
+//================================================================================
+
+// Encodes and decodes batches of packets with every possible key
+void bench_v2_encoding() {
+  const size_t batches = 100000;
+  const size_t batchSize = 16;
+  uint8_t packets[batchSize * V2_PACKET_LEN];
+  char message[120];
+
+  for (size_t i = 0; i < sizeof(packets); i++) {
+    packets[i] = i * 37;
+  }
+
+  PacketStream stream;
+  stream.packetStream = packets;
+  stream.packetLength = V2_PACKET_LEN;
+  stream.numPackets = batchSize;
+
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < batches; i++) {
+    for (size_t j = 0; j < batchSize; j++) {
+      packets[j * V2_PACKET_LEN] = i + j;
+      V2RFEncoding::encodeV2Packet(packets + j * V2_PACKET_LEN);
+    }
+  }
+  double encodeNanos = nanosPerOp(start, batches * batchSize);
+
+  start = BenchClock::now();
+  for (size_t i = 0; i < batches; i++) {
+    for (size_t j = 0; j < batchSize; j++) {
+      packets[j * V2_PACKET_LEN] = i + j;
+    }
+    V2RFEncoding::encodeV2Packets(stream);
+  }
+  double streamNanos = nanosPerOp(start, batches * batchSize);
+
+  start = BenchClock::now();
+  for (size_t i = 0; i < batches; i++) {
+    for (size_t j = 0; j < batchSize; j++) {
+      packets[j * V2_PACKET_LEN] = i + j;
+      V2RFEncoding::decodeV2Packet(packets + j * V2_PACKET_LEN);
+    }
+  }
+  double decodeNanos = nanosPerOp(start, batches * batchSize);
+  sink = packets[sizeof(packets) - 1];
+
+  snprintf(message, sizeof(message), "V2 encoding: %5.1f ns/encode, %5.1f ns/packet encoding a stream, %5.1f ns/decode",
+    encodeNanos,
+    streamNanos,
+    decodeNanos);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(bench_cache_lookup);
+  RUN_TEST(bench_state_flush);
+  RUN_TEST(bench_packet_queue);
+  RUN_TEST(bench_client_update);
+  RUN_TEST(bench_transition_step);
+  RUN_TEST(bench_transition_loop);
+  RUN_TEST(bench_transition_memory);
+  RUN_TEST(bench_batched_transitions);
+  RUN_TEST(bench_easing);
+  RUN_TEST(bench_v2_encoding);
+  RUN_TEST(bench_time_to_first_transmission);
+  RUN_TEST(bench_radio_reconfigurations);
+  RUN_TEST(bench_nrf24_receive_rate);
+  RUN_TEST(bench_nrf24_repeats);
+  RUN_TEST(bench_lt8900_burst);
+  RUN_TEST(bench_listen_missed_presses);
+
+  return UNITY_END();
+}
@@ -116,6 +116,27 @@ var UI_FIELDS = [ {
     help: "Pin to use for LED status display (0=disabled); negative inverses signal (recommend -2 for on-board LED)",
     type: "string",
     tab: "tab-setup"
+  }, {
+    tag: "radio_interrupt_pin",
+    friendly: "Radio interrupt pin",
+    help: "Pin wired to the nRF24's IRQ pin, or to the LT8900's PKT_FLAG pin (usually the same as the CE pin). "
+      + "Received packets are read as soon as they arrive instead of when the hub gets around to it.  "
+      + "Set to -1 to disable.",
+    type: "string",
+    tab: "tab-setup"
+  }, {
+    tag: "listen_ce_pin",
+    friendly: "Listen radio CE pin",
+    help: "CE pin of an optional second nRF24 that only listens for remotes, so that they're still heard while "
+      + "the hub is sending.  Set to -1 if there isn't one.",
+    type: "string",
+    tab: "tab-setup"
+  }, {
+    tag: "listen_csn_pin",
+    friendly: "Listen radio CSN pin",
+    help: "CSN pin of the second nRF24.  Set to -1 if there isn't one.",
+    type: "string",
+    tab: "tab-setup"
   }, {
     tag: "packet_repeats",
     friendly: "Packet repeats",
@@ -270,6 +291,32 @@ var UI_FIELDS = [ {
     "packets. Set to 0 to disable listening. Default is 3.",
     type: "string",
     tab: "tab-wifi"
+  }, {
+    tag:   "listen_dedupe_window",
+    friendly: "Listen dedupe window",
+    help: "Remotes repeat each packet many times, on several channels.  A received packet is ignored if the same "
+      + "packet was received less than this many milliseconds before.  Set to 0 to handle every copy.  Default is 500.",
+    type: "string",
+    tab: "tab-wifi"
+  }, {
+    tag:   "listen_remote_types",
+    friendly: "Listen for remote types",
+    help: "Only listen for packets from these types of remotes.  Listening for fewer types makes it less likely "
+      + "that a button press is missed.  Listens for all types if none are selected.",
+    type: "option_buttons",
+    settings: {
+      multiple: true,
+    },
+    options: {
+      'rgbw': 'RGBW',
+      'cct': 'CCT',
+      'rgb_cct': 'RGB+CCT',
+      'rgb': 'RGB',
+      'fut089': 'FUT089',
+      'fut091': 'FUT091',
+      'fut020': 'FUT020'
+    },
+    tab: "tab-wifi"
   }, {
     tag:   "state_flush_interval",
     friendly: "State flush interval",
@@ -277,6 +324,20 @@ var UI_FIELDS = [ {
     "Set to 0 to disable delay and immediately persist state to flash",
     type: "string",
     tab: "tab-setup"
+  }, {
+    tag:   "state_flush_budget_bytes",
+    friendly: "State flush budget (bytes)",
+    help: "Maximum number of bytes of state to write to flash per main loop iteration. " +
+    "Larger backlogs are spread across several iterations. Set to 0 for no limit. Default is 256.",
+    type: "string",
+    tab: "tab-setup"
+  }, {
+    tag:   "state_flush_budget_micros",
+    friendly: "State flush budget (microseconds)",
+    help: "Maximum time to spend writing state to flash per main loop iteration. " +
+    "Set to 0 for no limit (the default).",
+    type: "string",
+    tab: "tab-setup"
   }, {
     tag:   "mqtt_state_rate_limit",
     friendly: "MQTT state rate limit",
@@ -331,6 +392,37 @@ var UI_FIELDS = [ {
       false: 'Disable'
     },
     tab: "tab-radio"
+  }, {
+    tag: "enable_packet_coalescing",
+    friendly: "Replace stale queued packets",
+    help: "When a brightness, color, temperature, saturation or mode command is queued for a bulb that already has "
+      + "a queued, unsent command of the same kind, replace the old one instead of sending both.  Keeps sliders "
+      + "and transitions from replaying stale values.",
+    type: "option_buttons",
+    options: {
+      true: 'Enable',
+      false: 'Disable'
+    },
+    tab: "tab-radio"
+  }, {
+    tag: "interleave_packet_repeats",
+    friendly: "Interleave packet repeats",
+    help: "Take turns sending repeats of several queued packets for different bulbs, rather than sending every "
+      + "repeat of one packet before starting the next.  Commands queued behind a long sequence go out sooner.",
+    type: "option_buttons",
+    options: {
+      true: 'Enable',
+      false: 'Disable'
+    },
+    tab: "tab-radio"
+  }, {
+    tag: "packet_reorder_window",
+    friendly: "Packet reorder window",
+    help: "Milliseconds a queued packet can be held back so that packets for the radio type currently in use "
+      + "go out first.  Saves reconfiguring the radio when different kinds of bulbs are controlled at once.  "
+      + "Set to 0 to always send packets in the order they were queued.",
+    type: "string",
+    tab: "tab-radio"
   }, {
     tag:   "led_mode_wifi_config",
     friendly: "LED mode during wifi config",
@@ -1303,7 +1395,8 @@ $(function() {
         },
         {
           // Make sure the value is always an array, even if a single item is selected
-          rf24_channels: []
+          rf24_channels: [],
+          listen_remote_types: []
         });
 
       // Make sure we're submitting a value for group_state_fields (will be empty